@@ -0,0 +1,396 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "MappedLog.h"
+
+// Asynchronous event logger for the buffers.
+//
+// Producer and consumer threads never touch the log file. Each thread appends fixed-size records
+// to its own single-producer ring, and a background writer thread drains all rings, orders the
+// batch by timestamp and writes it with a single fwrite on an unbuffered FILE (one write syscall
+// per batch). The log is either the text format the analysis tools read
+//     [<timestamp>us] Producer <id> waited for <wait>ms and produced: <value>
+// or a compact binary format that exportText() converts back to that text. LogFormat::Trace writes the
+// binary records behind a TraceHeader; close() sorts them by timestamp and appends a time index, so
+// that the Visualizer can map the trace and seek to any time at once (see TraceFile.h).
+//
+// With LogSink::Mapped there is no writer thread: log() reserves space in a memory-mapped log file
+// and writes the record there directly (see MappedLog.h). Records are then not sorted by timestamp;
+// the analyzer's reorder window and the Visualizer's sort put them back in order.
+
+enum class LogRole : uint8_t { Producer = 0, Consumer = 1 };
+enum class LogFormat { Text, Binary, Trace };
+enum class LogSink { Writer, Mapped };
+
+struct LogRecord {
+    int64_t timestamp_ns;   // since the buffer was created
+    int64_t wait_ns;        // time the thread waited before the operation went through
+    int64_t value;
+    int32_t thread_id;      // producer or consumer id
+    LogRole role;
+};
+
+// Layout of a finished trace: this header, record_count LogRecords sorted by timestamp, then the index.
+// The time index has bucket_count + 1 entries: entry b is the first record at or after
+// first_ns + b * bucket_ns, the last one is record_count. Checkpoint c is the number of producer
+// records among the first c * TRACE_CHECKPOINT records. While the trace is being written only the
+// magic is set, and index_offset stays 0.
+struct TraceHeader {
+    char magic[8];
+    uint64_t record_count;
+    uint64_t produced_count;
+    int64_t first_ns;
+    int64_t last_ns;
+    int64_t bucket_ns;
+    uint64_t bucket_count;
+    uint64_t index_offset;      // bytes from the start of the file to the time index, then the checkpoints
+};
+
+constexpr size_t TRACE_RECORDS_PER_BUCKET = 64;     // on average
+constexpr size_t TRACE_CHECKPOINT = 256;
+
+// Value recorded in the log for a buffer element. Arithmetic items are logged as they are; other
+// payload types can provide their own logValue overload (found by ADL), otherwise 0 is logged.
+template <typename T>
+int64_t logValue(const T& item) {
+    if constexpr (std::is_arithmetic_v<T>) return static_cast<int64_t>(item);
+    else return 0;
+}
+
+class AsyncLogger {
+public:
+    static constexpr size_t RING_CAPACITY = 4096;     // records per thread, power of two
+    static constexpr auto WRITE_INTERVAL = std::chrono::milliseconds(2);
+    static constexpr char BINARY_MAGIC[8] = {'I', 'B', 'L', 'O', 'G', 'v', '1', '\0'};
+    static constexpr char TRACE_MAGIC[8] = {'I', 'B', 'T', 'R', 'A', 'C', 'E', '1'};
+    static constexpr size_t MAX_LINE = 128;
+
+    AsyncLogger() = default;
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    ~AsyncLogger() {
+        close();
+    }
+
+    // Truncates the log file and starts the writer thread, or maps the file for LogSink::Mapped.
+    bool open(const std::string& log_path, LogFormat log_format = LogFormat::Text, LogSink log_sink = LogSink::Writer) {
+        close();
+        format = log_format;
+        sink = log_sink;
+        path = log_path;
+        TraceHeader header{};
+        std::memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+        if (sink == LogSink::Mapped) {
+            if (!mapped.open(path)) return false;
+            if (format == LogFormat::Binary) mapped.append(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+            if (format == LogFormat::Trace) mapped.append(&header, sizeof(header));
+            active.store(true, std::memory_order_release);
+            return true;
+        }
+
+        file = std::fopen(path.c_str(), "wb");
+        if (!file) return false;
+        std::setvbuf(file, nullptr, _IONBF, 0);
+        if (format == LogFormat::Binary) std::fwrite(BINARY_MAGIC, 1, sizeof(BINARY_MAGIC), file);
+        if (format == LogFormat::Trace) std::fwrite(&header, 1, sizeof(header), file);
+
+        stopping = false;
+        writer = std::thread(&AsyncLogger::writerLoop, this);
+        active.store(true, std::memory_order_release);
+        return true;
+    }
+
+    // Hot path: copies one record into the calling thread's ring. Blocks (yielding) only if
+    // the writer has fallen a whole ring behind. Does nothing while the logger is not open.
+    void log(LogRole role, int thread_id, int64_t value, int64_t timestamp_ns, int64_t wait_ns) {
+        if (!active.load(std::memory_order_acquire)) return;
+        if (sink == LogSink::Mapped) {
+            writeMapped({timestamp_ns, wait_ns, value, thread_id, role});
+            return;
+        }
+        Ring* ring = localRing();
+        size_t t = ring->tail.load(std::memory_order_relaxed);
+        while (t - ring->head.load(std::memory_order_acquire) == RING_CAPACITY) {
+            wake.notify_one();
+            std::this_thread::yield();
+        }
+        ring->records[t & (RING_CAPACITY - 1)] = {timestamp_ns, wait_ns, value, thread_id, role};
+        ring->tail.store(t + 1, std::memory_order_release);
+    }
+
+    // Returns once every record logged before the call is in the file.
+    void flush() {
+        std::unique_lock<std::mutex> lock(writer_mutex);
+        if (!writer.joinable()) return;
+        uint64_t target = ++flush_requested;
+        wake.notify_one();
+        flushed.wait(lock, [&] { return flush_completed >= target; });
+    }
+
+    // The mapped sink must not be closed while threads are still logging. A trace is indexed here.
+    void close() {
+        if (mapped.isOpen()) {
+            active.store(false, std::memory_order_relaxed);
+            mapped.close();
+        } else if (writer.joinable()) {
+            active.store(false, std::memory_order_relaxed);
+            {
+                std::lock_guard<std::mutex> lock(writer_mutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            writer.join();
+            std::fclose(file);
+            file = nullptr;
+        } else {
+            return;
+        }
+        if (format == LogFormat::Trace) finishTrace(path);
+    }
+
+    // Appends the text form of a record, identical to what logEvent used to write.
+    static void formatText(const LogRecord& r, std::string& out) {
+        char line[MAX_LINE];
+        out.append(line, formatLine(r, line));
+    }
+
+    // Writes the text form of a record into line and returns its length.
+    static size_t formatLine(const LogRecord& r, char (&line)[MAX_LINE]) {
+        bool producer = (r.role == LogRole::Producer);
+        int n = std::snprintf(line, sizeof(line), "[%lldus] %s %d waited for %fms and %s: %lld\n",
+                              static_cast<long long>(r.timestamp_ns / 1000), producer ? "Producer" : "Consumer",
+                              r.thread_id, static_cast<double>(r.wait_ns) / 1e6,
+                              producer ? "produced" : "consumed", static_cast<long long>(r.value));
+        return std::min(static_cast<size_t>(n), sizeof(line) - 1);
+    }
+
+    // Converts a binary log or a trace into the text format.
+    static bool exportText(const std::string& binary_path, const std::string& text_path) {
+        std::FILE* in = std::fopen(binary_path.c_str(), "rb");
+        if (!in) return false;
+        TraceHeader header{};
+        size_t remaining = SIZE_MAX;    // records left to read
+        bool read = std::fread(header.magic, 1, sizeof(header.magic), in) == sizeof(header.magic);
+        if (read && std::memcmp(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) == 0) {
+            read = std::fread(reinterpret_cast<char*>(&header) + sizeof(header.magic), 1, sizeof(header) - sizeof(header.magic), in) ==
+                   sizeof(header) - sizeof(header.magic);
+            // A finished trace has its index after the records
+            if (header.index_offset != 0) remaining = header.record_count;
+        } else if (read) {
+            read = std::memcmp(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0;
+        }
+        if (!read) {
+            std::fclose(in);
+            return false;
+        }
+        std::FILE* out = std::fopen(text_path.c_str(), "wb");
+        if (!out) {
+            std::fclose(in);
+            return false;
+        }
+
+        std::vector<LogRecord> chunk(RING_CAPACITY);
+        std::string text;
+        size_t n;
+        while (remaining > 0 && (n = std::fread(chunk.data(), sizeof(LogRecord), std::min(chunk.size(), remaining), in)) > 0) {
+            remaining -= n;
+            text.clear();
+            for (size_t i = 0; i < n; ++i) formatText(chunk[i], text);
+            std::fwrite(text.data(), 1, text.size(), out);
+        }
+        std::fclose(in);
+        std::fclose(out);
+        return true;
+    }
+
+    // Writes records as a finished trace at path: sorted by timestamp, followed by the index.
+    static bool writeTrace(const std::string& trace_path, std::vector<LogRecord>& records) {
+        std::stable_sort(records.begin(), records.end(), [](const LogRecord& a, const LogRecord& b) {
+            return a.timestamp_ns < b.timestamp_ns;
+        });
+
+        TraceHeader header{};
+        std::memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+        header.record_count = records.size();
+        header.first_ns = records.empty() ? 0 : records.front().timestamp_ns;
+        header.last_ns = records.empty() ? 0 : records.back().timestamp_ns;
+        uint64_t span = static_cast<uint64_t>(header.last_ns - header.first_ns) + 1;
+        uint64_t buckets = std::max<uint64_t>(1, records.size() / TRACE_RECORDS_PER_BUCKET);
+        header.bucket_ns = static_cast<int64_t>((span + buckets - 1) / buckets);
+        header.bucket_count = (span + header.bucket_ns - 1) / header.bucket_ns;
+        header.index_offset = sizeof(TraceHeader) + records.size() * sizeof(LogRecord);
+
+        std::vector<uint64_t> time_index(header.bucket_count + 1);
+        std::vector<uint64_t> checkpoints(records.size() / TRACE_CHECKPOINT + 1);
+        uint64_t bucket = 0;
+        for (size_t i = 0; i < records.size(); ++i) {
+            if (i % TRACE_CHECKPOINT == 0) checkpoints[i / TRACE_CHECKPOINT] = header.produced_count;
+            uint64_t b = static_cast<uint64_t>(records[i].timestamp_ns - header.first_ns) / header.bucket_ns;
+            while (bucket <= b) time_index[bucket++] = i;
+            if (records[i].role == LogRole::Producer) header.produced_count++;
+        }
+        while (bucket <= header.bucket_count) time_index[bucket++] = records.size();
+        if (records.size() % TRACE_CHECKPOINT == 0) checkpoints.back() = header.produced_count;
+
+        std::FILE* out = std::fopen(trace_path.c_str(), "wb");
+        if (!out) return false;
+        bool written = std::fwrite(&header, sizeof(header), 1, out) == 1 &&
+                       (records.empty() || std::fwrite(records.data(), sizeof(LogRecord), records.size(), out) == records.size()) &&
+                       std::fwrite(time_index.data(), sizeof(uint64_t), time_index.size(), out) == time_index.size() &&
+                       std::fwrite(checkpoints.data(), sizeof(uint64_t), checkpoints.size(), out) == checkpoints.size();
+        return std::fclose(out) == 0 && written;
+    }
+
+    // Sorts and indexes the records of a trace written by the logger; a finished trace is left as it is.
+    static bool finishTrace(const std::string& trace_path) {
+        std::FILE* in = std::fopen(trace_path.c_str(), "rb");
+        if (!in) return false;
+        TraceHeader header{};
+        if (std::fread(&header, sizeof(header), 1, in) != 1 || std::memcmp(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+            std::fclose(in);
+            return false;
+        }
+        if (header.index_offset != 0) {
+            std::fclose(in);
+            return true;
+        }
+        std::vector<LogRecord> records;
+        std::vector<LogRecord> chunk(RING_CAPACITY);
+        size_t n;
+        while ((n = std::fread(chunk.data(), sizeof(LogRecord), chunk.size(), in)) > 0) records.insert(records.end(), chunk.begin(), chunk.begin() + n);
+        std::fclose(in);
+        return writeTrace(trace_path, records);
+    }
+
+private:
+    // Single-producer/single-consumer ring owned by one logging thread and drained by the writer.
+    // head and tail live on separate cache lines so the two sides do not false-share.
+    struct Ring {
+        alignas(64) std::atomic<size_t> head{0};    // next record the writer reads
+        alignas(64) std::atomic<size_t> tail{0};    // next record the owner writes
+        alignas(64) std::atomic<bool> in_use{true};
+        LogRecord records[RING_CAPACITY];
+    };
+
+    // Releases the thread's ring when the thread exits so that a later thread can reuse it.
+    struct RingHandle {
+        AsyncLogger* owner = nullptr;
+        Ring* ring = nullptr;
+        ~RingHandle() {
+            if (ring) ring->in_use.store(false, std::memory_order_release);
+        }
+    };
+
+    std::FILE* file = nullptr;
+    std::string path;
+    LogFormat format = LogFormat::Text;
+    LogSink sink = LogSink::Writer;
+    MappedLogSink mapped;
+    std::atomic<bool> active{false};
+
+    std::thread writer;
+    std::mutex writer_mutex;
+    std::condition_variable wake;
+    std::condition_variable flushed;
+    bool stopping = false;
+    uint64_t flush_requested = 0;
+    uint64_t flush_completed = 0;
+
+    std::mutex rings_mutex;
+    std::vector<std::unique_ptr<Ring>> rings;
+
+    Ring* localRing() {
+        thread_local RingHandle handle;
+        if (handle.owner != this) {
+            if (handle.ring) handle.ring->in_use.store(false, std::memory_order_release);
+            handle.owner = this;
+            handle.ring = acquireRing();
+        }
+        return handle.ring;
+    }
+
+    // Reuses a ring left behind by an exited thread, otherwise registers a new one.
+    Ring* acquireRing() {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        for (auto& r : rings) {
+            bool expected = false;
+            if (r->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) return r.get();
+        }
+        rings.push_back(std::make_unique<Ring>());
+        return rings.back().get();
+    }
+
+    void writeMapped(const LogRecord& r) {
+        if (format != LogFormat::Text) {
+            mapped.append(&r, sizeof(r));
+            return;
+        }
+        char line[MAX_LINE];
+        mapped.append(line, formatLine(r, line));
+    }
+
+    void writerLoop() {
+        std::vector<LogRecord> batch;
+        std::string text;
+        while (true) {
+            uint64_t requested;
+            bool stop;
+            {
+                std::unique_lock<std::mutex> lock(writer_mutex);
+                wake.wait_for(lock, WRITE_INTERVAL, [&] { return stopping || flush_requested > flush_completed; });
+                requested = flush_requested;
+                stop = stopping;
+            }
+
+            drain(batch);
+            if (!batch.empty()) writeBatch(batch, text);
+
+            {
+                std::lock_guard<std::mutex> lock(writer_mutex);
+                flush_completed = requested;
+            }
+            flushed.notify_all();
+            if (stop) break;
+        }
+    }
+
+    void drain(std::vector<LogRecord>& batch) {
+        batch.clear();
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        for (auto& r : rings) {
+            size_t h = r->head.load(std::memory_order_relaxed);
+            size_t t = r->tail.load(std::memory_order_acquire);
+            for (; h != t; ++h) batch.push_back(r->records[h & (RING_CAPACITY - 1)]);
+            r->head.store(h, std::memory_order_release);
+        }
+    }
+
+    void writeBatch(std::vector<LogRecord>& batch, std::string& text) {
+        std::stable_sort(batch.begin(), batch.end(), [](const LogRecord& a, const LogRecord& b) {
+            return a.timestamp_ns < b.timestamp_ns;
+        });
+        if (format != LogFormat::Text) {
+            std::fwrite(batch.data(), sizeof(LogRecord), batch.size(), file);
+            return;
+        }
+        text.clear();
+        for (const LogRecord& r : batch) formatText(r, text);
+        std::fwrite(text.data(), 1, text.size(), file);
+    }
+};
+
+// Events of whichever buffer is running are queued here and written to the log file by a background thread
+inline AsyncLogger buffer_logger;
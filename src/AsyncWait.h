@@ -0,0 +1,196 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <utility>
+#include "Instrumentation.h"
+#include "SlotStorage.h"
+
+// Coroutine support for the linked list buffers: co_await buffer.async_consume(id) and
+// co_await buffer.async_produce(item, id).
+//
+// An operation that cannot complete does not block its thread. The coroutine is parked in the
+// buffer's AsyncWaiterQueue for that side and the counterpart operation completes it: a producer
+// that publishes an item moves it into the oldest waiting consumer and resumes that coroutine on its
+// own thread, and in the finite buffer a consumer that frees a slot writes the oldest waiting
+// producer's item and resumes it. There are no extra threads and no condition variables, so any
+// number of logical consumers can share a few event loop threads.
+//
+// An awaiter must be co_awaited, and a suspended coroutine must not be destroyed before it has
+// been resumed.
+
+// A parked operation. The waiter lives in the awaiter, i.e. in the coroutine frame.
+struct AsyncWaiter {
+    std::coroutine_handle<> handle;
+    AsyncWaiter* next = nullptr;
+    int thread_id = 0;              // producer or consumer id, for the log
+    uint64_t request_time = 0;      // CycleClock ticks when the operation started
+    int64_t logged_value = 0;       // set by the thread that completes the operation
+};
+
+// Consumers: the item handed over by the producer. Producers: the item still to be written.
+template <typename T>
+struct ItemWaiter : AsyncWaiter {
+    SlotStorage<T> item;
+};
+
+// FIFO of parked operations, guarded by the lock of the side they wait on. The waiter count is the
+// handshake with the other side, which checks it without that lock:
+//
+//     Waiter (holding the lock):              Counterpart:
+//         push(waiter)                             publish the item / free the slot
+//         re-check the condition                   if (mayHaveWaiters()) take the lock, hand off
+//
+// Both count updates are seq_cst read-modify-writes, as in EventCount, so either the waiter sees what
+// was published or the counterpart sees the waiter.
+class AsyncWaiterQueue {
+public:
+    void push(AsyncWaiter* waiter) {
+        waiter->next = nullptr;
+        if (last) last->next = waiter;
+        else first = waiter;
+        last = waiter;
+        count.fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    AsyncWaiter* pop() {
+        AsyncWaiter* waiter = first;
+        first = waiter->next;
+        if (!first) last = nullptr;
+        count.fetch_sub(1, std::memory_order_relaxed);
+        return waiter;
+    }
+
+    bool empty() const {
+        return first == nullptr;
+    }
+
+    // Counterpart side, after publishing and without the lock
+    bool mayHaveWaiters() {
+        return count.fetch_add(0, std::memory_order_seq_cst) != 0;
+    }
+
+private:
+    AsyncWaiter* first = nullptr;
+    AsyncWaiter* last = nullptr;
+    alignas(CACHE_LINE_SIZE) std::atomic<int> count{0};
+};
+
+// Waiters that an operation completed and that are resumed once its locks are released, in order
+class ResumeList {
+public:
+    void add(AsyncWaiter* waiter) {
+        waiter->next = nullptr;
+        if (last) last->next = waiter;
+        else first = waiter;
+        last = waiter;
+    }
+
+    bool empty() const {
+        return first == nullptr;
+    }
+
+    // Takes waiter back out, e.g. because the operation that parked it completes without suspending
+    bool remove(AsyncWaiter* waiter) {
+        AsyncWaiter* prev = nullptr;
+        for (AsyncWaiter* w = first; w; prev = w, w = w->next) {
+            if (w != waiter) continue;
+            if (prev) prev->next = w->next;
+            else first = w->next;
+            if (last == w) last = prev;
+            return true;
+        }
+        return false;
+    }
+
+    // Moves all of other's waiters to the end of this list
+    void append(ResumeList& other) {
+        if (other.empty()) return;
+        if (last) last->next = other.first;
+        else first = other.first;
+        last = other.last;
+        other.first = other.last = nullptr;
+    }
+
+    template <typename F>
+    void forEach(F f) const {
+        for (AsyncWaiter* w = first; w; w = w->next) f(*w);
+    }
+
+    void resumeAll() {
+        AsyncWaiter* waiter = first;
+        first = last = nullptr;
+        while (waiter) {
+            // Read next first: resuming may end the coroutine and with it the waiter
+            AsyncWaiter* next = waiter->next;
+            waiter->handle.resume();
+            waiter = next;
+        }
+    }
+
+private:
+    AsyncWaiter* first = nullptr;
+    AsyncWaiter* last = nullptr;
+};
+
+// Returned by async_consume(). The buffer's suspendConsumer(waiter) either completes the
+// operation at once (returns false, the coroutine continues) or parks it (returns true).
+template <typename Buffer, typename T>
+class ConsumeAwaiter {
+public:
+    ConsumeAwaiter(Buffer& buffer, int consumer_id) : buffer(buffer) {
+        waiter.thread_id = consumer_id;
+    }
+
+    ConsumeAwaiter(const ConsumeAwaiter&) = delete;
+    ConsumeAwaiter& operator=(const ConsumeAwaiter&) = delete;
+
+    bool await_ready() const noexcept {
+        return false;       // decided under the consumer lock in await_suspend
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        waiter.handle = handle;
+        waiter.request_time = CycleClock::now();
+        return buffer.suspendConsumer(waiter);
+    }
+
+    T await_resume() {
+        return waiter.item.take();
+    }
+
+private:
+    Buffer& buffer;
+    ItemWaiter<T> waiter;
+};
+
+// Returned by async_produce(); the buffer's suspendProducer(waiter) writes the item at once or parks it.
+template <typename Buffer, typename T>
+class ProduceAwaiter {
+public:
+    template <typename U>
+    ProduceAwaiter(Buffer& buffer, U&& item, int producer_id) : buffer(buffer) {
+        waiter.item.construct(std::forward<U>(item));
+        waiter.thread_id = producer_id;
+    }
+
+    ProduceAwaiter(const ProduceAwaiter&) = delete;
+    ProduceAwaiter& operator=(const ProduceAwaiter&) = delete;
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        waiter.handle = handle;
+        waiter.request_time = CycleClock::now();
+        return buffer.suspendProducer(waiter);
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    Buffer& buffer;
+    ItemWaiter<T> waiter;
+};
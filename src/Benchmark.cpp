@@ -0,0 +1,693 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <functional>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include "InfiniteBuffer.h"
+#include "FiniteBuffer.h"
+#include "PayloadArena.h"
+#include "SharedRingBuffer.h"
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+// Benchmark harness for all buffer implementations.
+//
+// Unlike the SFML drivers this has no sleeps and no logging: every producer pushes its share of
+// --items as fast as it can (after an optional busy-wait of --work-ns per item to simulate work) and
+// the consumers drain them. Each configuration of the sweep reports throughput (items moved from a
+// producer to a consumer per second) and the end-to-end produce/consume latency percentiles
+// recorded by the buffer's own instrumentation, as CSV or JSON. The JSON rows of the linked list
+// buffers (locked, mcs, finite-list) also carry their contention report (see Contention.h).
+//
+// Buffers that run differently from the rest:
+//   spsc, finite-spsc   only the configurations with one producer and one consumer
+//   sharded             one shard per producer; numa is the sharded buffer with one shard per NUMA node
+//   shm-ring            the SharedRingBuffer in one process
+//   ipc-ring            the SharedRingBuffer with its consumers in a forked process, so every item
+//                       crosses address spaces (zero-copy payloads do not, and are skipped)
+//   priority            one strict-priority lane per producer
+//   hybrid              sweeps --capacities as its ring size
+//   segmented           its default 256-slot segments
+//
+// --pin-producers and --pin-consumers take cpu lists such as 0-7,16-23 and pin producer (consumer) i to
+// the i-th cpu of the list, wrapping around, so that a scaling curve runs on the same cores every time.
+// Without them the threads are left to the scheduler.
+//
+// --transports copy,zero-copy runs every configuration both ways. copy moves the payload through the
+// buffer by value; zero-copy has the producer fill a block of a PayloadArena in place and the buffer
+// carry its PayloadRef, and the consumer read the block and release it. The arena has --arena-blocks
+// blocks of the payload size, by default enough for a full bounded buffer (1024 items for the
+// unbounded ones) plus one block per thread.
+//
+//   buffer_bench [--buffers locked,mcs,spsc,sharded,numa,priority,hybrid,segmented,lock-free,finite-list,finite-spsc,finite-ring,
+//                           shm-ring,ipc-ring]
+//                [--producers 1,2,4]
+//                [--consumers 1,2] [--capacities 16,1024] [--payloads 8,64,256,4096,16384,65536] [--work-ns 0,1000]
+//                [--transports copy,zero-copy] [--arena-blocks N]
+//                [--items N] [--format csv|json] [--out FILE] [--quick]
+//                [--pin-producers CPUS] [--pin-consumers CPUS]
+//   buffer_bench --full-stress [--buffers finite-list,finite-ring,shm-ring] [--producers N] [--capacities N]
+//                [--items N] [--consume-sleep-us N] [--max-cpu-percent X]
+//
+// --full-stress runs a bounded buffer full instead of the sweep: --producers (default 8) against one
+// consumer that sleeps --consume-sleep-us (default 200) per item, in a buffer of --capacities (default 4)
+// slots, for --items (default 2000) items. Nearly all the time every producer waits for space, so the
+// process CPU time (user + system, from getrusage) shows what that waiting costs. Parked producers cost
+// next to nothing: the CPU time is then the consumer's own sleeps and wakeups, about the same as with a
+// single producer. Each buffer gets a CSV row with its CPU time as a percentage of the wall time; with
+// --max-cpu-percent the run fails (exit status 1) if a buffer goes above it. The default is finite-list;
+// the rings (finite-ring, shm-ring) can be run too, but their producers yield in a loop while full.
+
+// An element of the given total size; value carries the sequence number used for the checksum
+template <size_t Size>
+struct Payload {
+    static_assert(Size > sizeof(int64_t));
+    int64_t value = 0;
+    char padding[Size - sizeof(int64_t)] = {};
+};
+
+// With zero-copy the item is a PayloadRef into arena. Its block is filled like a Payload of the
+// block's size: the value first, then zeros.
+template <typename Item>
+Item makeItem(int64_t value, PayloadArena* arena) {
+    if constexpr (is_same_v<Item, int64_t>) return value;
+    else if constexpr (is_same_v<Item, PayloadRef>) {
+        PayloadRef region = arena->acquire();
+        span<byte> block = arena->writable(region);
+        memcpy(block.data(), &value, sizeof(value));
+        memset(block.data() + sizeof(value), 0, block.size() - sizeof(value));
+        return arena->commit(region, block.size());
+    } else {
+        Item item;
+        item.value = value;
+        return item;
+    }
+}
+
+// Reads the value and, with zero-copy, releases the item's block
+template <typename Item>
+int64_t itemValue(const Item& item, PayloadArena* arena) {
+    if constexpr (is_same_v<Item, int64_t>) return item;
+    else if constexpr (is_same_v<Item, PayloadRef>) {
+        int64_t value;
+        memcpy(&value, item.data, sizeof(value));
+        arena->release(item);
+        return value;
+    } else return item.value;
+}
+
+struct BenchConfig {
+    string buffer;
+    int producers;
+    int consumers;
+    size_t capacity;     // 0 for the unbounded buffers
+    size_t payload;      // bytes per element
+    bool zero_copy;      // payloads in a PayloadArena, the buffer carries PayloadRefs
+    size_t arena_blocks; // blocks of that arena, 0 for the default
+    int work_ns;         // simulated work per item, on both sides
+    vector<int> producer_cpus;      // --pin-producers, empty if not pinned
+    vector<int> consumer_cpus;      // --pin-consumers
+};
+
+struct BenchResult {
+    size_t items = 0;
+    double seconds = 0;
+    bool checksum_ok = false;
+    LatencySummary produce;
+    LatencySummary consume;
+    bool has_contention = false;        // the linked list buffers' wait profile (JSON only)
+    ContentionReport contention;
+};
+
+// Busy-waits rather than sleeping so that the simulated work is short and precise
+void simulateWork(int work_ns) {
+    if (work_ns <= 0) return;
+    auto until = chrono::steady_clock::now() + chrono::nanoseconds(work_ns);
+    while (chrono::steady_clock::now() < until) cpuRelax();
+}
+
+// Pins the calling thread, the index-th of its role, to its cpu from a --pin-* list
+void pinBenchThread(const vector<int>& cpus, int index) {
+    if (cpus.empty()) return;
+    int cpu = cpus[static_cast<size_t>(index) % cpus.size()];
+    if (!pinCurrentThread(cpu)) cerr << "Warning: cannot pin thread to cpu " << cpu << "\n";
+}
+
+// Splits total items over n threads; the first (total % n) threads take one more
+size_t share(size_t total, int n, int index) {
+    return total / n + (static_cast<size_t>(index) < total % n ? 1 : 0);
+}
+
+template <typename Item, typename Buffer>
+BenchResult runOne(Buffer& buffer, const BenchConfig& cfg, size_t total_items, PayloadArena* arena) {
+    atomic<int> ready{0};
+    atomic<bool> go{false};
+    atomic<int64_t> consumed_sum{0};
+    int thread_count = cfg.producers + cfg.consumers;
+
+    auto waitForStart = [&]() {
+        ready.fetch_add(1);
+        while (!go.load(memory_order_acquire)) this_thread::yield();
+    };
+
+    vector<thread> threads;
+    int64_t next_value = 0;
+    int64_t expected_sum = 0;
+    for (int p = 0; p < cfg.producers; ++p) {
+        size_t count = share(total_items, cfg.producers, p);
+        int64_t first = next_value;
+        next_value += static_cast<int64_t>(count);
+        for (int64_t v = first; v < next_value; ++v) expected_sum += v;
+        threads.emplace_back([&, p, first, count]() {
+            pinBenchThread(cfg.producer_cpus, p);
+            labelThread("Producer " + to_string(p + 1));
+            waitForStart();
+            for (size_t i = 0; i < count; ++i) {
+                simulateWork(cfg.work_ns);
+                if constexpr (requires { buffer.laneCount(); })
+                    buffer.produce_to(static_cast<size_t>(p), makeItem<Item>(first + static_cast<int64_t>(i), arena), p + 1);
+                else
+                    buffer.produce(makeItem<Item>(first + static_cast<int64_t>(i), arena), p + 1);
+            }
+        });
+    }
+    for (int c = 0; c < cfg.consumers; ++c) {
+        size_t count = share(total_items, cfg.consumers, c);
+        threads.emplace_back([&, c, count]() {
+            pinBenchThread(cfg.consumer_cpus, c);
+            labelThread("Consumer " + to_string(c + 1));
+            waitForStart();
+            int64_t sum = 0;
+            for (size_t i = 0; i < count; ++i) {
+                sum += itemValue(buffer.consume(c + 1), arena);
+                simulateWork(cfg.work_ns);
+            }
+            consumed_sum.fetch_add(sum);
+        });
+    }
+
+    while (ready.load() < thread_count) this_thread::yield();
+    auto start = chrono::steady_clock::now();
+    go.store(true, memory_order_release);
+    for (auto& t : threads) t.join();
+    auto end = chrono::steady_clock::now();
+
+    BenchResult r;
+    r.items = total_items;
+    r.seconds = chrono::duration<double>(end - start).count();
+    r.checksum_ok = (consumed_sum.load() == expected_sum);
+    r.produce = buffer.latency(BufferOp::Produce);
+    r.consume = buffer.latency(BufferOp::Consume);
+    if constexpr (requires { buffer.contention(); }) {
+        r.has_contention = true;
+        r.contention = buffer.contention();
+    }
+    return r;
+}
+
+// ipc-ring: the producers run here and the consumers in a child process, which reports its sum,
+// its consume latencies and the time the last item arrived through a shared control block.
+// steady_clock is system-wide, so the times of both processes compare.
+template <typename Item>
+BenchResult runIpc(const BenchConfig& cfg, size_t total_items) {
+    BenchResult r;
+#if defined(__linux__)
+    struct Control {
+        atomic<int> ready{0};
+        atomic<bool> go{false};
+        atomic<int64_t> consumed_sum{0};
+        atomic<int64_t> end_ns{0};
+        LatencySummary consume;
+    };
+    auto ring = finite_buffer::SharedRingBuffer<Item>::createAnonymous(cfg.capacity);
+    void* memory = mmap(nullptr, sizeof(Control), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (!ring || memory == MAP_FAILED) {
+        cerr << "Cannot map shared memory for ipc-ring\n";
+        return r;
+    }
+    Control* control = new (memory) Control();
+    int thread_count = cfg.producers + cfg.consumers;
+    auto waitForStart = [&]() {
+        control->ready.fetch_add(1);
+        while (!control->go.load(memory_order_acquire)) this_thread::yield();
+    };
+
+    cout.flush();
+    pid_t child = fork();
+    if (child == 0) {
+        vector<thread> consumers;
+        for (int c = 0; c < cfg.consumers; ++c) {
+            size_t count = share(total_items, cfg.consumers, c);
+            consumers.emplace_back([&, c, count]() {
+                pinBenchThread(cfg.consumer_cpus, c);
+                waitForStart();
+                int64_t sum = 0;
+                for (size_t i = 0; i < count; ++i) {
+                    sum += itemValue(ring->consume(c + 1), nullptr);
+                    simulateWork(cfg.work_ns);
+                }
+                control->consumed_sum.fetch_add(sum);
+            });
+        }
+        for (auto& t : consumers) t.join();
+        control->end_ns.store(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+        control->consume = ring->latency(BufferOp::Consume);
+        _exit(0);
+    }
+
+    vector<thread> producers;
+    int64_t next_value = 0;
+    int64_t expected_sum = 0;
+    for (int p = 0; p < cfg.producers && child > 0; ++p) {
+        size_t count = share(total_items, cfg.producers, p);
+        int64_t first = next_value;
+        next_value += static_cast<int64_t>(count);
+        for (int64_t v = first; v < next_value; ++v) expected_sum += v;
+        producers.emplace_back([&, p, first, count]() {
+            pinBenchThread(cfg.producer_cpus, p);
+            waitForStart();
+            for (size_t i = 0; i < count; ++i) {
+                simulateWork(cfg.work_ns);
+                ring->produce(makeItem<Item>(first + static_cast<int64_t>(i), nullptr), p + 1);
+            }
+        });
+    }
+    if (child > 0) {
+        while (control->ready.load() < thread_count) this_thread::yield();
+        auto start = chrono::steady_clock::now();
+        control->go.store(true, memory_order_release);
+        for (auto& t : producers) t.join();
+        int status = 0;
+        waitpid(child, &status, 0);
+        int64_t start_ns = chrono::duration_cast<chrono::nanoseconds>(start.time_since_epoch()).count();
+
+        r.items = total_items;
+        r.seconds = static_cast<double>(control->end_ns.load() - start_ns) / 1e9;
+        r.checksum_ok = WIFEXITED(status) && WEXITSTATUS(status) == 0 && control->consumed_sum.load() == expected_sum;
+        r.produce = ring->latency(BufferOp::Produce);
+        r.consume = control->consume;
+    } else {
+        cerr << "Cannot fork the ipc-ring consumers\n";
+    }
+    control->~Control();
+    munmap(memory, sizeof(Control));
+#else
+    (void)cfg;
+    (void)total_items;
+    cerr << "ipc-ring needs Linux\n";
+#endif
+    return r;
+}
+
+// A fresh buffer per configuration, so that statistics and capacity do not carry over
+template <typename Item>
+BenchResult runBuffer(const BenchConfig& cfg, size_t items, PayloadArena* arena = nullptr) {
+    if (cfg.buffer == "locked") {
+        auto b = make_unique<infinite_buffer::LinkedListBuffer<Item>>();
+        return runOne<Item>(*b, cfg, items, arena);
+    }
+    if (cfg.buffer == "mcs") {
+        auto b = make_unique<infinite_buffer::LinkedListBuffer<Item, McsLock>>();
+        return runOne<Item>(*b, cfg, items, arena);
+    }
+    if (cfg.buffer == "spsc") {
+        auto b = make_unique<infinite_buffer::LinkedListBuffer<Item, SpscPolicy>>();
+        return runOne<Item>(*b, cfg, items, arena);
+    }
+    if (cfg.buffer == "sharded") {
+        auto b = make_unique<infinite_buffer::ShardedBuffer<Item>>(static_cast<size_t>(cfg.producers));
+        return runOne<Item>(*b, cfg, items, arena);
+    }
+    if (cfg.buffer == "numa") {
+        auto b = make_unique<infinite_buffer::ShardedBuffer<Item>>(infinite_buffer::per_numa_node);
+        return runOne<Item>(*b, cfg, items, arena);
+    }
+    if (cfg.buffer == "priority") {
+        auto b = make_unique<infinite_buffer::PriorityBuffer<Item>>(static_cast<size_t>(cfg.producers));
+        return runOne<Item>(*b, cfg, items, arena);
+    }
+    if (cfg.buffer == "hybrid") {
+        auto b = make_unique<infinite_buffer::HybridBuffer<Item>>(cfg.capacity);
+        return runOne<Item>(*b, cfg, items, arena);
+    }
+    if (cfg.buffer == "segmented") {
+        auto b = make_unique<infinite_buffer::SegmentedBuffer<Item>>();
+        return runOne<Item>(*b, cfg, items, arena);
+    }
+    if (cfg.buffer == "lock-free") {
+        auto b = make_unique<infinite_buffer::LockFreeLinkedListBuffer<Item>>();
+        return runOne<Item>(*b, cfg, items, arena);
+    }
+    if (cfg.buffer == "finite-list") {
+        auto b = make_unique<finite_buffer::LinkedListBuffer<Item>>(static_cast<int>(cfg.capacity));
+        return runOne<Item>(*b, cfg, items, arena);
+    }
+    if (cfg.buffer == "shm-ring") {
+        auto b = finite_buffer::SharedRingBuffer<Item>::createAnonymous(cfg.capacity);
+        if (!b) {
+            cerr << "Cannot map shared memory for shm-ring\n";
+            return {};
+        }
+        return runOne<Item>(*b, cfg, items, arena);
+    }
+    if constexpr (!is_same_v<Item, PayloadRef>) {
+        if (cfg.buffer == "ipc-ring") return runIpc<Item>(cfg, items);
+    }
+    if (cfg.buffer == "finite-spsc") {
+        auto b = make_unique<finite_buffer::LinkedListBuffer<Item, SpscPolicy>>(static_cast<int>(cfg.capacity));
+        return runOne<Item>(*b, cfg, items, arena);
+    }
+    auto b = make_unique<finite_buffer::RingBuffer<Item>>(cfg.capacity);
+    return runOne<Item>(*b, cfg, items, arena);
+}
+
+// Process CPU time (user + system) so far, in milliseconds
+double processCpuMs() {
+#if defined(__linux__)
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    auto ms = [](const timeval& t) { return static_cast<double>(t.tv_sec) * 1e3 + static_cast<double>(t.tv_usec) / 1e3; };
+    return ms(usage.ru_utime) + ms(usage.ru_stime);
+#else
+    return static_cast<double>(clock()) * 1e3 / CLOCKS_PER_SEC;
+#endif
+}
+
+struct StressResult {
+    double wall_ms = 0;
+    double cpu_ms = 0;
+    bool checksum_ok = false;
+};
+
+// --full-stress: the producers push total_items into buffer as fast as they can while the single
+// consumer sleeps sleep_us after every item, so the buffer stays full and the producers wait
+template <typename Buffer>
+StressResult runFullStress(Buffer& buffer, int producers, size_t total_items, int sleep_us) {
+    int64_t expected_sum = 0;
+    for (size_t v = 0; v < total_items; ++v) expected_sum += static_cast<int64_t>(v);
+    atomic<int64_t> next_value{0};
+    int64_t consumed_sum = 0;
+
+    double cpu_start = processCpuMs();
+    auto start = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            int64_t v;
+            while ((v = next_value.fetch_add(1)) < static_cast<int64_t>(total_items)) buffer.produce(v, p + 1);
+        });
+    }
+    threads.emplace_back([&]() {
+        for (size_t i = 0; i < total_items; ++i) {
+            consumed_sum += buffer.consume(1);
+            this_thread::sleep_for(chrono::microseconds(sleep_us));
+        }
+    });
+    for (auto& t : threads) t.join();
+
+    StressResult r;
+    r.wall_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    r.cpu_ms = processCpuMs() - cpu_start;
+    r.checksum_ok = (consumed_sum == expected_sum);
+    return r;
+}
+
+const vector<string> STRESS_BUFFERS = {"finite-list", "finite-ring", "shm-ring"};
+
+int runStress(const vector<string>& buffers, int producers, size_t capacity, size_t items, int sleep_us, double max_cpu_percent) {
+    cout << "buffer,producers,capacity,items,consume_sleep_us,wall_ms,cpu_ms,cpu_percent,checksum_ok\n";
+    bool failed = false;
+    for (const string& b : buffers) {
+        StressResult r;
+        if (b == "finite-list") {
+            auto buffer = make_unique<finite_buffer::LinkedListBuffer<int64_t>>(static_cast<int>(capacity));
+            r = runFullStress(*buffer, producers, items, sleep_us);
+        } else if (b == "finite-ring") {
+            auto buffer = make_unique<finite_buffer::RingBuffer<int64_t>>(capacity);
+            r = runFullStress(*buffer, producers, items, sleep_us);
+        } else {
+            auto buffer = finite_buffer::SharedRingBuffer<int64_t>::createAnonymous(capacity);
+            if (!buffer) {
+                cerr << "Cannot map shared memory for shm-ring\n";
+                return 1;
+            }
+            r = runFullStress(*buffer, producers, items, sleep_us);
+        }
+        double cpu_percent = r.wall_ms > 0 ? 100 * r.cpu_ms / r.wall_ms : 0;
+        cout << b << ',' << producers << ',' << capacity << ',' << items << ',' << sleep_us << ',' << r.wall_ms << ','
+             << r.cpu_ms << ',' << cpu_percent << ',' << (r.checksum_ok ? "true" : "false") << endl;
+        if (!r.checksum_ok || (max_cpu_percent > 0 && cpu_percent > max_cpu_percent)) {
+            cerr << b << ": " << (r.checksum_ok ? "CPU time above --max-cpu-percent" : "items lost") << "\n";
+            failed = true;
+        }
+    }
+    return failed ? 1 : 0;
+}
+
+const vector<string> ALL_BUFFERS = {"locked", "mcs", "spsc", "sharded", "numa", "priority", "hybrid", "segmented", "lock-free", "finite-list", "finite-spsc", "finite-ring",
+                                   "shm-ring", "ipc-ring"};
+const vector<size_t> SUPPORTED_PAYLOADS = {8, 64, 256, 4096, 16384, 65536};
+
+bool hasCapacity(const string& buffer) {
+    return buffer.rfind("finite-", 0) == 0 || buffer == "hybrid" || buffer == "shm-ring" || buffer == "ipc-ring";
+}
+
+bool isSpsc(const string& buffer) {
+    return buffer == "spsc" || buffer == "finite-spsc";
+}
+
+BenchResult runConfig(const BenchConfig& cfg, size_t items) {
+    if (cfg.zero_copy) {
+        // In flight at most: a full buffer, and one block being filled or read per thread
+        size_t blocks = cfg.arena_blocks ? cfg.arena_blocks : (cfg.capacity ? cfg.capacity : 1024) + cfg.producers + cfg.consumers;
+        PayloadArena arena(cfg.payload, blocks);
+        return runBuffer<PayloadRef>(cfg, items, &arena);
+    }
+    switch (cfg.payload) {
+        case 64: return runBuffer<Payload<64>>(cfg, items);
+        case 256: return runBuffer<Payload<256>>(cfg, items);
+        case 4096: return runBuffer<Payload<4096>>(cfg, items);
+        case 16384: return runBuffer<Payload<16384>>(cfg, items);
+        case 65536: return runBuffer<Payload<65536>>(cfg, items);
+        default: return runBuffer<int64_t>(cfg, items);
+    }
+}
+
+template <typename T>
+vector<T> parseList(const string& text, function<T(const string&)> convert) {
+    vector<T> values;
+    stringstream ss(text);
+    string part;
+    while (getline(ss, part, ',')) {
+        if (!part.empty()) values.push_back(convert(part));
+    }
+    return values;
+}
+
+void writeCsvHeader(ostream& out) {
+    out << "buffer,producers,consumers,capacity,payload_bytes,zero_copy,work_ns,items,seconds,ops_per_sec,"
+           "produce_p50_ns,produce_p99_ns,produce_p999_ns,consume_p50_ns,consume_p99_ns,consume_p999_ns,"
+           "produce_lock_wait_p99_ns,consume_lock_wait_p99_ns,checksum_ok\n";
+}
+
+void writeCsvRow(ostream& out, const BenchConfig& cfg, const BenchResult& r) {
+    out << cfg.buffer << ',' << cfg.producers << ',' << cfg.consumers << ',' << cfg.capacity << ','
+        << cfg.payload << ',' << (cfg.zero_copy ? "true" : "false") << ',' << cfg.work_ns << ',' << r.items << ',' << r.seconds << ','
+        << r.items / r.seconds << ','
+        << r.produce.p50_ns[END_TO_END] << ',' << r.produce.p99_ns[END_TO_END] << ',' << r.produce.p999_ns[END_TO_END] << ','
+        << r.consume.p50_ns[END_TO_END] << ',' << r.consume.p99_ns[END_TO_END] << ',' << r.consume.p999_ns[END_TO_END] << ','
+        << r.produce.p99_ns[LOCK_WAIT] << ',' << r.consume.p99_ns[LOCK_WAIT] << ','
+        << (r.checksum_ok ? "true" : "false") << '\n';
+}
+
+void writeJsonRow(ostream& out, const BenchConfig& cfg, const BenchResult& r, bool first) {
+    auto latency = [&](const LatencySummary& s) {
+        ostringstream o;
+        o << "{\"p50_ns\": " << s.p50_ns[END_TO_END] << ", \"p99_ns\": " << s.p99_ns[END_TO_END]
+          << ", \"p999_ns\": " << s.p999_ns[END_TO_END] << ", \"lock_wait_p99_ns\": " << s.p99_ns[LOCK_WAIT] << "}";
+        return o.str();
+    };
+    out << (first ? "  " : ",\n  ")
+        << "{\"buffer\": \"" << cfg.buffer << "\", \"producers\": " << cfg.producers
+        << ", \"consumers\": " << cfg.consumers << ", \"capacity\": " << cfg.capacity
+        << ", \"payload_bytes\": " << cfg.payload << ", \"zero_copy\": " << (cfg.zero_copy ? "true" : "false")
+        << ", \"work_ns\": " << cfg.work_ns
+        << ", \"items\": " << r.items << ", \"seconds\": " << r.seconds
+        << ", \"ops_per_sec\": " << r.items / r.seconds
+        << ", \"produce\": " << latency(r.produce) << ", \"consume\": " << latency(r.consume);
+    if (r.has_contention) {
+        out << ", \"contention\": ";
+        writeContentionJson(out, r.contention);
+    }
+    out << ", \"checksum_ok\": " << (r.checksum_ok ? "true" : "false") << "}";
+}
+
+int main(int argc, char* argv[]) {
+    vector<string> buffers = ALL_BUFFERS;
+    vector<int> producer_counts = {1, 2, 4};
+    vector<int> consumer_counts = {1, 2};
+    vector<size_t> capacities = {16, 1024};
+    vector<size_t> payloads = {8, 64, 256};
+    vector<int> work = {0, 1000};
+    vector<string> transports = {"copy"};
+    size_t arena_blocks = 0;
+    size_t items = 50000;
+    string format = "csv";
+    string out_path;
+    vector<int> producer_cpus;
+    vector<int> consumer_cpus;
+    bool full_stress = false;
+    bool producers_given = false, capacities_given = false, items_given = false, buffers_given = false;
+    int consume_sleep_us = 200;
+    double max_cpu_percent = 0;
+
+    auto toInt = [](const string& s) { return stoi(s); };
+    auto toSize = [](const string& s) { return static_cast<size_t>(stoull(s)); };
+    auto toString = [](const string& s) { return s; };
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool has_value = (i + 1 < argc);
+        if (arg == "--quick") {
+            producer_counts = {1, 2};
+            consumer_counts = {1};
+            capacities = {64};
+            payloads = {8};
+            work = {0};
+            items = 10000;
+        } else if (arg == "--full-stress") full_stress = true;
+        else if (has_value && arg == "--buffers") {
+            buffers = parseList<string>(argv[++i], toString);
+            buffers_given = true;
+        }
+        else if (has_value && arg == "--producers") {
+            producer_counts = parseList<int>(argv[++i], toInt);
+            producers_given = true;
+        }
+        else if (has_value && arg == "--consumers") consumer_counts = parseList<int>(argv[++i], toInt);
+        else if (has_value && arg == "--capacities") {
+            capacities = parseList<size_t>(argv[++i], toSize);
+            capacities_given = true;
+        }
+        else if (has_value && arg == "--payloads") payloads = parseList<size_t>(argv[++i], toSize);
+        else if (has_value && arg == "--work-ns") work = parseList<int>(argv[++i], toInt);
+        else if (has_value && arg == "--transports") transports = parseList<string>(argv[++i], toString);
+        else if (has_value && arg == "--arena-blocks") arena_blocks = toSize(argv[++i]);
+        else if (has_value && arg == "--items") {
+            items = toSize(argv[++i]);
+            items_given = true;
+        }
+        else if (has_value && arg == "--consume-sleep-us") consume_sleep_us = toInt(argv[++i]);
+        else if (has_value && arg == "--max-cpu-percent") max_cpu_percent = stod(argv[++i]);
+        else if (has_value && arg == "--format") format = argv[++i];
+        else if (has_value && arg == "--out") out_path = argv[++i];
+        else if (has_value && (arg == "--pin-producers" || arg == "--pin-consumers")) {
+            vector<int> cpus = NumaTopology::parseCpuList(argv[++i]);
+            if (cpus.empty()) {
+                cerr << "Invalid cpu list for " << arg << ": " << argv[i] << "\n";
+                return 1;
+            }
+            (arg == "--pin-producers" ? producer_cpus : consumer_cpus) = cpus;
+        }
+        else {
+            cerr << "Unknown or incomplete option: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    if (full_stress) {
+        vector<string> stress_buffers = buffers_given ? buffers : vector<string>{"finite-list"};
+        for (const string& b : stress_buffers) {
+            if (find(STRESS_BUFFERS.begin(), STRESS_BUFFERS.end(), b) == STRESS_BUFFERS.end()) {
+                cerr << "--full-stress runs finite-list, finite-ring and shm-ring, not " << b << "\n";
+                return 1;
+            }
+        }
+        int producers = producers_given && !producer_counts.empty() ? producer_counts.front() : 8;
+        size_t capacity = capacities_given && !capacities.empty() ? capacities.front() : 4;
+        if (producers < 1 || capacity < 1 || consume_sleep_us < 0) {
+            cerr << "--full-stress needs at least one producer and one slot\n";
+            return 1;
+        }
+        return runStress(stress_buffers, producers, capacity, items_given ? items : 2000, consume_sleep_us, max_cpu_percent);
+    }
+
+    for (const string& b : buffers) {
+        if (find(ALL_BUFFERS.begin(), ALL_BUFFERS.end(), b) == ALL_BUFFERS.end()) {
+            cerr << "Unknown buffer: " << b << "\n";
+            return 1;
+        }
+    }
+    for (size_t p : payloads) {
+        if (find(SUPPORTED_PAYLOADS.begin(), SUPPORTED_PAYLOADS.end(), p) == SUPPORTED_PAYLOADS.end()) {
+            cerr << "Unsupported payload size: " << p << " (supported: 8, 64, 256, 4096, 16384, 65536)\n";
+            return 1;
+        }
+    }
+    for (const string& t : transports) {
+        if (t != "copy" && t != "zero-copy") {
+            cerr << "Unknown transport: " << t << " (copy or zero-copy)\n";
+            return 1;
+        }
+    }
+    if (format != "csv" && format != "json") {
+        cerr << "Unknown format: " << format << "\n";
+        return 1;
+    }
+    if (!BUFFER_INSTRUMENTATION) cerr << "Note: built with BUFFER_INSTRUMENTATION=0, latency columns will be 0\n";
+
+    ofstream file;
+    if (!out_path.empty()) {
+        file.open(out_path);
+        if (!file) {
+            cerr << "Cannot open " << out_path << "\n";
+            return 1;
+        }
+    }
+    ostream& out = out_path.empty() ? cout : file;
+
+    if (format == "csv") writeCsvHeader(out);
+    else out << "[\n";
+
+    bool first = true;
+    for (const string& b : buffers) {
+        // The unbounded buffers have no capacity to sweep, except the hybrid buffer's ring
+        vector<size_t> buffer_capacities = hasCapacity(b) ? capacities : vector<size_t>{0};
+        for (int producers : producer_counts)
+        for (int consumers : consumer_counts)
+        for (size_t capacity : buffer_capacities)
+        for (size_t payload : payloads)
+        for (const string& transport : transports)
+        for (int work_ns : work) {
+            if (isSpsc(b) && (producers != 1 || consumers != 1)) continue;
+            bool zero_copy = (transport == "zero-copy");
+            // The arena is private to this process
+            if (b == "ipc-ring" && zero_copy) continue;
+            BenchConfig cfg{b, producers, consumers, capacity, payload, zero_copy, arena_blocks, work_ns, producer_cpus, consumer_cpus};
+            cerr << "Running " << b << " P=" << producers << " C=" << consumers << " capacity=" << capacity
+                 << " payload=" << payload << "B " << transport << " work=" << work_ns << "ns\n";
+            BenchResult r = runConfig(cfg, items);
+            if (format == "csv") writeCsvRow(out, cfg, r);
+            else writeJsonRow(out, cfg, r, first);
+            out.flush();
+            first = false;
+        }
+    }
+
+    if (format == "json") out << "\n]\n";
+    return 0;
+}
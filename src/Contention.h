@@ -0,0 +1,260 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Instrumentation.h"
+#include "Locks.h"
+#include "Platform.h"
+
+// Contention profile of a buffer: where its threads wait, for how long, and how quickly a waiting
+// consumer wakes once a producer has published.
+//
+// A buffer names its wait sites (its locks and the conditions it waits for) and records every
+// acquisition or wait at one of them with a LockWait: whether it had to wait at all, how long it spun
+// and how long it slept. Waits on a std::mutex count as parked, since the mutex sleeps in the kernel.
+// The side that makes a condition true calls notified() when somebody is waiting for it; a waiter that
+// slept then records the hand-off latency, from the latest such notification to its wake-up.
+//
+// Like BufferStats, every thread records into its own counters without a lock, and everything compiles
+// out with BUFFER_INSTRUMENTATION=0 (report() is then empty). report() breaks the totals down by site
+// and by thread, under the name given to labelThread() (the drivers use "Producer 0", "Consumer 1", ...):
+//
+//     ContentionReport report = buffer.contention();
+//     printContention(std::cout, report);                  // table, as in the drivers' analysis
+//     writeContentionJson(file, report);                   // the drivers' --contention FILE
+//     writeContentionFolded(file, report, "FiniteBuffer"); // flame graph input (--contention-folded)
+
+// The name under which the calling thread shows up in contention reports; "thread N" by default
+inline std::string& threadLabel() {
+    static std::atomic<int> next_thread{0};
+    thread_local std::string label;
+    if (label.empty()) label = "thread " + std::to_string(next_thread.fetch_add(1, std::memory_order_relaxed));
+    return label;
+}
+
+inline void labelThread(std::string name) {
+    threadLabel() = std::move(name);
+}
+
+// Totals of one wait site, overall or for one thread; times in nanoseconds
+struct ContentionRow {
+    std::string site;
+    std::string thread;         // empty in the per-site totals
+    uint64_t acquisitions = 0;
+    uint64_t contended = 0;     // acquisitions that had to wait
+    uint64_t parks = 0;         // times a waiter went to sleep
+    double spin_ns = 0;
+    double parked_ns = 0;
+    uint64_t handoffs = 0;      // wake-ups that followed a notification
+    double handoff_p50_ns = 0;
+    double handoff_p99_ns = 0;
+};
+
+struct ContentionReport {
+    std::vector<ContentionRow> sites;
+    std::vector<ContentionRow> threads;     // per thread and site, sites the thread never used left out
+};
+
+class ContentionProfile {
+public:
+    static constexpr size_t MAX_SITES = 6;
+
+    // One name per wait site; the site indices follow their order
+    ContentionProfile(std::initializer_list<const char*> site_names) {
+        for (const char* name : site_names) {
+            if (site_count == MAX_SITES) break;
+            names[site_count++] = name;
+        }
+    }
+
+    // Records one acquisition of (or wait at) site
+    void record(size_t site, const LockWait& wait) {
+#if BUFFER_INSTRUMENTATION
+        SiteCounters& c = threads.local().sites[site];
+        bump(c.acquisitions, 1);
+        if (!wait.contended) return;
+        bump(c.contended, 1);
+        bump(c.spin_ticks, wait.spin_ticks);
+        if (wait.parks == 0) return;
+        bump(c.parks, wait.parks);
+        bump(c.park_ticks, wait.park_ticks);
+        // Only a notification that came while this thread slept can have woken it
+        uint64_t notify = notify_at[site].load(std::memory_order_relaxed);
+        if (notify >= wait.last_park && notify <= wait.woke_at) {
+            bump(c.handoffs, 1);
+            c.handoff.record(wait.woke_at - notify);
+        }
+#else
+        (void)site;
+        (void)wait;
+#endif
+    }
+
+    // Locks m, recording the acquisition at site
+    std::unique_lock<std::mutex> lock(size_t site, std::mutex& m) {
+        LockWait wait;
+        if (!m.try_lock()) {
+            wait.spinning();
+            wait.parking();
+            m.lock();
+            wait.unparked();
+        }
+        record(site, wait);
+        return std::unique_lock<std::mutex>(m, std::adopt_lock);
+    }
+
+    // The condition waited for at site has just been made true for a waiting thread
+    void notified(size_t site) {
+#if BUFFER_INSTRUMENTATION
+        notify_at[site].store(CycleClock::now(), std::memory_order_relaxed);
+#else
+        (void)site;
+#endif
+    }
+
+    ContentionReport report() {
+        ContentionReport report;
+        double ns_per_tick = CycleClock::nsPerTick();
+        ContentionRow totals[MAX_SITES];
+        std::vector<uint64_t> handoffs[MAX_SITES];
+        threads.forEach([&](const ThreadRecord& t) {
+            for (size_t i = 0; i < site_count; ++i) {
+                const SiteCounters& c = t.sites[i];
+                ContentionRow row;
+                row.site = names[i];
+                row.thread = t.label;
+                row.acquisitions = c.acquisitions.load(std::memory_order_relaxed);
+                if (row.acquisitions == 0) continue;
+                row.contended = c.contended.load(std::memory_order_relaxed);
+                row.parks = c.parks.load(std::memory_order_relaxed);
+                row.spin_ns = static_cast<double>(c.spin_ticks.load(std::memory_order_relaxed)) * ns_per_tick;
+                row.parked_ns = static_cast<double>(c.park_ticks.load(std::memory_order_relaxed)) * ns_per_tick;
+                row.handoffs = c.handoffs.load(std::memory_order_relaxed);
+                std::vector<uint64_t> counts;
+                c.handoff.addTo(counts);
+                c.handoff.addTo(handoffs[i]);
+                row.handoff_p50_ns = LatencyHistogram::percentile(counts, 0.50) * ns_per_tick;
+                row.handoff_p99_ns = LatencyHistogram::percentile(counts, 0.99) * ns_per_tick;
+
+                ContentionRow& total = totals[i];
+                total.acquisitions += row.acquisitions;
+                total.contended += row.contended;
+                total.parks += row.parks;
+                total.spin_ns += row.spin_ns;
+                total.parked_ns += row.parked_ns;
+                total.handoffs += row.handoffs;
+                report.threads.push_back(std::move(row));
+            }
+        });
+        for (size_t i = 0; i < site_count; ++i) {
+            ContentionRow& total = totals[i];
+            if (total.acquisitions == 0) continue;
+            total.site = names[i];
+            total.handoff_p50_ns = LatencyHistogram::percentile(handoffs[i], 0.50) * ns_per_tick;
+            total.handoff_p99_ns = LatencyHistogram::percentile(handoffs[i], 0.99) * ns_per_tick;
+            report.sites.push_back(std::move(total));
+        }
+        return report;
+    }
+
+private:
+    struct SiteCounters {
+        std::atomic<uint64_t> acquisitions{0};
+        std::atomic<uint64_t> contended{0};
+        std::atomic<uint64_t> parks{0};
+        std::atomic<uint64_t> spin_ticks{0};
+        std::atomic<uint64_t> park_ticks{0};
+        std::atomic<uint64_t> handoffs{0};
+        LatencyHistogram handoff;       // ticks from the notification to the wake-up
+    };
+
+    struct alignas(CACHE_LINE_SIZE) ThreadRecord {
+        std::string label = threadLabel();
+        SiteCounters sites[MAX_SITES];
+    };
+
+    const char* names[MAX_SITES] = {};
+    size_t site_count = 0;
+    ThreadRecords<ThreadRecord> threads;
+    // CycleClock ticks of the latest notification per site
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> notify_at[MAX_SITES] = {};
+
+    static void bump(std::atomic<uint64_t>& counter, uint64_t by) {
+        counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+};
+
+// Per-site table with the busiest thread rows under it, for the drivers' analysis
+inline void printContention(std::ostream& out, const ContentionReport& report) {
+#if BUFFER_INSTRUMENTATION
+    auto line = [&](const ContentionRow& r, const std::string& name) {
+        out << "  " << name << " : " << r.acquisitions << " acquisitions, " << r.contended << " contended, spin "
+            << r.spin_ns / 1000 << " us, parked " << r.parked_ns / 1000 << " us (" << r.parks << " parks)";
+        if (r.handoffs) out << ", hand-off p50 / p99 " << r.handoff_p50_ns / 1000 << " / " << r.handoff_p99_ns / 1000 << " us";
+        out << "\n";
+    };
+    for (const ContentionRow& site : report.sites) {
+        line(site, site.site);
+        for (const ContentionRow& t : report.threads) {
+            if (t.site == site.site && t.contended) line(t, "    " + t.thread);
+        }
+    }
+#else
+    (void)report;
+    out << "  instrumentation disabled (built with BUFFER_INSTRUMENTATION=0)\n";
+#endif
+}
+
+// {"sites": [...], "threads": [...]}, one object per row; for the drivers' --contention and the benchmark
+inline void writeContentionJson(std::ostream& out, const ContentionReport& report) {
+    auto text = [&](const std::string& s) {
+        out << '"';
+        for (char c : s) {
+            if (c == '"' || c == '\\') out << '\\';
+            out << c;
+        }
+        out << '"';
+    };
+    // Whole nanoseconds, whatever the stream's floating-point format
+    auto ns = [](double v) { return static_cast<uint64_t>(v); };
+    auto rows = [&](const std::vector<ContentionRow>& list, bool with_thread) {
+        out << '[';
+        for (size_t i = 0; i < list.size(); ++i) {
+            const ContentionRow& r = list[i];
+            out << (i ? ", " : "") << "{\"site\": ";
+            text(r.site);
+            if (with_thread) {
+                out << ", \"thread\": ";
+                text(r.thread);
+            }
+            out << ", \"acquisitions\": " << r.acquisitions << ", \"contended\": " << r.contended
+                << ", \"parks\": " << r.parks << ", \"spin_ns\": " << ns(r.spin_ns) << ", \"parked_ns\": " << ns(r.parked_ns)
+                << ", \"handoffs\": " << r.handoffs << ", \"handoff_p50_ns\": " << ns(r.handoff_p50_ns)
+                << ", \"handoff_p99_ns\": " << ns(r.handoff_p99_ns) << '}';
+        }
+        out << ']';
+    };
+    out << "{\"sites\": ";
+    rows(report.sites, false);
+    out << ", \"threads\": ";
+    rows(report.threads, true);
+    out << '}';
+}
+
+// Folded stacks (root;thread;site;spin|parked nanoseconds), the input of flamegraph.pl and speedscope
+inline void writeContentionFolded(std::ostream& out, const ContentionReport& report, const std::string& root) {
+    for (const ContentionRow& r : report.threads) {
+        auto frame = [&](const char* state, double ns) {
+            if (ns >= 1) out << root << ';' << r.thread << ';' << r.site << ';' << state << ' ' << static_cast<uint64_t>(ns) << '\n';
+        };
+        frame("spin", r.spin_ns);
+        frame("parked", r.parked_ns);
+    }
+}
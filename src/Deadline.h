@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+// How long a waiting buffer operation may wait.
+//
+// The blocking produce()/consume() wait with forever(): it never runs out and a close() does not end
+// it, since those calls have no way to report that they gave up. try_produce()/try_consume() wait
+// with none(), which has run out before the operation starts, and the _for/_until operations with a
+// steady_clock time point. Both of those also give up once the buffer is closed.
+class WaitDeadline {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static WaitDeadline forever() {
+        return WaitDeadline(Clock::time_point::max(), false);
+    }
+
+    static WaitDeadline none() {
+        return WaitDeadline(Clock::time_point::min(), true);
+    }
+
+    static WaitDeadline at(Clock::time_point time) {
+        return WaitDeadline(time, true);
+    }
+
+    // Timeouts too long to add to now() wait without a time limit
+    template <typename Rep, typename Period>
+    static WaitDeadline after(const std::chrono::duration<Rep, Period>& timeout) {
+        Clock::time_point now = Clock::now();
+        if (std::chrono::duration<double>(timeout) >= std::chrono::duration<double>(Clock::time_point::max() - now))
+            return at(Clock::time_point::max());
+        return at(now + std::chrono::ceil<Clock::duration>(timeout));
+    }
+
+    Clock::time_point time() const {
+        return deadline;
+    }
+
+    // Everything but forever(): these operations fail once the buffer is closed
+    bool endsOnClose() const {
+        return ends_on_close;
+    }
+
+    // No time limit: forever(), or at() the largest time point. Waits on those need no timer.
+    bool unbounded() const {
+        return deadline == Clock::time_point::max();
+    }
+
+    // Has the wait run out: the deadline has passed, or closed is set and this is not forever()?
+    // Reads the clock only for a real time limit.
+    bool passed(const std::atomic<bool>& closed) const {
+        if (ends_on_close && closed.load(std::memory_order_seq_cst)) return true;
+        return passed();
+    }
+
+    // The time limit alone, for waits on something that cannot be closed
+    bool passed() const {
+        if (unbounded()) return false;
+        return deadline == Clock::time_point::min() || Clock::now() >= deadline;
+    }
+
+private:
+    Clock::time_point deadline;
+    bool ends_on_close;
+
+    WaitDeadline(Clock::time_point time, bool stop_on_close) : deadline(time), ends_on_close(stop_on_close) {}
+};
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Topology.h"
+
+// Run parameters of the two drivers, from the command line and optionally a config file.
+//
+// Every option is --key value (or just --key for switches). --config FILE reads the same keys as
+// "key = value" lines, '#' starts a comment; options later on the command line override the file.
+//
+//   --buffer NAME            buffer to run (each driver lists its own; --NAME is a shorthand)
+//   --producers N            producer threads                          (default 5)
+//   --consumers N            consumer threads                          (default 3)
+//   --items N                items per producer                        (default 30)
+//   --produce-sleep-ms N     simulated work before each produce        (default 10)
+//   --consume-sleep-ms N     simulated work after each consume         (default 18)
+//   --capacity N             bounded buffers, hybrid ring              (default 10)
+//   --segment-size N         slots per segment of the segmented buffer (default 256)
+//   --pin-producers CPUS     pin producer i to the i-th cpu of a list such as 0-3,8 (wrapping around)
+//   --pin-consumers CPUS     the same for the consumers                (default: not pinned)
+//   --lanes N                lanes of the priority buffer; producer p uses lane (p - 1) % N (default 3)
+//   --lane-policy NAME       strict or weighted                        (default strict)
+//   --lane-weights LIST      weighted: items per turn of each lane, e.g. 4,2,1 (default 1 each)
+//   --starvation-budget N    strict: serve a lane passed over N times  (default 0, never)
+//   --overflow NAME          finite buffers when full: block, drop-newest, drop-oldest (ring only)
+//                            or callback                               (default block)
+//   --headless               skip the Visualizer
+//   --speed X                Visualizer playback speed, 1 = the default pace  (default 1)
+//   --replay FILE            only show the Visualizer for the trace of an earlier --trace run
+//   --contention FILE        write the linked list buffers' contention report as JSON
+//   --contention-folded FILE the same as folded stacks for a flame graph
+//   --trace, --binary-log, --mmap-log, --monitor
+
+struct DriverConfig {
+    std::string buffer;
+    int producers = 5;
+    int consumers = 3;
+    int items_per_producer = 30;
+    int produce_sleep_ms = 10;
+    int consume_sleep_ms = 18;
+    size_t capacity = 10;
+    size_t segment_size = 256;
+    std::vector<int> producer_cpus;
+    std::vector<int> consumer_cpus;
+    size_t lanes = 3;
+    std::string lane_policy = "strict";
+    std::vector<uint32_t> lane_weights;
+    uint32_t starvation_budget = 0;
+    std::string overflow = "block";
+    bool headless = false;
+    double speed = 1;
+    std::string replay;
+    std::string contention;
+    std::string contention_folded;
+    bool trace = false;
+    bool binary_log = false;
+    bool mmap_log = false;
+    bool monitor = false;
+};
+
+namespace config_detail {
+
+inline bool isSwitch(const std::string& key) {
+    return key == "headless" || key == "trace" || key == "binary-log" || key == "mmap-log" || key == "monitor";
+}
+
+inline bool takesValue(const std::string& key) {
+    static const std::vector<std::string> keys = {"config", "buffer", "producers", "consumers", "items",
+                                                  "produce-sleep-ms", "consume-sleep-ms", "capacity",
+                                                  "segment-size", "pin-producers", "pin-consumers", "lanes",
+                                                  "lane-policy", "lane-weights", "starvation-budget", "overflow",
+                                                  "speed", "replay", "contention", "contention-folded"};
+    return std::find(keys.begin(), keys.end(), key) != keys.end();
+}
+
+inline bool applyOption(DriverConfig& cfg, const std::vector<std::string>& buffers, const std::string& key,
+                        const std::string& value, std::string& error) {
+    try {
+        if (key == "buffer") {
+            if (std::find(buffers.begin(), buffers.end(), value) == buffers.end()) {
+                error = "unknown buffer '" + value + "'";
+                return false;
+            }
+            cfg.buffer = value;
+        }
+        else if (key == "producers") cfg.producers = std::stoi(value);
+        else if (key == "consumers") cfg.consumers = std::stoi(value);
+        else if (key == "items") cfg.items_per_producer = std::stoi(value);
+        else if (key == "produce-sleep-ms") cfg.produce_sleep_ms = std::stoi(value);
+        else if (key == "consume-sleep-ms") cfg.consume_sleep_ms = std::stoi(value);
+        else if (key == "capacity") cfg.capacity = std::stoul(value);
+        else if (key == "segment-size") cfg.segment_size = std::stoul(value);
+        else if (key == "pin-producers" || key == "pin-consumers") {
+            std::vector<int> cpus = NumaTopology::parseCpuList(value);
+            if (cpus.empty()) {
+                error = "invalid cpu list '" + value + "' for " + key;
+                return false;
+            }
+            (key == "pin-producers" ? cfg.producer_cpus : cfg.consumer_cpus) = cpus;
+        }
+        else if (key == "lanes") cfg.lanes = std::stoul(value);
+        else if (key == "lane-policy") {
+            if (value != "strict" && value != "weighted") {
+                error = "unknown lane policy '" + value + "' (strict or weighted)";
+                return false;
+            }
+            cfg.lane_policy = value;
+        }
+        else if (key == "lane-weights") {
+            cfg.lane_weights.clear();
+            size_t pos = 0;
+            while (pos <= value.size()) {
+                size_t comma = std::min(value.find(',', pos), value.size());
+                cfg.lane_weights.push_back(static_cast<uint32_t>(std::stoul(value.substr(pos, comma - pos))));
+                pos = comma + 1;
+            }
+        }
+        else if (key == "overflow") {
+            if (value != "block" && value != "drop-newest" && value != "drop-oldest" && value != "callback") {
+                error = "unknown overflow policy '" + value + "' (block, drop-newest, drop-oldest or callback)";
+                return false;
+            }
+            cfg.overflow = value;
+        }
+        else if (key == "starvation-budget") cfg.starvation_budget = static_cast<uint32_t>(std::stoul(value));
+        else if (key == "speed") cfg.speed = std::stod(value);
+        else if (key == "replay") cfg.replay = value;
+        else if (key == "contention") cfg.contention = value;
+        else if (key == "contention-folded") cfg.contention_folded = value;
+        else if (isSwitch(key)) {
+            bool on = value.empty() || value == "1" || value == "true" || value == "yes";
+            if (key == "headless") cfg.headless = on;
+            else if (key == "trace") cfg.trace = on;
+            else if (key == "binary-log") cfg.binary_log = on;
+            else if (key == "mmap-log") cfg.mmap_log = on;
+            else cfg.monitor = on;
+        }
+        else {
+            error = "unknown option '" + key + "'";
+            return false;
+        }
+    } catch (const std::exception&) {
+        error = "invalid value '" + value + "' for " + key;
+        return false;
+    }
+    return true;
+}
+
+inline std::string trim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t\r");
+    return s.substr(begin, end - begin + 1);
+}
+
+inline bool loadConfigFile(DriverConfig& cfg, const std::vector<std::string>& buffers, const std::string& path, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open config file '" + path + "'";
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+        size_t eq = line.find('=');
+        std::string key = trim(line.substr(0, eq));
+        std::string value = eq == std::string::npos ? "" : trim(line.substr(eq + 1));
+        if (!applyOption(cfg, buffers, key, value, error)) return false;
+    }
+    return true;
+}
+
+} // namespace config_detail
+
+// Parses argv into cfg. buffers lists the buffer names the driver accepts; the first is the default.
+// Prints the problem and returns false on a bad option.
+inline bool parseDriverConfig(int argc, char* argv[], const std::vector<std::string>& buffers, DriverConfig& cfg) {
+    cfg.buffer = buffers.front();
+    std::string error;
+    for (int i = 1; i < argc && error.empty(); ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            error = "unexpected argument '" + arg + "'";
+            break;
+        }
+        std::string key = arg.substr(2);
+        if (std::find(buffers.begin(), buffers.end(), key) != buffers.end()) {
+            cfg.buffer = key;       // --lock-free, --ring, ...
+        } else if (config_detail::takesValue(key)) {
+            if (i + 1 >= argc) {
+                error = "missing value for " + arg;
+                break;
+            }
+            std::string value = argv[++i];
+            if (key == "config") config_detail::loadConfigFile(cfg, buffers, value, error);
+            else config_detail::applyOption(cfg, buffers, key, value, error);
+        } else {
+            config_detail::applyOption(cfg, buffers, key, "", error);
+        }
+    }
+    if (error.empty() && (cfg.producers < 1 || cfg.consumers < 1 || cfg.items_per_producer < 0 || cfg.capacity < 1 ||
+                           cfg.segment_size < 1 || cfg.lanes < 1))
+        error = "producers, consumers, capacity, segment size and lanes must be at least 1";
+    if (error.empty() && !(cfg.speed > 0)) error = "speed must be positive";
+    if (!error.empty()) {
+        std::cerr << "error: " << error << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Pins the calling thread, the index-th (from 0) of its role, to its cpu from a --pin-* list. Without a
+// list the thread is left to the scheduler; a cpu the system refuses is reported and skipped.
+inline void pinDriverThread(const std::vector<int>& cpus, int index) {
+    if (cpus.empty()) return;
+    int cpu = cpus[static_cast<size_t>(index) % cpus.size()];
+    if (!pinCurrentThread(cpu)) std::cerr << "warning: cannot pin thread to cpu " << cpu << "\n";
+}
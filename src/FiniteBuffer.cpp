@@ -11,221 +11,35 @@
 #include <SFML/Graphics.hpp>
 #include <SFML/System.hpp>
 #include <atomic>
+#include <span>
 #include <bits/stdc++.h>
+#include "FiniteBuffer.h"
+#include "LogAnalyzer.h"
+#include "TraceFile.h"
+#include "TracePlayback.h"
+#include "NodeBatch.h"
+#include "DriverConfig.h"
 using namespace std;
+using namespace finite_buffer;
+using namespace log_analyzer;
 
-// Each node contains the data to be stored in it, a flag indicating whehter full or empty and a pointer to the next node.
-struct Node {
-    int data;
-    bool filled;
-    Node* next;
-    Node() : data(0), filled(false), next(nullptr) {}
-};
-
-// Custom made ticket lock
-
-// This lock helps in introducing fairness in the synchronization process as 
-// each producer/consumer is given a ticket value and is served in FIFO order
-class TicketLock {
-    private:
-        atomic<int> next_ticket{0};
-        atomic<int> now_serving{0};
-    
-    public:
-        void lock() {
-            int my_ticket = next_ticket.fetch_add(1);
-            while (now_serving.load() != my_ticket) {
-                this_thread::yield();  // Yield CPU to reduce contention
-            }
-        }
-    
-        void unlock() {
-            now_serving.fetch_add(1);
-        }
-
-    };
-
-
-// -------------------- Linked List Buffer --------------------
-class LinkedListBuffer {
-private:
-    Node* head; // Producer writes at the head end
-    Node* tail; // Consumer reads at the tail end
-    const int BUFFER_SIZE = 10; // Fixed buffer size
-
-    TicketLock ticket_lock_producer;
-    mutex mutex_producer;       
-    mutex mutex_consumer;      
-    condition_variable cv_not_empty;       
-    condition_variable cv_not_full;      
-
-    mutex prod_stat_mutex;   
-    mutex cons_stat_mutex;
-
-    chrono::duration<double> total_produce_time{};     
-    chrono::duration<double> total_consume_time{};   
-
-    chrono::steady_clock::time_point start_time;     
-
-public:
-// Implementing circular linked list to implement finite fixed buffer
-    LinkedListBuffer() {
-        Node* first = new Node();   
-        Node* current = first;
-        
-        for(int i = 1; i < BUFFER_SIZE; ++i) {
-            current->next = new Node();
-            current = current->next;   
-        }
-        current->next = first;     
-        
-        head = first;   
-        tail = first; =
-        start_time = chrono::steady_clock::now();  
-    }
-
-    void produce(int item, int producer_id) {
-        auto request_lock_time = chrono::steady_clock::now();  
-        
-        // Acquiring ticket lock to ensure fair synchronization
-        ticket_lock_producer.lock();
-        
-        unique_lock<mutex> lock(mutex_producer);                  
-
-        // Wait until the node at head is free to be filled
-        cv_not_full.wait(lock, [this] { return !head->filled; });
-
-        auto acquired_lock_time = chrono::steady_clock::now();  
-        
-
-        auto wait_duration = acquired_lock_time - request_lock_time;
-
-
-        head->data = item;
-        Node* temp = head->next;
-        head->filled = true;
-        head = temp; 
-
- 
-        auto now = chrono::steady_clock::now();
-        long long timestamp = chrono::duration_cast<chrono::microseconds>(now - start_time).count();
-
-        double waited_ms = chrono::duration_cast<chrono::duration<double, milli>>(wait_duration).count();
-
-        // Logging
-        logEvent("[" + to_string(timestamp) + "us] Producer "+ to_string(producer_id)+" waited for "+to_string(waited_ms)+"ms and produced: "+to_string(item));
-
-        // Releasing the producer lock 
-        lock.unlock();
-        // Notifying one of the waiting consumer threads
-        cv_not_empty.notify_one();
-
-        ticket_lock_producer.unlock();
-
-        auto end = chrono::steady_clock::now();
-
-        lock_guard<mutex> stats_lock(prod_stat_mutex);
-        total_produce_time += ((end - request_lock_time));
-    }
-
-    int consume(int consumer_id) {
-        auto request_lock_time = chrono::steady_clock::now();
-
-        // First consumer acquires lock to ensure synchronization
-        unique_lock<mutex> lock(mutex_consumer);
-
-        cv_not_empty.wait(lock, [this] { return tail->filled; });
-        auto acquired_lock_time = chrono::steady_clock::now();
-.
-        auto wait_duration = acquired_lock_time - request_lock_time;
-
-        // Consuming the current data
-        int item = tail->data;
-        tail->filled = false;
-        
-        auto now = chrono::steady_clock::now();
-        long long timestamp = chrono::duration_cast<chrono::microseconds>(now - start_time).count();
-
-        double waited_ms = chrono::duration_cast<chrono::duration<double, milli>>(wait_duration).count();
-
-        // Logging
-        logEvent("[" + to_string(timestamp) + "us] Consumer " + to_string(consumer_id)+" waited for "+to_string(waited_ms)+"ms and consumed: "+to_string(item));
-
-        Node* temp = tail;
-        tail = tail->next; 
-
-        // Unlocking the buffer so other consumers can proceed
-        lock.unlock();
-        // Notifying producers that space is available
-        cv_not_full.notify_one();
-
-        auto end = chrono::steady_clock::now();
-        lock_guard<mutex> stats_lock(cons_stat_mutex);
-        total_consume_time += (end - request_lock_time);
-
-        return item;
-    }
-
-    vector<double> Stats() {
-        vector<double> time_stat;
-        time_stat.push_back(total_produce_time.count());
-        time_stat.push_back(total_consume_time.count());
-        return time_stat;
-    }
-
-private:
-    static mutex log_mutex;
-
-    static void logEvent(const string& event) {
-   
-        lock_guard<mutex> lock(log_mutex);
-        ofstream logFile("FiniteBufferLogger.txt", ios::app);
-        logFile << event << endl;
-    }
-};
-
-struct LogEvent {
-    long long timestamp;        
-    string type; // Producer or Consumer entry
-    int id;     // ID of the producer or consumer thread
-    int value; 
-};
-
-// Visualizer
+// Visualizer replays a trace of the run
 class Visualizer {
     sf::View view;      
     float scrollOffset = 0.0f;  
-private:
-    vector<LogEvent> events;  
-
-    void parseLogs() {
-        ifstream in("FiniteBufferLogger.txt");
-        string line;
-
-        while (getline(in, line)) {
-            LogEvent e;
-
-            size_t ts_start = line.find('[');
-            size_t ts_end = line.find("us]");
-
-            if (ts_start == string::npos || ts_end == string::npos) continue;
-
-            string ts_str = line.substr(ts_start + 1, ts_end - ts_start - 1);
-            e.timestamp = stoll(ts_str);    
-            if (line.find("Producer") != string::npos) {
-                e.type = "Producer";
-                sscanf(line.c_str(), "[%*lldus] Producer %d produced: %d", &e.id, &e.value);
-            } else if (line.find("Consumer") != string::npos) {
-                e.type = "Consumer";
-                sscanf(line.c_str(), "[%*lldus] Consumer %d consumed: %d", &e.id, &e.value);
-            }
-            events.push_back(e);
-        }
-    }
+    string trace_path;
+    double speed;
 
 public:
+    Visualizer(string path, double playback_speed) : trace_path(std::move(path)), speed(playback_speed) {}
+
 void run() {
-    parseLogs();
+    // The trace is mapped, not parsed, so any run opens at once
+    TraceFile trace(trace_path);
+    if (!trace.isOpen()) {
+        cerr << "error: cannot read trace '" << trace_path << "' (record one with --trace)\n";
+        return;
+    }
 
     // Constants for visualizing nodes
     const int NODE_RADIUS = 25;
@@ -233,12 +47,27 @@ void run() {
     const int WINDOW_WIDTH = 1400;
     const int WINDOW_HEIGHT = 600;
 
+    // One row of slots; a produced node takes the next slot and replaces (reclaims) the node drawn there
+    const float first_x = 50, first_y = 100;
+    const float max_x = 1000;
+    const float column_width = NODE_RADIUS * 2 + NODE_SPACING;
+    const size_t slot_count = static_cast<size_t>((max_x - first_x) / column_width) + 1;
+
     // Creating the window for rendering
     sf::RenderWindow window(sf::VideoMode(WINDOW_WIDTH, WINDOW_HEIGHT), "Finite Buffer Producer-Consumer Visualisation");
     sf::Font font;
     font.loadFromFile("arial.ttf");
 
-    vector<pair<sf::CircleShape, sf::Text>> nodes;
+    struct VisSlot {
+        int value = 0;
+        bool used = false;
+        bool consumed = false;
+        size_t seq = 0;     // Production order, so that a repeated value is consumed oldest first
+    };
+    vector<VisSlot> slots(slot_count);
+    size_t produced = 0;
+    NodeBatch batch(font, 16);
+    bool dirty = true;      // The batch is only rebuilt when the slots or the view changed
 
     // FPS Display Setup
     sf::Clock fpsClock;
@@ -250,81 +79,104 @@ void run() {
     fpsText.setFillColor(sf::Color::White);
     fpsText.setPosition(10, 10);
 
-    if (events.empty()) return;  
-    long long startTime = events[0].timestamp; 
-    const float TIME_SCALE = 0.0003f; 
+    if (trace.size() == 0) return;  
+    const double PACE_NS = 1e9 / 300;       // Trace nanoseconds played per second at --speed 1
+    const size_t REPLAY_LIMIT = 1 << 16;    // Larger steps forward rebuild the slots instead of replaying every record
+    TracePlayback playback(trace, PACE_NS, speed);
+    size_t applied = 0;     // The slots show the first `applied` records of the trace
+
+    auto apply = [&](const LogRecord& r) {
+        int value = static_cast<int>(r.value);
+        if (r.role == LogRole::Producer) {
+            slots[produced % slot_count] = {value, true, false, produced};
+            produced++;
+        } 
+        else {
+            // There are only slot_count slots, so scanning them is constant time
+            VisSlot* oldest = nullptr;
+            for (auto& slot : slots) {
+                if (slot.used && !slot.consumed && slot.value == value && (!oldest || slot.seq < oldest->seq))
+                    oldest = &slot;
+            }
+            if (oldest) oldest->consumed = true;
+        }
+    };
 
-    sf::Clock globalClock;
-    size_t current = 0;  
+    // Rebuilds the slots as they stood after the first `to` records: only the last slot_count
+    // produced nodes can still be drawn, so only the records from the oldest of them on are replayed
+    auto rebuild = [&](size_t to) {
+        slots.assign(slot_count, VisSlot{});
+        uint64_t before = trace.producedBefore(to);
+        uint64_t shown = min<uint64_t>(before, slot_count);
+        produced = static_cast<size_t>(before - shown);
+        for (size_t i = shown ? trace.producerRecord(produced) : to; i < to; ++i) apply(trace[i]);
+        applied = to;
+    };
 
     view = window.getDefaultView();     
 
+    auto slotPosition = [&](size_t i) {
+        return sf::Vector2f(first_x + static_cast<float>(i) * column_width, first_y);
+    };
+
     // This loop will run as long as window is open
     while (window.isOpen()) {
         sf::Event event;
         while (window.pollEvent(event)) {
             if (event.type == sf::Event::Closed)
                 window.close();     
-            else if (event.type == sf::Event::MouseWheelScrolled)
+            else if (playback.handle(event, window))
+                continue;
+            else if (event.type == sf::Event::MouseWheelScrolled) {
                 view.move(0, -event.mouseWheelScroll.delta * 30);      
-        }
-
-        window.clear(sf::Color(30, 30, 30));
-        window.setView(view);
-
-        float x = 50, y = 100; 
-        const float max_x = 1000;    
-
-        for (size_t i = 0; i < nodes.size(); ++i) {
-            auto& [circle, text] = nodes[i];
-            if (x > max_x) {
-                x = 50;   
+                dirty = true;
             }
-            circle.setPosition(x, y);
-            text.setPosition(x + 5, y + 5);
-            x += NODE_RADIUS * 2 + NODE_SPACING;   
         }
 
-        for (size_t i = 1; i < nodes.size(); ++i) {
-            sf::Vertex line[] = {
-                sf::Vertex(nodes[i - 1].first.getPosition() + sf::Vector2f(NODE_RADIUS, NODE_RADIUS), sf::Color::White),
-                sf::Vertex(nodes[i].first.getPosition() + sf::Vector2f(NODE_RADIUS, NODE_RADIUS), sf::Color::White)
-            };
-            window.draw(line, 2, sf::Lines);
+        // Bringing the slots to the playback time: replaying the records up to it, or rebuilding
+        // the slots when playback went back or far ahead
+        float frameTime = fpsClock.restart().asSeconds();
+        int64_t now = playback.advance(frameTime);
+        size_t target = trace.seek(now + 1);
+        if (target < applied || target - applied > REPLAY_LIMIT) {
+            rebuild(target);
+            dirty = true;
+        }
+        for (; applied < target; ++applied) {
+            apply(trace[applied]);
+            dirty = true;
         }
 
-        float currentTime = globalClock.getElapsedTime().asSeconds();
-        while (current < events.size() && (events[current].timestamp - startTime) * TIME_SCALE <= currentTime) {
-            auto& e = events[current];
-            if (e.type == "Producer") {
-                sf::CircleShape node(NODE_RADIUS);
-                node.setFillColor(sf::Color::Blue);
-                node.setOutlineThickness(2);
-                node.setOutlineColor(sf::Color::White);
-
-                sf::Text txt;
-                txt.setFont(font);
-                txt.setString(to_string(e.value));
-                txt.setCharacterSize(16);
-                txt.setFillColor(sf::Color::White);
-
-                nodes.push_back({ node, txt });
-            } 
-            else if (e.type == "Consumer") {
-                for (auto& [circle, text] : nodes) {
-                    if (text.getString() == to_string(e.value)) {
-                        circle.setFillColor(sf::Color::Red);
-                        text.setString("");
-                        break;
-                    }
+        // Rebuilding the geometry of the slots inside the view only
+        if (dirty) {
+            batch.clear();
+            sf::FloatRect visible(view.getCenter().x - view.getSize().x / 2, view.getCenter().y - view.getSize().y / 2,
+                                  view.getSize().x, view.getSize().y);
+            const sf::Vector2f center_offset(NODE_RADIUS, NODE_RADIUS);
+            const float extent = NODE_RADIUS * 2 + 4;
+
+            sf::FloatRect row(first_x - 2, first_y - 2, column_width * static_cast<float>(slot_count), extent);
+            if (visible.intersects(row)) {
+                size_t used = min(produced, slot_count);
+                for (size_t i = 1; i < used; ++i)
+                    batch.addLine(slotPosition(i - 1) + center_offset, slotPosition(i) + center_offset, sf::Color::White);
+                // Once the slots have wrapped, the newest node links back to the start of the row
+                if (produced > slot_count)
+                    batch.addLine(slotPosition(slot_count - 1) + center_offset, slotPosition(0) + center_offset, sf::Color::White);
+
+                for (size_t i = 0; i < used; ++i) {
+                    sf::Vector2f pos = slotPosition(i);
+                    if (!visible.intersects(sf::FloatRect(pos.x - 2, pos.y - 2, extent, extent))) continue;
+                    batch.addCircle(pos + center_offset, NODE_RADIUS, slots[i].consumed ? sf::Color::Red : sf::Color::Blue, sf::Color::White, 2);
+                    if (!slots[i].consumed) batch.addNumber(slots[i].value, pos + sf::Vector2f(5, 5), sf::Color::White);
                 }
             }
-            current++;   
+            dirty = false;
         }
 
         // FPS update
         frameCount++;
-        elapsedTime += fpsClock.restart().asSeconds();
+        elapsedTime += frameTime;
         if (elapsedTime >= 1.0f) {
             fpsText.setString("FPS: " + to_string(frameCount));
             frameCount = 0;
@@ -332,162 +184,251 @@ void run() {
         }
 
         // Draw everything
-        for (auto& [circle, text] : nodes) {
-            window.draw(circle);
-            window.draw(text);
-        }
-
+        window.clear(sf::Color(30, 30, 30));
+        window.setView(view);
+        batch.draw(window);
+        playback.draw(window, font);    // Draw the timeline
         window.draw(fpsText);   // Draw the FPS text
         window.display();   // Display the window content
     }
 }
 };
 
-mutex LinkedListBuffer::log_mutex;
-
 // Threads information by defualt
-const int NUM_PRODUCERS = 5;
-const int NUM_CONSUMERS = 3;
-const int ITEMS_PER_PRODUCER = 30;
-const int ITEMS_PER_CONSUMER = 50;
+// All bounded buffers share the same driver so that they can be compared directly.
+// The ticket-locked circular linked list is the default; pass --mcs to order its producers with
+// an MCS lock instead, or --ring to run the ring buffer. The other parameters are in DriverConfig.h.
+const vector<string> BUFFER_NAMES = {"ticket", "mcs", "ring"};
 
-LinkedListBuffer buffer;   
+// Items the --overflow callback policy handed to overflowCallback() instead of the buffer
+atomic<uint64_t> overflow_callback_items{0};
+
+void overflowCallback(const int&) {
+    overflow_callback_items.fetch_add(1, memory_order_relaxed);
+}
 
-void producer(int id) {
-    for (int i = 0; i < ITEMS_PER_PRODUCER; ++i) {
+OverflowPolicy overflowPolicy(const string& name) {
+    if (name == "drop-newest") return OverflowPolicy::DropNewest;
+    if (name == "drop-oldest") return OverflowPolicy::DropOldest;
+    if (name == "callback") return OverflowPolicy::Callback;
+    return OverflowPolicy::Block;
+}
+
+template <typename Buffer>
+void producer(Buffer& buffer, int id, const DriverConfig& cfg) {
+    for (int i = 0; i < cfg.items_per_producer; ++i) {
         int item = id * 1000 + i;   // Unique item based on producer ID
-        this_thread::sleep_for(chrono::milliseconds(10));   // Simulating the work done by producer
+        if (cfg.produce_sleep_ms > 0)
+            this_thread::sleep_for(chrono::milliseconds(cfg.produce_sleep_ms));   // Simulating the work done by producer
         buffer.produce(item, id);
     }
 }
 
-void consumer(int id) {
-    for (int i = 0; i < ITEMS_PER_CONSUMER; ++i) {
-        buffer.consume(id);  
-        this_thread::sleep_for(chrono::milliseconds(18)); // Simulate the work done by consumer
+// Takes items until the buffer has been closed and drained, so no consumer needs to know how many
+// items the producers make
+template <typename Buffer>
+void consumer(Buffer& buffer, int id, const DriverConfig& cfg) {
+    while (buffer.consume_until(chrono::steady_clock::time_point::max(), id)) {
+        if (cfg.consume_sleep_ms > 0)
+            this_thread::sleep_for(chrono::milliseconds(cfg.consume_sleep_ms)); // Simulate the work done by consumer
     }
 }
 
-struct LogEntry {
-    long long timestamp;
-    bool is_produce;
-    double wait_time_ms;
-};
+// Prints a live snapshot of the buffer every 100ms until done is set (--monitor). Reading it takes
+// neither the producer nor the consumer lock.
+template <typename Buffer>
+void monitor(Buffer& buffer, atomic<bool>& done) {
+    while (!done.load()) {
+        this_thread::sleep_for(chrono::milliseconds(100));
+        BufferSnapshot s = buffer.snapshot();
+        cout << "[monitor] Depth: " << s.depth
+             << " | High Watermark: " << s.high_watermark
+             << " | Enqueued: " << s.enqueued
+             << " | Dequeued: " << s.dequeued
+             << " | Dropped: " << s.dropped
+             << " | Blocked Producers: " << s.blocked_producers
+             << " | Blocked Consumers: " << s.blocked_consumers << endl;
+    }
+}
 
-// Driver code
-int main() {
+// Runs all producer and consumer threads against the given buffer and returns its time stats.
+// Only the linked list buffers offer snapshot(), so --monitor is ignored for the others.
+template <typename Buffer>
+vector<double> runThreads(Buffer& buffer, const DriverConfig& cfg) {
+    vector<thread> producers;
+    vector<thread> consumers;
+    atomic<bool> done{false};
+    thread monitor_thread;
+    if constexpr (requires { buffer.snapshot(); }) {
+        if (cfg.monitor) monitor_thread = thread(monitor<Buffer>, ref(buffer), ref(done));
+    }
 
-    ofstream("FiniteBufferLogger.txt") << "";
+    // Each thread pins itself (--pin-producers, --pin-consumers) before it touches the buffer, so that
+    // the nodes it allocates come from its own NUMA node
+    for (int i = 0; i < cfg.producers; ++i) {
+        producers.emplace_back([&buffer, &cfg, i]() {
+            pinDriverThread(cfg.producer_cpus, i);
+            labelThread("Producer " + to_string(i + 1));
+            producer(buffer, i + 1, cfg);
+        });
+    }
 
-    vector<thread> threads;
-    auto start_time = chrono::steady_clock::now(); 
-    
-    for (int i = 0; i < NUM_PRODUCERS; ++i)
-        threads.emplace_back(producer, i + 1);
+    for (int i = 0; i < cfg.consumers; ++i) {
+        consumers.emplace_back([&buffer, &cfg, i]() {
+            pinDriverThread(cfg.consumer_cpus, i);
+            labelThread("Consumer " + to_string(i + 1));
+            consumer(buffer, i + 1, cfg);
+        });
+    }
 
-    for (int i = 0; i < NUM_CONSUMERS; ++i)
-        threads.emplace_back(consumer, i + 1);
-    for (auto& t : threads)
+    // Once every item is in, closing the buffer lets the consumers finish draining it and return
+    for (auto& t : producers)
         t.join();
+    buffer.close();
+    for (auto& t : consumers)
+        t.join();
+    done = true;
+    if (monitor_thread.joinable()) monitor_thread.join();
 
-    auto end_time = chrono::steady_clock::now();
+    return buffer.Stats();
+}
 
-    vector<double> stat = buffer.Stats();  
+template <typename Buffer>
+void printLatency(Buffer& buffer) {
+    cout << "\nLatency Percentiles\n";
+    printLatencySummary(cout, "Produce", buffer.latency(BufferOp::Produce));
+    printLatencySummary(cout, "Consume", buffer.latency(BufferOp::Consume));
+}
 
-    ifstream log("FiniteBufferLogger.txt");
-    string line;
-    vector<LogEntry> entries;
+// Where the threads waited, per lock and condition, with the threads that had to wait under each.
+// Only the linked list buffers record it; --contention and --contention-folded also write it out.
+template <typename Buffer>
+void reportContention(Buffer& buffer, const DriverConfig& cfg) {
+    if constexpr (requires { buffer.contention(); }) {
+        ContentionReport report = buffer.contention();
+        cout << "\nContention (acquisitions, waits and hand-off latency)\n";
+        printContention(cout, report);
+        if (!cfg.contention.empty()) {
+            ofstream out(cfg.contention);
+            writeContentionJson(out, report);
+            out << "\n";
+            if (!out) cerr << "Cannot write " << cfg.contention << "\n";
+        }
+        if (!cfg.contention_folded.empty()) {
+            ofstream out(cfg.contention_folded);
+            writeContentionFolded(out, report, "FiniteBuffer");
+            if (!out) cerr << "Cannot write " << cfg.contention_folded << "\n";
+        }
+    }
+}
 
-    // total_producer_wait: Total time producers spent waiting to acquire the lock 
-    // total_consumer_wait: Total time consumers spent waiting for an item to become available and acquire lock
-    int total_produced = 0, total_consumed = 0;
-    double total_producer_wait = 0.0, total_consumer_wait = 0.0;
-    double max_producer_wait = 0.0, max_consumer_wait = 0.0;
+// Runs the producers and consumers against buffer, then prints the log analysis report and
+// shows the Visualizer unless running headless.
+template <typename Buffer>
+void runDriver(Buffer& buffer, const DriverConfig& cfg, const char* title) {
+    // With --binary-log the run writes compact records which are converted to the text log afterwards.
+    // With --trace it writes them as an indexed trace for the Visualizer, also exported to the text log.
+    // With --mmap-log the threads write their records straight into a memory-mapped log file.
+    LogSink sink = cfg.mmap_log ? LogSink::Mapped : LogSink::Writer;
+    LogFormat format = cfg.trace ? LogFormat::Trace : cfg.binary_log ? LogFormat::Binary : LogFormat::Text;
+    string log_path = cfg.trace ? "FiniteBufferTrace.ibt" : cfg.binary_log ? "FiniteBufferLogger.bin" : "FiniteBufferLogger.txt";
+    buffer_logger.open(log_path, format, sink);
 
-    unordered_map<int, double> producer_wait_sum;
-    unordered_map<int, int> producer_wait_count;
-    unordered_map<int, double> producer_wait_max;
+    auto start_time = chrono::steady_clock::now(); 
+    vector<double> stat = runThreads(buffer, cfg);
 
-    while (getline(log, line)) {
-        size_t ts_start = line.find('[');
-        size_t ts_end = line.find("us]");
-        if (ts_start == string::npos || ts_end == string::npos) continue;
+    auto end_time = chrono::steady_clock::now();
 
-        long long timestamp = stoll(line.substr(ts_start + 1, ts_end - ts_start - 1));
+    buffer_logger.close();     // A trace is sorted and indexed here
+    if (format != LogFormat::Text) AsyncLogger::exportText(log_path, "FiniteBufferLogger.txt");
 
-        bool is_produce = (line.find("produced") != string::npos);
 
-        // Find wait time
-        double wait_ms = 0.0;
-        size_t wait_pos = line.find("Waited:");
-        if (wait_pos != string::npos) {
-            stringstream ss(line.substr(wait_pos + 8));
-            ss >> wait_ms;
-        }
-
-        if (is_produce) {
-            total_produced++;
-            total_producer_wait += wait_ms;
-            if (wait_ms > max_producer_wait) max_producer_wait = wait_ms;
-            
-            size_t pid_pos = line.find("Producer ");
-            if (pid_pos != string::npos) {
-                int pid = stoi(line.substr(pid_pos + 9));
-                producer_wait_sum[pid] += wait_ms;
-                producer_wait_count[pid]++;
-                producer_wait_max[pid] = max(producer_wait_max[pid], wait_ms);
-            }
-        } else {
-            total_consumed++;
-            total_consumer_wait += wait_ms;
-            if (wait_ms > max_consumer_wait) max_consumer_wait = wait_ms;
-        }
-    }
+    // Single pass over the log; the binary log or trace is read directly rather than its text export
+    LogAnalysis analysis = analyzeLogFile(log_path);
+    uint64_t total_produced = analysis.produced, total_consumed = analysis.consumed;
 
     // Buffer size remain fixed
-    int buffer_count = 10;
-    int peak_buffer = 10;
+    size_t peak_buffer = buffer.capacity();
     // Total runtime in seconds
     double total_runtime_sec = chrono::duration_cast<chrono::duration<double>>(end_time - start_time).count();
 
     // Displaying stats
     cout << fixed << setprecision(3);
-    cout << "\nLOG ANALYSIS REPORT\n";
+    cout << "\nLOG ANALYSIS REPORT (" << title << " buffer)\n";
     cout << "Total Items Produced       : " << total_produced << "\n";
     cout << "Total Items Consumed       : " << total_consumed << "\n";
     cout << "Final Buffer Size          : " << peak_buffer << "\n";
     cout << "Peak Buffer Size (Nodes)   : " << peak_buffer << "\n";
+    // Dropped items never reached a consumer; with drop-oldest they were logged as produced
+    if (buffer.overflowPolicy() != OverflowPolicy::Block) {
+        cout << "Items Dropped on Overflow  : " << buffer.droppedCount() << "\n";
+        if (buffer.overflowPolicy() == OverflowPolicy::Callback)
+            cout << "Items Given to Callback    : " << overflow_callback_items.load() << "\n";
+    }
 
     cout << "\nRuntime\n";
     cout << "Total Runtime              : " << total_runtime_sec << " seconds\n";
     cout << "Total Produce Time (just to produce in buffer including lock acquiring time and writing time)        : " << stat[0] << " seconds\n";
     cout << "Total Consume Time (just to consume from buffer including lock acquiring time and reading time)        : " << stat[1] << " seconds\n";
 
+    printLatency(buffer);
+    reportContention(buffer, cfg);
+
     cout << "\nProducer Stats\n";
-    cout << "Total Wait Time            : " << total_producer_wait << " ms\n";
-    cout << "Average Wait Time          : " << (total_produced ? total_producer_wait / total_produced : 0) << " ms\n";
-    cout << "Maximum Wait Time          : " << max_producer_wait << " ms\n";
+    cout << "Total Wait Time            : " << analysis.producer_wait_ms << " ms\n";
+    cout << "Average Wait Time          : " << (total_produced ? analysis.producer_wait_ms / total_produced : 0) << " ms\n";
+    cout << "Maximum Wait Time          : " << analysis.max_producer_wait_ms << " ms\n";
 
     cout << "\nConsumer Stats\n";
-    cout << "Total Wait Time            : " << total_consumer_wait << " ms\n";
-    cout << "Average Wait Time          : " << (total_consumed ? total_consumer_wait / total_consumed : 0) << " ms\n";
-    cout << "Maximum Wait Time          : " << max_consumer_wait << " ms\n";
+    cout << "Total Wait Time            : " << analysis.consumer_wait_ms << " ms\n";
+    cout << "Average Wait Time          : " << (total_consumed ? analysis.consumer_wait_ms / total_consumed : 0) << " ms\n";
+    cout << "Maximum Wait Time          : " << analysis.max_consumer_wait_ms << " ms\n";
     
     // Producer Fairness
     cout << "\nProducer Fairness (by Avg Wait Time)\n";
-    for (const auto& [pid, count] : producer_wait_count) {
-        double avg_wait = producer_wait_sum[pid] / count;
-        double max_wait = producer_wait_max[pid];
-    
+    for (const auto& [pid, p] : analysis.producers) {
         cout << "Producer " << pid
-             << " | Produced: " << count
-             << " | Avg Wait Time: " << avg_wait << " ms"
-             << " | Max Wait Time: " << max_wait << " ms"<<endl;
+             << " | Produced: " << p.count
+             << " | Avg Wait Time: " << p.wait_sum_ms / p.count << " ms"
+             << " | Max Wait Time: " << p.wait_max_ms << " ms"<<endl;
     }
-    
 
-    Visualizer vis;
-    vis.run();  // Running the visualizer.
+    // Headless runs (e.g. large buffers for profiling) skip the Visualizer entirely
+    if (!cfg.headless) {
+        // The Visualizer replays a trace; without --trace one is built from the log
+        if (!cfg.trace) exportTrace(log_path, "FiniteBufferTrace.ibt");
+        Visualizer vis("FiniteBufferTrace.ibt", cfg.speed);
+        vis.run();  // Running the visualizer.
+    }
+}
+
+// Driver code
+int main(int argc, char* argv[]) {
+    DriverConfig cfg;
+    if (!parseDriverConfig(argc, argv, BUFFER_NAMES, cfg)) return 1;
+    // --replay shows a recorded trace again without running any buffer
+    if (!cfg.replay.empty()) {
+        Visualizer vis(cfg.replay, cfg.speed);
+        vis.run();
+        return 0;
+    }
+    // Only the ring can evict from the producer side; the linked list would need its consumer lock
+    if (cfg.overflow == "drop-oldest" && cfg.buffer != "ring") {
+        cerr << "error: --overflow drop-oldest needs --ring\n";
+        return 1;
+    }
+    OverflowPolicy policy = overflowPolicy(cfg.overflow);
+
+    if (cfg.buffer == "ring") {
+        RingBuffer<int> buffer(cfg.capacity, policy, overflowCallback);     // Rounded up to a power of two
+        runDriver(buffer, cfg, "ring");
+    } else if (cfg.buffer == "mcs") {
+        LinkedListBuffer<int, McsLock> buffer(static_cast<int>(cfg.capacity), policy, overflowCallback);
+        runDriver(buffer, cfg, "MCS-locked linked list");
+    } else {
+        LinkedListBuffer<int> buffer(static_cast<int>(cfg.capacity), policy, overflowCallback);
+        runDriver(buffer, cfg, "ticket-locked linked list");
+    }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,1426 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "AsyncLogger.h"
+#include "AsyncWait.h"
+#include "Contention.h"
+#include "Deadline.h"
+#include "Instrumentation.h"
+#include "Locks.h"
+#include "Platform.h"
+#include "SlotStorage.h"
+
+// Bounded buffers: the circular linked list (LinkedListBuffer), its single-producer/single-consumer
+// version (LinkedListBuffer<T, SpscPolicy>) and the Vyukov ring (RingBuffer). Kept apart from the
+// driver and the Visualizer so that the benchmark can build them without SFML.
+namespace finite_buffer {
+
+// Each node contains the data to be stored in it, a flag indicating whehter full or empty and a pointer to the next node.
+// The data is only constructed while the node is filled (see SlotStorage). filled is the one field
+// both sides touch: the producers hold mutex_producer and the consumers mutex_consumer, so it is atomic,
+// and seq_cst for the sleep handshake in LinkedListBuffer.
+template <typename T>
+struct Node {
+    SlotStorage<T> data;
+    std::atomic<bool> filled;
+    Node* next;
+    Node() : filled(false), next(nullptr) {}
+};
+
+// What the blocking produce(), emplace() and produce_bulk() do with an item when the buffer is full.
+// The try/timed produce calls and async_produce() are not affected; they already have a way to fail.
+// No policy takes the consumer side's lock.
+//   Block        wait for space (the default)
+//   DropNewest   discard the item being produced
+//   DropOldest   discard the oldest item in the buffer to make room. Only RingBuffer can do that from
+//                the producer side; the linked list buffers would need their consumer lock (or, for
+//                SPSC, the consumer's index), so their constructors throw std::invalid_argument.
+//   Callback     hand the item being produced to the overflow handler instead, on the producer's thread
+enum class OverflowPolicy { Block, DropNewest, DropOldest, Callback };
+
+template <typename T>
+using OverflowHandler = std::function<void(const T&)>;
+
+// A buffer's overflow policy and the count of the items it turned away or evicted
+template <typename T>
+class OverflowControl {
+public:
+    OverflowControl(OverflowPolicy policy, OverflowHandler<T> handler) : kind(policy), handler(std::move(handler)) {}
+
+    OverflowPolicy policy() const {
+        return kind;
+    }
+
+    // A blocking produce with this deadline does not wait for space
+    bool dropsWhenFull(const WaitDeadline& deadline) const {
+        return kind != OverflowPolicy::Block && !deadline.endsOnClose();
+    }
+
+    // The item that args would construct did not fit
+    template <typename... Args>
+    void reject(Args&&... args) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        if (kind != OverflowPolicy::Callback || !handler) return;
+        if constexpr (sizeof...(Args) == 1 && (std::is_same_v<std::decay_t<Args>, T> && ...)) handler(args...);
+        else handler(T(std::forward<Args>(args)...));
+    }
+
+    // An item already in the buffer was discarded to make room
+    void evicted() {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t droppedCount() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    const OverflowPolicy kind;
+    OverflowHandler<T> handler;
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> dropped{0};
+};
+
+// For the buffers that cannot evict from the producer side: refuses DropOldest rather than letting a
+// caller who asked to lose the oldest items lose the newest ones instead
+inline OverflowPolicy withoutEviction(OverflowPolicy policy) {
+    if (policy == OverflowPolicy::DropOldest)
+        throw std::invalid_argument("OverflowPolicy::DropOldest needs RingBuffer; the linked list buffers cannot evict");
+    return policy;
+}
+
+// The producers of a LinkedListBuffer in the order they took the ticket lock. Each one waits on the
+// condition variable of its own ticket, which lives on its stack, so a freed slot wakes exactly the
+// producer whose turn it is. Guarded by the buffer's mutex_producer.
+class ProducerLine {
+public:
+    struct Ticket {
+        std::condition_variable cv;
+        Ticket* next = nullptr;
+    };
+
+    void join(Ticket& ticket) {
+        if (last) last->next = &ticket;
+        else first = &ticket;
+        last = &ticket;
+    }
+
+    // Returns true if ticket was at the front. Only a producer that gives up leaves from further back.
+    bool leave(Ticket& ticket) {
+        Ticket* prev = nullptr;
+        Ticket** link = &first;
+        while (*link != &ticket) {
+            prev = *link;
+            link = &prev->next;
+        }
+        *link = ticket.next;
+        if (last == &ticket) last = prev;
+        return prev == nullptr;
+    }
+
+    bool isFront(const Ticket& ticket) const {
+        return first == &ticket;
+    }
+
+    void notifyFront() {
+        if (first) first->cv.notify_one();
+    }
+
+    void notifyAll() {
+        for (Ticket* ticket = first; ticket; ticket = ticket->next) ticket->cv.notify_one();
+    }
+
+private:
+    Ticket* first = nullptr;
+    Ticket* last = nullptr;
+};
+
+// -------------------- Linked List Buffer --------------------
+// T is the element type; it only needs to be move-constructible. ProducerLock orders the producers
+// (TicketLock, or McsLock for high producer counts); SpscPolicy selects the lock-free 1:1 version below.
+template <typename T, typename ProducerLock = TicketLock>
+class LinkedListBuffer {
+private:
+    Node<T>* head; // Producer writes at the head end
+    Node<T>* tail; // Consumer reads at the tail end
+    const int BUFFER_SIZE; // Fixed buffer size
+
+    // The ticket lock only orders the producers into the line; nobody holds it while waiting for space
+    ProducerLock ticket_lock_producer;
+    std::mutex mutex_producer;       
+    std::mutex mutex_consumer;      
+    ProducerLine line;                  // Producers waiting for their turn, guarded by mutex_producer
+    std::condition_variable cv_not_empty;       
+    // Threads asleep (or about to be) on a ticket or cv_not_empty. A sleeper counts itself before its
+    // last check of filled, and the other side writes filled before reading the count, so with both
+    // seq_cst one of them sees the other; only then does a wakeup need the sleeper's mutex.
+    alignas(CACHE_LINE_SIZE) std::atomic<int> sleeping_producers{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<int> sleeping_consumers{0};
+    AsyncWaiterQueue async_producers;   // Coroutines parked in async_produce(), guarded by mutex_producer
+    AsyncWaiterQueue async_consumers;   // Coroutines parked in async_consume(), guarded by mutex_consumer
+    std::atomic<bool> closed{false};    // Set by close()
+    OverflowControl<T> overflow;
+
+    // Per-thread latency histograms and totals, recorded without a lock
+    BufferStats stats;
+    // Live depth, high-watermark and blocked threads for snapshot(), advanced under the locks already held
+    OccupancyCounters occupancy;
+    // Waits at the locks, for an item and for a producer's turn (space), per thread (see contention())
+    enum WaitSite : size_t { PRODUCER_LOCK, PRODUCER_MUTEX, CONSUMER_MUTEX, NOT_EMPTY, PRODUCER_TURN };
+    ContentionProfile waits{"ticket_lock_producer", "mutex_producer", "mutex_consumer", "cv_not_empty", "producer_line"};
+
+    uint64_t start_time;        // CycleClock ticks
+
+public:
+// Implementing circular linked list to implement finite fixed buffer
+    explicit LinkedListBuffer(int buffer_size = 10, OverflowPolicy policy = OverflowPolicy::Block, OverflowHandler<T> on_overflow = {})
+        : BUFFER_SIZE(std::max(buffer_size, 1)), overflow(withoutEviction(policy), std::move(on_overflow)) {
+        Node<T>* first = new Node<T>();   
+        Node<T>* current = first;
+        
+        for(int i = 1; i < BUFFER_SIZE; ++i) {
+            current->next = new Node<T>();
+            current = current->next;   
+        }
+        current->next = first;     
+        
+        head = first;   
+        tail = first;
+        start_time = CycleClock::now();  
+    }
+
+    ~LinkedListBuffer() {
+        Node<T>* node = head;
+        for (int i = 0; i < BUFFER_SIZE; ++i) {
+            Node<T>* next = node->next;
+            if (node->filled) node->data.destroy();
+            delete node;
+            node = next;
+        }
+    }
+
+    void produce(const T& item, int producer_id) {
+        emplace(producer_id, item);
+    }
+
+    void produce(T&& item, int producer_id) {
+        emplace(producer_id, std::move(item));
+    }
+
+    // Constructs the item directly in the head node from args
+    template <typename... Args>
+    void emplace(int producer_id, Args&&... args) {
+        emplaceWithin(WaitDeadline::forever(), producer_id, std::forward<Args>(args)...);
+    }
+
+    T consume(int consumer_id) {
+        return *consumeWithin(WaitDeadline::forever(), consumer_id);
+    }
+
+    int capacity() const {
+        return BUFFER_SIZE;
+    }
+
+    OverflowPolicy overflowPolicy() const {
+        return overflow.policy();
+    }
+
+    // Items the overflow policy turned away
+    uint64_t droppedCount() const {
+        return overflow.droppedCount();
+    }
+
+    // Produces all items in one turn at the front of the line, so no other producer's items come in
+    // between. Whenever the buffer fills up, the items written so far are published with a single
+    // wakeup before waiting for space again; under a dropping overflow policy the items that do not
+    // fit overflow instead.
+    void produce_bulk(std::span<const T> items, int producer_id) {
+        if (items.empty()) return;
+        uint64_t request_lock_time = CycleClock::now();
+        bool drops = overflow.dropsWhenFull(WaitDeadline::forever());
+
+        ProducerLine::Ticket ticket;
+        std::unique_lock<std::mutex> lock = joinLine(ticket);
+
+        size_t done = 0;
+        uint64_t wait_start = request_lock_time;
+        uint64_t first_acquired = 0;
+        uint64_t now = 0;
+        while (done < items.size()) {
+            if (drops && !mayWrite(ticket)) break;
+            waitForTurn(ticket, lock, WaitDeadline::forever());
+            uint64_t acquired_lock_time = CycleClock::now();
+            if (done == 0) first_acquired = acquired_lock_time;
+
+            size_t run_start = done;
+            while (done < items.size() && !head->filled) {
+                head->data.construct(items[done++]);
+                occupancy.enqueued(1);
+                head->filled = true;
+                head = head->next;
+            }
+            occupancy.published();
+            now = CycleClock::now();
+
+            lock.unlock();
+            wakeConsumers(done - run_start);
+
+            for (size_t i = run_start; i < done; ++i)
+                buffer_logger.log(LogRole::Producer, producer_id, logValue(items[i]), CycleClock::toNs(now - start_time), CycleClock::toNs(acquired_lock_time - wait_start));
+
+            wait_start = CycleClock::now();
+            lock.lock();
+        }
+
+        leaveLine(ticket);
+        lock.unlock();
+        for (size_t i = done; i < items.size(); ++i) overflow.reject(items[i]);
+
+        // The critical section spans from the first run to the last one, waits for space included
+        if (done > 0) stats.record(BufferOp::Produce, request_lock_time, first_acquired, now, CycleClock::now(), done);
+        resumeWaiters();
+    }
+
+    // Waits for at least one item, then takes up to min(out.size(), max) filled nodes in one pass
+    // and wakes the producers once. Returns the number of items written to out.
+    size_t consume_bulk(std::span<T> out, size_t max, int consumer_id) {
+        size_t limit = std::min(out.size(), max);
+        if (limit == 0) return 0;
+        uint64_t request_lock_time = CycleClock::now();
+
+        std::unique_lock<std::mutex> lock = waits.lock(CONSUMER_MUTEX, mutex_consumer);
+        sleepUntil(sleeping_consumers, BufferOp::Consume, cv_not_empty, lock, WaitDeadline::forever(), [this] { return tail->filled.load(); });
+        uint64_t acquired_lock_time = CycleClock::now();
+
+        size_t count = 0;
+        while (count < limit && tail->filled) {
+            out[count++] = tail->data.take();
+            occupancy.dequeued(1);
+            tail->filled = false;
+            tail = tail->next;
+        }
+        uint64_t now = CycleClock::now();
+
+        lock.unlock();
+        // The producer at the front writes, and passes the turn on while there is room
+        wakeProducers();
+
+        for (size_t i = 0; i < count; ++i)
+            buffer_logger.log(LogRole::Consumer, consumer_id, logValue(out[i]), CycleClock::toNs(now - start_time), CycleClock::toNs(acquired_lock_time - request_lock_time));
+
+        stats.record(BufferOp::Consume, request_lock_time, acquired_lock_time, now, CycleClock::now(), count);
+
+        resumeWaiters();
+        return count;
+    }
+
+    // Non-blocking and timed versions of produce() and consume(). They return false (nullopt) when
+    // the deadline passes without space (an item); the produce calls fail at once when the buffer
+    // is closed, and the consume calls once the buffer is closed and drained. item is only moved
+    // from when it was produced.
+    template <typename U>
+    bool try_produce(U&& item, int producer_id) {
+        return emplaceWithin(WaitDeadline::none(), producer_id, std::forward<U>(item));
+    }
+
+    template <typename U, typename Rep, typename Period>
+    bool produce_for(U&& item, const std::chrono::duration<Rep, Period>& timeout, int producer_id) {
+        return emplaceWithin(WaitDeadline::after(timeout), producer_id, std::forward<U>(item));
+    }
+
+    template <typename U>
+    bool produce_until(U&& item, std::chrono::steady_clock::time_point deadline, int producer_id) {
+        return emplaceWithin(WaitDeadline::at(deadline), producer_id, std::forward<U>(item));
+    }
+
+    std::optional<T> try_consume(int consumer_id) {
+        return consumeWithin(WaitDeadline::none(), consumer_id);
+    }
+
+    template <typename Rep, typename Period>
+    std::optional<T> consume_for(const std::chrono::duration<Rep, Period>& timeout, int consumer_id) {
+        return consumeWithin(WaitDeadline::after(timeout), consumer_id);
+    }
+
+    std::optional<T> consume_until(std::chrono::steady_clock::time_point deadline, int consumer_id) {
+        return consumeWithin(WaitDeadline::at(deadline), consumer_id);
+    }
+
+    // No more items are coming: the try_/timed produce calls fail from now on, the try_/timed consume
+    // calls still take the items left but stop waiting once the buffer is empty, and every thread
+    // waiting in one of them wakes up. The blocking produce() and consume() are not affected.
+    void close() {
+        closed.store(true, std::memory_order_seq_cst);
+        // Taking each mutex once orders the store with a waiter that is between its check and its wait
+        {
+            std::lock_guard<std::mutex> lock(mutex_producer);
+            line.notifyAll();
+        }
+        { std::lock_guard<std::mutex> lock(mutex_consumer); }
+        cv_not_empty.notify_all();
+    }
+
+    bool isClosed() const {
+        return closed.load(std::memory_order_acquire);
+    }
+
+    std::vector<double> Stats() {
+        std::vector<double> time_stat;
+        time_stat.push_back(stats.summary(BufferOp::Produce).total_seconds);
+        time_stat.push_back(stats.summary(BufferOp::Consume).total_seconds);
+        return time_stat;
+    }
+
+    LatencySummary latency(BufferOp op) {
+        return stats.summary(op);
+    }
+
+    // Acquisitions of, and time spent waiting at, ticket_lock_producer, mutex_producer and
+    // mutex_consumer, on cv_not_empty (for an item) and in producer_line (for the turn and space), by
+    // thread; hand-off latency is from the notify of the other side to the wake-up
+    ContentionReport contention() {
+        return waits.report();
+    }
+
+    // Live view for a monitoring thread; takes neither the producer nor the consumer locks
+    BufferSnapshot snapshot() {
+        BufferSnapshot s = occupancy.snapshot();
+        s.dropped = overflow.droppedCount();
+        s.produce = stats.summary(BufferOp::Produce);
+        s.consume = stats.summary(BufferOp::Consume);
+        return s;
+    }
+
+    // co_await async_produce(item, id) and co_await async_consume(id) work like produce() and consume(),
+    // but while the buffer is full (empty) they park the coroutine rather than the thread. The consumer
+    // that frees a slot (the producer that publishes an item) completes and resumes it.
+    template <typename U>
+    ProduceAwaiter<LinkedListBuffer, T> async_produce(U&& item, int producer_id) {
+        return {*this, std::forward<U>(item), producer_id};
+    }
+
+    ConsumeAwaiter<LinkedListBuffer, T> async_consume(int consumer_id) {
+        return {*this, consumer_id};
+    }
+
+private:
+    friend class ::ConsumeAwaiter<LinkedListBuffer, T>;
+    friend class ::ProduceAwaiter<LinkedListBuffer, T>;
+
+    // Every thread producer, timed and non-blocking ones included, queues up in the line; one that
+    // gives up simply leaves it
+    template <typename... Args>
+    bool emplaceWithin(const WaitDeadline& deadline, int producer_id, Args&&... args) {
+        if (deadline.endsOnClose() && closed.load(std::memory_order_acquire)) return false;
+        uint64_t request_lock_time = CycleClock::now();
+        
+        // Taking a place in line in ticket order
+        ProducerLine::Ticket ticket;
+        std::unique_lock<std::mutex> lock = joinLine(ticket);
+
+        // A dropping overflow policy decides under mutex_producer alone; the consumers never wait for it
+        if (overflow.dropsWhenFull(deadline) && !mayWrite(ticket)) {
+            leaveLine(ticket);
+            lock.unlock();
+            overflow.reject(std::forward<Args>(args)...);
+            return false;
+        }
+
+        // Wait until it is our turn and the node at head is free to be filled
+        if (!waitForTurn(ticket, lock, deadline)) {
+            leaveLine(ticket);
+            return false;
+        }
+
+        uint64_t acquired_lock_time = CycleClock::now();
+
+        head->data.construct(std::forward<Args>(args)...);
+        int64_t logged_value = logValue(head->data.get());
+        Node<T>* temp = head->next;
+        occupancy.enqueued(1);
+        head->filled = true;
+        head = temp; 
+        occupancy.published();
+
+        uint64_t now = CycleClock::now();
+
+        // Handing the turn to the next producer, and releasing the producer lock
+        leaveLine(ticket);
+        lock.unlock();
+        // Notifying one of the waiting consumer threads
+        wakeConsumers(1);
+
+        // Logging outside the critical section; the timestamp was taken while still holding the lock
+        buffer_logger.log(LogRole::Producer, producer_id, logged_value, CycleClock::toNs(now - start_time), CycleClock::toNs(acquired_lock_time - request_lock_time));
+
+        stats.record(BufferOp::Produce, request_lock_time, acquired_lock_time, now, CycleClock::now());
+
+        // Parked coroutines run on this thread, so only once the produce itself is complete
+        resumeWaiters();
+        return true;
+    }
+
+    std::optional<T> consumeWithin(const WaitDeadline& deadline, int consumer_id) {
+        uint64_t request_lock_time = CycleClock::now();
+
+        // First consumer acquires lock to ensure synchronization
+        std::unique_lock<std::mutex> lock = waits.lock(CONSUMER_MUTEX, mutex_consumer);
+
+        sleepUntil(sleeping_consumers, BufferOp::Consume, cv_not_empty, lock, deadline, [&] { return tail->filled || deadline.passed(closed); });
+        if (!tail->filled) return std::nullopt;
+        uint64_t acquired_lock_time = CycleClock::now();
+
+        // Consuming the current data
+        int64_t logged_value = logValue(tail->data.get());
+        T item = tail->data.take();
+        occupancy.dequeued(1);
+        tail->filled = false;
+        
+        uint64_t now = CycleClock::now();
+
+        tail = tail->next; 
+
+        // Unlocking the buffer so other consumers can proceed
+        lock.unlock();
+        // Notifying the producer whose turn it is that space is available
+        wakeProducers();
+
+        // Logging
+        buffer_logger.log(LogRole::Consumer, consumer_id, logged_value, CycleClock::toNs(now - start_time), CycleClock::toNs(acquired_lock_time - request_lock_time));
+
+        stats.record(BufferOp::Consume, request_lock_time, acquired_lock_time, now, CycleClock::now());
+
+        resumeWaiters();
+        return item;
+    }
+
+    // A place in line: the ticket lock is held just long enough to join it under mutex_producer
+    std::unique_lock<std::mutex> joinLine(ProducerLine::Ticket& ticket) {
+        LockWait lock_wait;
+        ticket_lock_producer.lock(&lock_wait);
+        std::unique_lock<std::mutex> lock = waits.lock(PRODUCER_MUTEX, mutex_producer);
+        line.join(ticket);
+        ticket_lock_producer.unlock();
+        waits.record(PRODUCER_LOCK, lock_wait);
+        return lock;
+    }
+
+    // The producer at the front of the line writes as soon as the node at head is free
+    bool mayWrite(const ProducerLine::Ticket& ticket) const {
+        return line.isFront(ticket) && !head->filled;
+    }
+
+    // Sleeps on the ticket until mayWrite() or the deadline passes; returns mayWrite()
+    bool waitForTurn(ProducerLine::Ticket& ticket, std::unique_lock<std::mutex>& lock, const WaitDeadline& deadline) {
+        sleepUntil(sleeping_producers, BufferOp::Produce, ticket.cv, lock, deadline, [&] { return mayWrite(ticket) || deadline.passed(closed); });
+        return mayWrite(ticket);
+    }
+
+    // Leaves the line with mutex_producer held. If that hands the front to a producer while there is
+    // room, it is woken, since no consumer will do it.
+    void leaveLine(ProducerLine::Ticket& ticket) {
+        if (line.leave(ticket) && !head->filled) {
+            waits.notified(PRODUCER_TURN);
+            line.notifyFront();
+        }
+    }
+
+    // Waits like occupancy.waitBlocked(), announcing the sleep in sleepers first (see sleeping_producers).
+    // Recorded as a wait for an item (consumers) or in producer_line (producers).
+    template <typename Predicate>
+    bool sleepUntil(std::atomic<int>& sleepers, BufferOp side, std::condition_variable& cv, std::unique_lock<std::mutex>& lock,
+                    const WaitDeadline& deadline, Predicate ready) {
+        size_t site = side == BufferOp::Consume ? NOT_EMPTY : PRODUCER_TURN;
+        LockWait wait;
+        if (ready()) {
+            waits.record(site, wait);
+            return true;
+        }
+        wait.spinning();
+        wait.parking();
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        bool ok = occupancy.waitBlocked(side, cv, lock, deadline, ready);
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+        wait.unparked();
+        waits.record(site, wait);
+        return ok;
+    }
+
+    // After a slot was freed. The front producer's ticket may only be touched under mutex_producer,
+    // which is therefore taken, but only when a producer sleeps.
+    void wakeProducers() {
+        if (sleeping_producers.load(std::memory_order_seq_cst) == 0) return;
+        std::unique_lock<std::mutex> lock = waits.lock(PRODUCER_MUTEX, mutex_producer);
+        waits.notified(PRODUCER_TURN);
+        line.notifyFront();
+    }
+
+    // After count items were published; taking mutex_consumer once closes the gap between a
+    // consumer's last check and its wait
+    void wakeConsumers(size_t count) {
+        if (sleeping_consumers.load(std::memory_order_seq_cst) == 0) return;
+        { std::unique_lock<std::mutex> lock = waits.lock(CONSUMER_MUTEX, mutex_consumer); }
+        waits.notified(NOT_EMPTY);
+        if (count == 1) cv_not_empty.notify_one();
+        else cv_not_empty.notify_all();
+    }
+
+    // Parks waiter unless there is a free slot; returns false if its item was written at once.
+    // The async paths take mutex_producer only and skip the line: the thread that would free the
+    // space a coroutine waits for may be the one running it.
+    bool suspendProducer(ItemWaiter<T>& waiter) {
+        std::unique_lock<std::mutex> lock(mutex_producer);
+        async_producers.push(&waiter);
+        bool full = head->filled;
+        lock.unlock();
+        if (full) return true;
+        return !completeNow(waiter);
+    }
+
+    // Parks waiter unless an item is ready; returns false if it was handed one at once
+    bool suspendConsumer(ItemWaiter<T>& waiter) {
+        std::unique_lock<std::mutex> lock(mutex_consumer);
+        async_consumers.push(&waiter);
+        bool empty = !tail->filled;
+        lock.unlock();
+        if (empty) return true;
+        return !completeNow(waiter);
+    }
+
+    // The buffer could already take the operation that was just parked: complete the parked
+    // waiters, oldest first, and report whether waiter was among them. Once its lock has been
+    // released the waiter may also be completed by another thread, so it is only compared, never read.
+    bool completeNow(AsyncWaiter& waiter) {
+        ResumeList resumed;
+        dispatchWaiters(resumed);
+        bool completed = resumed.remove(&waiter);
+        resumed.resumeAll();
+        return completed;
+    }
+
+    // After every produce and consume: completes the parked coroutines the operation made room
+    // for and resumes them on this thread
+    void resumeWaiters() {
+        if (!async_producers.mayHaveWaiters() && !async_consumers.mayHaveWaiters()) return;
+        ResumeList resumed;
+        dispatchWaiters(resumed);
+        resumed.resumeAll();
+    }
+
+    // Hands items to parked consumers and writes the items of parked producers in turn, since each
+    // makes room for the other, until neither side can make progress
+    void dispatchWaiters(ResumeList& resumed) {
+        while (true) {
+            size_t taken = async_consumers.mayHaveWaiters() ? handOffToConsumers(resumed) : 0;
+            if (taken > 0) wakeProducers();
+
+            size_t written = async_producers.mayHaveWaiters() ? handOffFromProducers(resumed) : 0;
+            if (written > 0) wakeConsumers(written);
+
+            if (taken == 0 && written == 0) return;
+        }
+    }
+
+    size_t handOffToConsumers(ResumeList& resumed) {
+        ResumeList done;
+        std::unique_lock<std::mutex> lock(mutex_consumer);
+        uint64_t acquired_lock_time = CycleClock::now();
+        size_t count = 0;
+        while (!async_consumers.empty() && tail->filled) {
+            ItemWaiter<T>* waiter = static_cast<ItemWaiter<T>*>(async_consumers.pop());
+            waiter->logged_value = logValue(tail->data.get());
+            waiter->item.construct(tail->data.take());
+            occupancy.dequeued(1);
+            tail->filled = false;
+            tail = tail->next;
+            done.add(waiter);
+            count++;
+        }
+        uint64_t now = CycleClock::now();
+        lock.unlock();
+
+        done.forEach([&](AsyncWaiter& waiter) {
+            buffer_logger.log(LogRole::Consumer, waiter.thread_id, waiter.logged_value, CycleClock::toNs(now - start_time), CycleClock::toNs(acquired_lock_time - waiter.request_time));
+            stats.record(BufferOp::Consume, waiter.request_time, acquired_lock_time, now, CycleClock::now());
+        });
+        resumed.append(done);
+        return count;
+    }
+
+    size_t handOffFromProducers(ResumeList& resumed) {
+        ResumeList done;
+        std::unique_lock<std::mutex> lock(mutex_producer);
+        uint64_t acquired_lock_time = CycleClock::now();
+        size_t count = 0;
+        while (!async_producers.empty() && !head->filled) {
+            ItemWaiter<T>* waiter = static_cast<ItemWaiter<T>*>(async_producers.pop());
+            head->data.construct(waiter->item.take());
+            waiter->logged_value = logValue(head->data.get());
+            occupancy.enqueued(1);
+            head->filled = true;
+            head = head->next;
+            done.add(waiter);
+            count++;
+        }
+        if (count > 0) occupancy.published();
+        uint64_t now = CycleClock::now();
+        lock.unlock();
+
+        done.forEach([&](AsyncWaiter& waiter) {
+            buffer_logger.log(LogRole::Producer, waiter.thread_id, waiter.logged_value, CycleClock::toNs(now - start_time), CycleClock::toNs(acquired_lock_time - waiter.request_time));
+            stats.record(BufferOp::Produce, waiter.request_time, acquired_lock_time, now, CycleClock::now());
+        });
+        resumed.append(done);
+        return count;
+    }
+};
+
+// -------------------- SPSC Buffer --------------------
+// Selected with LinkedListBuffer<T, SpscPolicy>; same API and capacity, but built as a contiguous
+// single-producer/single-consumer ring (Lamport style, one spare slot) with no locks or condition
+// variables. Each side owns its index and keeps a cached copy of the other one, refreshing it only
+// when the ring looks full (producer) or empty (consumer), so in steady state the two threads touch
+// each other's cache line once per lap rather than once per item. Neither operation retries: the
+// only waiting is for space or an item (spinning briefly, then yielding). A coroutine waits in a
+// one-entry slot instead, which the other side checks after every item it publishes or frees.
+template <typename T>
+class LinkedListBuffer<T, SpscPolicy> {
+private:
+    const int BUFFER_SIZE;
+    const size_t slot_count;        // BUFFER_SIZE + 1, so that full and empty can be told apart
+    std::unique_ptr<SlotStorage<T>[]> slots;
+
+    // Producer side
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head{0};  // Producer writes at the head end
+    size_t cached_tail = 0;
+
+    // Consumer side
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail{0};  // Consumer reads at the tail end
+    size_t cached_head = 0;
+
+    std::atomic<bool> closed{false};    // Set by close()
+    OverflowControl<T> overflow;        // Never DropOldest: the producer cannot move tail
+
+    alignas(CACHE_LINE_SIZE) BufferStats stats;
+    // Live depth and high-watermark for snapshot(). Each side only writes its own count; the producer
+    // reads the consumer's once per lap, when it wraps around, so the high watermark is sampled there.
+    OccupancyCounters occupancy;
+
+    // The coroutines parked in async_produce() and async_consume(), at most one each. While one is
+    // parked its side is idle, and the thread that takes it out of here owns that side until it has
+    // completed the waiter.
+    alignas(CACHE_LINE_SIZE) std::atomic<AsyncWaiter*> parked_producer{nullptr};
+    std::atomic<AsyncWaiter*> parked_consumer{nullptr};
+
+    uint64_t start_time;        // CycleClock ticks
+
+    size_t advance(size_t index) const {
+        return index + 1 == slot_count ? 0 : index + 1;
+    }
+
+public:
+    explicit LinkedListBuffer(int buffer_size = 10, OverflowPolicy policy = OverflowPolicy::Block, OverflowHandler<T> on_overflow = {})
+        : BUFFER_SIZE(std::max(buffer_size, 1)), slot_count(static_cast<size_t>(BUFFER_SIZE) + 1),
+          slots(new SlotStorage<T>[slot_count]), overflow(withoutEviction(policy), std::move(on_overflow)) {
+        start_time = CycleClock::now();
+    }
+
+    ~LinkedListBuffer() {
+        size_t end = head.load();
+        for (size_t i = tail.load(); i != end; i = advance(i)) slots[i].destroy();
+    }
+
+    int capacity() const {
+        return BUFFER_SIZE;
+    }
+
+    OverflowPolicy overflowPolicy() const {
+        return overflow.policy();
+    }
+
+    uint64_t droppedCount() const {
+        return overflow.droppedCount();
+    }
+
+    void produce(const T& item, int producer_id) {
+        emplace(producer_id, item);
+    }
+
+    void produce(T&& item, int producer_id) {
+        emplace(producer_id, std::move(item));
+    }
+
+    template <typename... Args>
+    void emplace(int producer_id, Args&&... args) {
+        emplaceWithin(WaitDeadline::forever(), producer_id, std::forward<Args>(args)...);
+    }
+
+    T consume(int consumer_id) {
+        return *consumeWithin(WaitDeadline::forever(), consumer_id);
+    }
+
+    // Writes as many items as there is room for and publishes them with one store, repeating
+    // (and waiting for space) until all are in; under a dropping overflow policy the rest overflows instead
+    void produce_bulk(std::span<const T> items, int producer_id) {
+        if (items.empty()) return;
+        uint64_t request_time = CycleClock::now();
+        uint64_t first_ready = 0;
+        uint64_t now = 0;
+        bool drops = overflow.dropsWhenFull(WaitDeadline::forever());
+
+        size_t done = 0;
+        while (done < items.size()) {
+            size_t pos = head.load(std::memory_order_relaxed);
+            if (drops && !hasSpace(pos)) break;
+            waitFor(BufferOp::Produce, [&] { return hasSpace(pos); }, WaitDeadline::forever());
+            if (done == 0) first_ready = CycleClock::now();
+
+            size_t run_start = done;
+            while (done < items.size() && hasSpace(pos)) {
+                slots[pos].construct(items[done++]);
+                pos = advance(pos);
+            }
+            occupancy.enqueued(done - run_start);
+            bool wrapped = pos < head.load(std::memory_order_relaxed);
+            head.store(pos, std::memory_order_release);
+            if (wrapped) occupancy.published();
+
+            now = CycleClock::now();
+            for (size_t i = run_start; i < done; ++i)
+                buffer_logger.log(LogRole::Producer, producer_id, logValue(items[i]), CycleClock::toNs(now - start_time), CycleClock::toNs(first_ready - request_time));
+            if (consumerParked()) resumeConsumer();
+        }
+        for (size_t i = done; i < items.size(); ++i) overflow.reject(items[i]);
+        if (done > 0) stats.record(BufferOp::Produce, request_time, first_ready, now, CycleClock::now(), done);
+    }
+
+    // Waits for at least one item, then takes up to min(out.size(), max) published items and frees
+    // their slots with one store. Returns the number of items written to out.
+    size_t consume_bulk(std::span<T> out, size_t max, int consumer_id) {
+        size_t limit = std::min(out.size(), max);
+        if (limit == 0) return 0;
+        uint64_t request_time = CycleClock::now();
+
+        size_t pos = tail.load(std::memory_order_relaxed);
+        waitFor(BufferOp::Consume, [&] { return hasItem(pos); }, WaitDeadline::forever());
+        uint64_t ready_time = CycleClock::now();
+
+        size_t count = 0;
+        while (count < limit && hasItem(pos)) {
+            out[count++] = slots[pos].take();
+            pos = advance(pos);
+        }
+        tail.store(pos, std::memory_order_release);
+        occupancy.dequeued(count);
+
+        uint64_t now = CycleClock::now();
+        for (size_t i = 0; i < count; ++i)
+            buffer_logger.log(LogRole::Consumer, consumer_id, logValue(out[i]), CycleClock::toNs(now - start_time), CycleClock::toNs(ready_time - request_time));
+        stats.record(BufferOp::Consume, request_time, ready_time, now, CycleClock::now(), count);
+        if (producerParked()) resumeProducer();
+        return count;
+    }
+
+    // Non-blocking and timed versions of produce() and consume(). They return false (nullopt) when
+    // the deadline passes without space (an item); the produce calls fail at once when the buffer
+    // is closed, and the consume calls once the buffer is closed and drained. item is only moved
+    // from when it was produced.
+    template <typename U>
+    bool try_produce(U&& item, int producer_id) {
+        return emplaceWithin(WaitDeadline::none(), producer_id, std::forward<U>(item));
+    }
+
+    template <typename U, typename Rep, typename Period>
+    bool produce_for(U&& item, const std::chrono::duration<Rep, Period>& timeout, int producer_id) {
+        return emplaceWithin(WaitDeadline::after(timeout), producer_id, std::forward<U>(item));
+    }
+
+    template <typename U>
+    bool produce_until(U&& item, std::chrono::steady_clock::time_point deadline, int producer_id) {
+        return emplaceWithin(WaitDeadline::at(deadline), producer_id, std::forward<U>(item));
+    }
+
+    std::optional<T> try_consume(int consumer_id) {
+        return consumeWithin(WaitDeadline::none(), consumer_id);
+    }
+
+    template <typename Rep, typename Period>
+    std::optional<T> consume_for(const std::chrono::duration<Rep, Period>& timeout, int consumer_id) {
+        return consumeWithin(WaitDeadline::after(timeout), consumer_id);
+    }
+
+    std::optional<T> consume_until(std::chrono::steady_clock::time_point deadline, int consumer_id) {
+        return consumeWithin(WaitDeadline::at(deadline), consumer_id);
+    }
+
+    // No more items are coming: the try_/timed produce calls fail from now on, the try_/timed consume
+    // calls still take the items left but stop waiting once the buffer is empty, and the threads
+    // waiting in them return. The blocking produce() and consume() are not affected.
+    void close() {
+        closed.store(true, std::memory_order_seq_cst);
+    }
+
+    bool isClosed() const {
+        return closed.load(std::memory_order_acquire);
+    }
+
+    std::vector<double> Stats() {
+        std::vector<double> time_stat;
+        time_stat.push_back(stats.summary(BufferOp::Produce).total_seconds);
+        time_stat.push_back(stats.summary(BufferOp::Consume).total_seconds);
+        return time_stat;
+    }
+
+    LatencySummary latency(BufferOp op) {
+        return stats.summary(op);
+    }
+
+    // co_await async_produce(item, id) and co_await async_consume(id) work like produce() and consume(),
+    // but while the buffer is full (empty) they park the coroutine rather than the thread. The consumer
+    // that frees a slot (the producer that publishes an item) completes and resumes it. A parked
+    // operation still counts as the one producer (consumer): no other call on its side may run until it resumes.
+    template <typename U>
+    ProduceAwaiter<LinkedListBuffer, T> async_produce(U&& item, int producer_id) {
+        return {*this, std::forward<U>(item), producer_id};
+    }
+
+    ConsumeAwaiter<LinkedListBuffer, T> async_consume(int consumer_id) {
+        return {*this, consumer_id};
+    }
+
+    // Live view for a monitoring thread. blocked_producers (blocked_consumers) is 1 while the producer
+    // (consumer) has given up spinning and yields for space (an item).
+    BufferSnapshot snapshot() {
+        BufferSnapshot s = occupancy.snapshot();
+        s.dropped = overflow.droppedCount();
+        s.produce = stats.summary(BufferOp::Produce);
+        s.consume = stats.summary(BufferOp::Consume);
+        return s;
+    }
+
+private:
+    friend class ::ConsumeAwaiter<LinkedListBuffer, T>;
+    friend class ::ProduceAwaiter<LinkedListBuffer, T>;
+
+    template <typename... Args>
+    bool emplaceWithin(const WaitDeadline& deadline, int producer_id, Args&&... args) {
+        if (deadline.endsOnClose() && closed.load(std::memory_order_acquire)) return false;
+        uint64_t request_time = CycleClock::now();
+
+        size_t pos = head.load(std::memory_order_relaxed);
+        size_t next = advance(pos);
+        if (overflow.dropsWhenFull(deadline) && !hasSpace(pos)) {
+            overflow.reject(std::forward<Args>(args)...);
+            return false;
+        }
+        if (!waitFor(BufferOp::Produce, [&] { return hasSpace(pos); }, deadline)) return false;
+        uint64_t ready_time = CycleClock::now();
+
+        slots[pos].construct(std::forward<Args>(args)...);
+        int64_t logged_value = logValue(slots[pos].get());
+        occupancy.enqueued(1);
+        head.store(next, std::memory_order_release);
+        if (next == 0) occupancy.published();
+
+        uint64_t now = CycleClock::now();
+        buffer_logger.log(LogRole::Producer, producer_id, logged_value, CycleClock::toNs(now - start_time), CycleClock::toNs(ready_time - request_time));
+        stats.record(BufferOp::Produce, request_time, ready_time, now, CycleClock::now());
+        if (consumerParked()) resumeConsumer();
+        return true;
+    }
+
+    std::optional<T> consumeWithin(const WaitDeadline& deadline, int consumer_id) {
+        uint64_t request_time = CycleClock::now();
+
+        size_t pos = tail.load(std::memory_order_relaxed);
+        if (!waitFor(BufferOp::Consume, [&] { return hasItem(pos); }, deadline)) return std::nullopt;
+        uint64_t ready_time = CycleClock::now();
+
+        int64_t logged_value = logValue(slots[pos].get());
+        T item = slots[pos].take();
+        tail.store(advance(pos), std::memory_order_release);
+        occupancy.dequeued(1);
+
+        uint64_t now = CycleClock::now();
+        buffer_logger.log(LogRole::Consumer, consumer_id, logged_value, CycleClock::toNs(now - start_time), CycleClock::toNs(ready_time - request_time));
+        stats.record(BufferOp::Consume, request_time, ready_time, now, CycleClock::now());
+        if (producerParked()) resumeProducer();
+        return item;
+    }
+
+    // Parks waiter unless there is a free slot; returns false if its item was written at once.
+    // Parking and the consumer's producerParked() are both seq_cst read-modify-writes of
+    // parked_producer, as in AsyncWaiterQueue, so either the re-check sees the slot the consumer
+    // freed or the consumer sees the waiter. Once the waiter is out, the consumer may be using the
+    // producer's fields, so the re-check compares tail with a copy taken before.
+    bool suspendProducer(ItemWaiter<T>& waiter) {
+        while (!hasSpace(head.load(std::memory_order_relaxed))) {
+            size_t seen_tail = cached_tail;
+            parked_producer.exchange(&waiter, std::memory_order_seq_cst);
+            if (tail.load(std::memory_order_relaxed) == seen_tail) return true;
+            // A slot was freed meanwhile: take the waiter back, unless the consumer already has it
+            if (parked_producer.exchange(nullptr, std::memory_order_acquire) != &waiter) return true;
+        }
+        completeProducer(waiter);
+        return false;
+    }
+
+    // Parks waiter unless an item is ready; returns false if it was handed one at once
+    bool suspendConsumer(ItemWaiter<T>& waiter) {
+        while (!hasItem(tail.load(std::memory_order_relaxed))) {
+            size_t seen_head = cached_head;
+            parked_consumer.exchange(&waiter, std::memory_order_seq_cst);
+            if (head.load(std::memory_order_relaxed) == seen_head) return true;
+            if (parked_consumer.exchange(nullptr, std::memory_order_acquire) != &waiter) return true;
+        }
+        completeConsumer(waiter);
+        return false;
+    }
+
+    // Producer, after publishing (consumer, after freeing a slot)
+    bool consumerParked() {
+        return parked_consumer.fetch_add(0, std::memory_order_seq_cst) != nullptr;
+    }
+
+    bool producerParked() {
+        return parked_producer.fetch_add(0, std::memory_order_seq_cst) != nullptr;
+    }
+
+    // Producer: hands the parked consumer an item and resumes it on this thread. If the consumer
+    // took the item this produce published before it parked, the waiter goes back.
+    void resumeConsumer() {
+        AsyncWaiter* parked = parked_consumer.exchange(nullptr, std::memory_order_acquire);
+        if (!parked) return;
+        if (!hasItem(tail.load(std::memory_order_relaxed))) {
+            parked_consumer.store(parked, std::memory_order_release);
+            return;
+        }
+        completeConsumer(static_cast<ItemWaiter<T>&>(*parked));
+        parked->handle.resume();
+    }
+
+    // Consumer: writes the parked producer's item into the freed slot and resumes it on this thread
+    void resumeProducer() {
+        AsyncWaiter* parked = parked_producer.exchange(nullptr, std::memory_order_acquire);
+        if (!parked) return;
+        if (!hasSpace(head.load(std::memory_order_relaxed))) {
+            parked_producer.store(parked, std::memory_order_release);
+            return;
+        }
+        completeProducer(static_cast<ItemWaiter<T>&>(*parked));
+        parked->handle.resume();
+    }
+
+    // Producer side, with a free slot at head: writes waiter's item, then logs and records it
+    void completeProducer(ItemWaiter<T>& waiter) {
+        uint64_t ready_time = CycleClock::now();
+        size_t pos = head.load(std::memory_order_relaxed);
+        size_t next = advance(pos);
+        slots[pos].construct(waiter.item.take());
+        int64_t logged_value = logValue(slots[pos].get());
+        occupancy.enqueued(1);
+        head.store(next, std::memory_order_release);
+        if (next == 0) occupancy.published();
+
+        uint64_t now = CycleClock::now();
+        buffer_logger.log(LogRole::Producer, waiter.thread_id, logged_value, CycleClock::toNs(now - start_time), CycleClock::toNs(ready_time - waiter.request_time));
+        stats.record(BufferOp::Produce, waiter.request_time, ready_time, now, CycleClock::now());
+        if (consumerParked()) resumeConsumer();
+    }
+
+    // Consumer side, with an item at tail: moves it into waiter, then logs and records it
+    void completeConsumer(ItemWaiter<T>& waiter) {
+        uint64_t ready_time = CycleClock::now();
+        size_t pos = tail.load(std::memory_order_relaxed);
+        waiter.item.construct(slots[pos].take());
+        tail.store(advance(pos), std::memory_order_release);
+        occupancy.dequeued(1);
+
+        uint64_t now = CycleClock::now();
+        buffer_logger.log(LogRole::Consumer, waiter.thread_id, logValue(waiter.item.get()), CycleClock::toNs(now - start_time), CycleClock::toNs(ready_time - waiter.request_time));
+        stats.record(BufferOp::Consume, waiter.request_time, ready_time, now, CycleClock::now());
+        if (producerParked()) resumeProducer();
+    }
+
+    // Producer: is there a free slot at pos? Re-reads tail only when the cached copy says full.
+    bool hasSpace(size_t pos) {
+        size_t next = advance(pos);
+        if (next != cached_tail) return true;
+        cached_tail = tail.load(std::memory_order_acquire);
+        return next != cached_tail;
+    }
+
+    // Consumer: is there an item at pos? Re-reads head only when the cached copy says empty.
+    bool hasItem(size_t pos) {
+        if (pos != cached_head) return true;
+        cached_head = head.load(std::memory_order_acquire);
+        return pos != cached_head;
+    }
+
+    // Spins briefly, then yields until ready(); false if the deadline runs out first. While it yields
+    // the thread counts as blocked on side in the snapshot.
+    template <typename Ready>
+    bool waitFor(BufferOp side, Ready ready, const WaitDeadline& deadline) {
+        Backoff backoff;
+        bool yielding = false;
+        bool ok = true;
+        while (!ready()) {
+            if (deadline.passed(closed)) {
+                ok = false;
+                break;
+            }
+            if (backoff.spin()) continue;
+            if (!yielding) occupancy.blockedCount(side).store(1, std::memory_order_relaxed);
+            yielding = true;
+            std::this_thread::yield();
+        }
+        if (yielding) occupancy.blockedCount(side).store(0, std::memory_order_relaxed);
+        return ok;
+    }
+};
+
+// -------------------- Ring Buffer --------------------
+// Contiguous bounded MPMC ring (Vyukov-style) as an alternative to the circular Node list.
+// Every slot carries a sequence number that tells producers and consumers whose turn it is:
+//   sequence == pos       -> slot is empty and may be filled by the producer that claims pos
+//   sequence == pos + 1   -> slot holds the item for the consumer that claims pos
+// A claimed slot is handed back for the next lap by setting sequence = pos + capacity.
+// Slots and both indices sit on their own cache lines, so the only lines shared between
+// producers and consumers are the slots being handed off.
+template <typename T>
+struct alignas(CACHE_LINE_SIZE) RingSlot {
+    std::atomic<size_t> sequence;
+    SlotStorage<T> data;
+};
+
+template <typename T>
+class RingBuffer {
+private:
+    std::vector<RingSlot<T>> slots;
+    const size_t mask;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> enqueue_pos{0};  // Producers claim positions here
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> dequeue_pos{0};  // Consumers claim positions here
+    std::atomic<bool> closed{false};    // Set by close()
+    OverflowControl<T> overflow;
+
+    alignas(CACHE_LINE_SIZE) BufferStats stats;
+
+    uint64_t start_time;        // CycleClock ticks
+
+    static size_t roundUpToPowerOfTwo(size_t n) {
+        size_t p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+public:
+    // Capacity is rounded up to a power of two so that positions map to slots with a mask
+    explicit RingBuffer(size_t requested_capacity, OverflowPolicy policy = OverflowPolicy::Block, OverflowHandler<T> on_overflow = {})
+        : slots(roundUpToPowerOfTwo(std::max<size_t>(requested_capacity, 2))), mask(slots.size() - 1),
+          overflow(policy, std::move(on_overflow)) {
+        for (size_t i = 0; i < slots.size(); ++i)
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        start_time = CycleClock::now();
+    }
+
+    ~RingBuffer() {
+        size_t end = enqueue_pos.load();
+        for (size_t pos = dequeue_pos.load(); pos != end; ++pos) {
+            RingSlot<T>& slot = slots[pos & mask];
+            if (slot.sequence.load() == pos + 1) slot.data.destroy();
+        }
+    }
+
+    size_t capacity() const {
+        return slots.size();
+    }
+
+    OverflowPolicy overflowPolicy() const {
+        return overflow.policy();
+    }
+
+    // Items the overflow policy turned away or, with DropOldest, evicted
+    uint64_t droppedCount() const {
+        return overflow.droppedCount();
+    }
+
+    void produce(const T& item, int producer_id) {
+        emplace(producer_id, item);
+    }
+
+    void produce(T&& item, int producer_id) {
+        emplace(producer_id, std::move(item));
+    }
+
+    // Constructs the item directly in the claimed slot from args
+    template <typename... Args>
+    void emplace(int producer_id, Args&&... args) {
+        emplaceWithin(WaitDeadline::forever(), producer_id, std::forward<Args>(args)...);
+    }
+
+    T consume(int consumer_id) {
+        return *consumeWithin(WaitDeadline::forever(), consumer_id);
+    }
+
+    // Claims a run of consecutive free slots with a single CAS on enqueue_pos, fills them and then
+    // publishes them. Loops until every item is in; the run is cut short only where the ring is full.
+    // Under DropNewest or Callback the items that do not fit overflow; DropOldest evicts to make room.
+    void produce_bulk(std::span<const T> items, int producer_id) {
+        if (items.empty()) return;
+        uint64_t request_time = CycleClock::now();
+        uint64_t first_claimed = 0;
+        uint64_t now = 0;
+        bool drops = overflow.dropsWhenFull(WaitDeadline::forever());
+
+        size_t done = 0;
+        while (done < items.size()) {
+            size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+            size_t run = 0;
+            while (run < items.size() - done && run <= mask &&
+                   slots[(pos + run) & mask].sequence.load(std::memory_order_acquire) == pos + run) {
+                run++;
+            }
+            if (run == 0) {
+                // Either the ring is full or another producer moved enqueue_pos; look again
+                size_t seq = slots[pos & mask].sequence.load(std::memory_order_acquire);
+                if (static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos) < 0) {
+                    if (!drops) std::this_thread::yield();
+                    else if (overflow.policy() == OverflowPolicy::DropOldest) evictOldest(pos, seq);
+                    else break;
+                }
+                continue;
+            }
+            if (!enqueue_pos.compare_exchange_weak(pos, pos + run, std::memory_order_relaxed)) continue;
+            if (done == 0) first_claimed = CycleClock::now();
+
+            for (size_t i = 0; i < run; ++i)
+                slots[(pos + i) & mask].data.construct(items[done + i]);
+            for (size_t i = 0; i < run; ++i)
+                slots[(pos + i) & mask].sequence.store(pos + i + 1, std::memory_order_release);
+
+            now = CycleClock::now();
+            for (size_t i = 0; i < run; ++i)
+                buffer_logger.log(LogRole::Producer, producer_id, logValue(items[done + i]), CycleClock::toNs(now - start_time), CycleClock::toNs(now - request_time));
+            done += run;
+        }
+        for (size_t i = done; i < items.size(); ++i) overflow.reject(items[i]);
+
+        if (done > 0) stats.record(BufferOp::Produce, request_time, first_claimed, now, CycleClock::now(), done);
+    }
+
+    // Waits for at least one item, then claims the run of ready slots (up to min(out.size(), max))
+    // with a single CAS on dequeue_pos. Returns the number of items written to out.
+    size_t consume_bulk(std::span<T> out, size_t max, int consumer_id) {
+        size_t limit = std::min(out.size(), max);
+        if (limit == 0) return 0;
+        uint64_t request_time = CycleClock::now();
+
+        size_t pos;
+        size_t run;
+        while (true) {
+            pos = dequeue_pos.load(std::memory_order_relaxed);
+            run = 0;
+            while (run < limit && run <= mask &&
+                   slots[(pos + run) & mask].sequence.load(std::memory_order_acquire) == pos + run + 1) {
+                run++;
+            }
+            if (run == 0) {
+                if (static_cast<std::intptr_t>(slots[pos & mask].sequence.load(std::memory_order_acquire)) - static_cast<std::intptr_t>(pos + 1) < 0)
+                    std::this_thread::yield();
+                continue;
+            }
+            if (dequeue_pos.compare_exchange_weak(pos, pos + run, std::memory_order_relaxed)) break;
+        }
+        uint64_t claimed_time = CycleClock::now();
+
+        for (size_t i = 0; i < run; ++i) {
+            RingSlot<T>& slot = slots[(pos + i) & mask];
+            out[i] = slot.data.take();
+            slot.sequence.store(pos + i + mask + 1, std::memory_order_release);
+        }
+
+        uint64_t now = CycleClock::now();
+        for (size_t i = 0; i < run; ++i)
+            buffer_logger.log(LogRole::Consumer, consumer_id, logValue(out[i]), CycleClock::toNs(now - start_time), CycleClock::toNs(now - request_time));
+
+        stats.record(BufferOp::Consume, request_time, claimed_time, now, CycleClock::now(), run);
+
+        return run;
+    }
+
+    // Non-blocking and timed versions of produce() and consume(). They return false (nullopt) when
+    // the deadline passes without space (an item); the produce calls fail at once when the buffer
+    // is closed, and the consume calls once the buffer is closed and drained. item is only moved
+    // from when it was produced.
+    template <typename U>
+    bool try_produce(U&& item, int producer_id) {
+        return emplaceWithin(WaitDeadline::none(), producer_id, std::forward<U>(item));
+    }
+
+    template <typename U, typename Rep, typename Period>
+    bool produce_for(U&& item, const std::chrono::duration<Rep, Period>& timeout, int producer_id) {
+        return emplaceWithin(WaitDeadline::after(timeout), producer_id, std::forward<U>(item));
+    }
+
+    template <typename U>
+    bool produce_until(U&& item, std::chrono::steady_clock::time_point deadline, int producer_id) {
+        return emplaceWithin(WaitDeadline::at(deadline), producer_id, std::forward<U>(item));
+    }
+
+    std::optional<T> try_consume(int consumer_id) {
+        return consumeWithin(WaitDeadline::none(), consumer_id);
+    }
+
+    template <typename Rep, typename Period>
+    std::optional<T> consume_for(const std::chrono::duration<Rep, Period>& timeout, int consumer_id) {
+        return consumeWithin(WaitDeadline::after(timeout), consumer_id);
+    }
+
+    std::optional<T> consume_until(std::chrono::steady_clock::time_point deadline, int consumer_id) {
+        return consumeWithin(WaitDeadline::at(deadline), consumer_id);
+    }
+
+    // No more items are coming: the try_/timed produce calls fail from now on, the try_/timed consume
+    // calls still take the items left but stop waiting once the buffer is empty, and the threads
+    // waiting in them return. The blocking produce() and consume() are not affected.
+    void close() {
+        closed.store(true, std::memory_order_seq_cst);
+    }
+
+    bool isClosed() const {
+        return closed.load(std::memory_order_acquire);
+    }
+
+    std::vector<double> Stats() {
+        std::vector<double> time_stat;
+        time_stat.push_back(stats.summary(BufferOp::Produce).total_seconds);
+        time_stat.push_back(stats.summary(BufferOp::Consume).total_seconds);
+        return time_stat;
+    }
+
+    LatencySummary latency(BufferOp op) {
+        return stats.summary(op);
+    }
+
+private:
+    template <typename... Args>
+    bool emplaceWithin(const WaitDeadline& deadline, int producer_id, Args&&... args) {
+        if (deadline.endsOnClose() && closed.load(std::memory_order_acquire)) return false;
+        uint64_t request_time = CycleClock::now();
+
+        RingSlot<T>* slot;
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            slot = &slots[pos & mask];
+            size_t seq = slot->sequence.load(std::memory_order_acquire);
+            std::intptr_t diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+            if (diff == 0) {
+                // The slot is free for this lap; try to claim the position
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                // The ring is full; wait for a consumer to free the slot, or apply the overflow policy
+                if (!overflow.dropsWhenFull(deadline)) {
+                    if (deadline.passed(closed)) return false;
+                    std::this_thread::yield();
+                } else if (overflow.policy() == OverflowPolicy::DropOldest) {
+                    evictOldest(pos, seq);
+                } else {
+                    overflow.reject(std::forward<Args>(args)...);
+                    return false;
+                }
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            } else {
+                // Another producer claimed this position first
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        uint64_t claimed_time = CycleClock::now();
+
+        slot->data.construct(std::forward<Args>(args)...);
+        int64_t logged_value = logValue(slot->data.get());
+        slot->sequence.store(pos + 1, std::memory_order_release);
+
+        uint64_t now = CycleClock::now();
+
+        // Logging
+        buffer_logger.log(LogRole::Producer, producer_id, logged_value, CycleClock::toNs(now - start_time), CycleClock::toNs(now - request_time));
+
+        stats.record(BufferOp::Produce, request_time, claimed_time, now, CycleClock::now());
+        return true;
+    }
+
+    std::optional<T> consumeWithin(const WaitDeadline& deadline, int consumer_id) {
+        uint64_t request_time = CycleClock::now();
+
+        RingSlot<T>* slot;
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            slot = &slots[pos & mask];
+            size_t seq = slot->sequence.load(std::memory_order_acquire);
+            std::intptr_t diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                // The ring is empty; wait for a producer to fill the slot
+                if (deadline.passed(closed)) return std::nullopt;
+                std::this_thread::yield();
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        uint64_t claimed_time = CycleClock::now();
+
+        int64_t logged_value = logValue(slot->data.get());
+        T item = slot->data.take();
+        // Hand the slot back to producers for the next lap
+        slot->sequence.store(pos + mask + 1, std::memory_order_release);
+
+        uint64_t now = CycleClock::now();
+
+        // Logging
+        buffer_logger.log(LogRole::Consumer, consumer_id, logged_value, CycleClock::toNs(now - start_time), CycleClock::toNs(now - request_time));
+
+        stats.record(BufferOp::Consume, request_time, claimed_time, now, CycleClock::now());
+
+        return item;
+    }
+
+    // DropOldest, with the ring full at pos: the slot for pos still holds the item of position
+    // pos - capacity. The producer claims that position on dequeue_pos as a consumer would, discards
+    // the item and hands the slot on to pos. If a consumer claimed it first, or its producer has not
+    // published it yet, there is nothing to evict and the caller looks again.
+    bool evictOldest(size_t pos, size_t seq) {
+        size_t oldest = pos - slots.size();
+        if (seq == oldest + 1) {
+            size_t expected = oldest;
+            if (dequeue_pos.compare_exchange_strong(expected, oldest + 1, std::memory_order_relaxed)) {
+                RingSlot<T>& slot = slots[oldest & mask];
+                slot.data.destroy();
+                slot.sequence.store(oldest + mask + 1, std::memory_order_release);
+                overflow.evicted();
+                return true;
+            }
+        }
+        std::this_thread::yield();
+        return false;
+    }
+};
+
+} // namespace finite_buffer
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+// Hazard pointers for safe memory reclamation in the lock-free buffers.
+//
+// Before dereferencing a shared node a thread publishes its address in one of its hazard slots.
+// A node that has been unlinked is retired instead of deleted, and it is only freed once a scan
+// finds it in no thread's hazard slots. Each thread owns one record holding HAZARDS_PER_THREAD slots.
+class HazardPointers {
+public:
+    static constexpr int HAZARDS_PER_THREAD = 3;
+
+    // Publishes the current value of src in the given slot and returns it once it is stable,
+    // i.e. src was not changed between reading it and the hazard becoming visible.
+    template <typename T>
+    static T* protect(int slot, const std::atomic<T*>& src) {
+        std::atomic<void*>& hazard = localRecord()->hazard[slot];
+        T* ptr = src.load(std::memory_order_acquire);
+        while (true) {
+            hazard.store(ptr, std::memory_order_seq_cst);
+            T* current = src.load(std::memory_order_acquire);
+            if (current == ptr) return ptr;
+            ptr = current;
+        }
+    }
+
+    // Publishes ptr directly. The caller must validate afterwards that ptr is still reachable
+    // (e.g. by re-reading the pointer it was loaded from) before dereferencing it.
+    template <typename T>
+    static void set(int slot, T* ptr) {
+        localRecord()->hazard[slot].store(ptr, std::memory_order_seq_cst);
+    }
+
+    static void clear(int slot) {
+        localRecord()->hazard[slot].store(nullptr, std::memory_order_release);
+    }
+
+    // Hands an unlinked node to the reclaimer; reclaim(ptr) runs once no hazard references it.
+    template <typename T>
+    static void retire(T* ptr, void (*reclaim)(void*) = &deleteAs<T>) {
+        ThreadState& state = localState();
+        state.retired.push_back({ptr, reclaim});
+        if (state.retired.size() >= scanThreshold()) scan(state);
+    }
+
+private:
+    struct Record {
+        std::atomic<void*> hazard[HAZARDS_PER_THREAD];
+        std::atomic<bool> active{true};
+        Record* next = nullptr;
+        Record() {
+            for (auto& h : hazard) h.store(nullptr, std::memory_order_relaxed);
+        }
+    };
+
+    struct Retired {
+        void* ptr;
+        void (*reclaim)(void*);
+    };
+
+    // Per-thread record and retired list. Whatever is still protected when the thread exits
+    // is handed over to the orphan list and freed by a later scan from another thread.
+    struct ThreadState {
+        Record* record = acquireRecord();
+        std::vector<Retired> retired;
+        std::vector<void*> scratch;     // reused by scan() so that reclaiming does not allocate
+
+        ~ThreadState() {
+            for (auto& h : record->hazard) h.store(nullptr, std::memory_order_release);
+            scan(*this);
+            if (!retired.empty()) {
+                std::lock_guard<std::mutex> lock(orphan_mutex);
+                orphans.insert(orphans.end(), retired.begin(), retired.end());
+            }
+            record->active.store(false, std::memory_order_release);
+        }
+    };
+
+    inline static std::atomic<Record*> records{nullptr};
+    inline static std::atomic<int> record_count{0};
+    inline static std::mutex orphan_mutex;
+    inline static std::vector<Retired> orphans;
+
+    template <typename T>
+    static void deleteAs(void* ptr) {
+        delete static_cast<T*>(ptr);
+    }
+
+    static ThreadState& localState() {
+        thread_local ThreadState state;
+        return state;
+    }
+
+    static Record* localRecord() {
+        return localState().record;
+    }
+
+    // Records are never freed; a thread first tries to reuse one left behind by an exited thread.
+    static Record* acquireRecord() {
+        for (Record* r = records.load(std::memory_order_acquire); r; r = r->next) {
+            bool expected = false;
+            if (!r->active.load(std::memory_order_relaxed) &&
+                r->active.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+                return r;
+            }
+        }
+        Record* r = new Record();
+        Record* old_head = records.load(std::memory_order_relaxed);
+        do {
+            r->next = old_head;
+        } while (!records.compare_exchange_weak(old_head, r, std::memory_order_release, std::memory_order_relaxed));
+        record_count.fetch_add(1, std::memory_order_relaxed);
+        return r;
+    }
+
+    static size_t scanThreshold() {
+        return 2 * HAZARDS_PER_THREAD * static_cast<size_t>(record_count.load(std::memory_order_relaxed)) + 16;
+    }
+
+    // Frees every retired node that no thread currently protects and keeps the rest.
+    static void scan(ThreadState& state) {
+        std::vector<Retired>& retired = state.retired;
+        {
+            std::unique_lock<std::mutex> lock(orphan_mutex, std::try_to_lock);
+            if (lock.owns_lock() && !orphans.empty()) {
+                retired.insert(retired.end(), orphans.begin(), orphans.end());
+                orphans.clear();
+            }
+        }
+
+        std::vector<void*>& protected_ptrs = state.scratch;
+        protected_ptrs.clear();
+        for (Record* r = records.load(std::memory_order_acquire); r; r = r->next) {
+            for (auto& h : r->hazard) {
+                void* p = h.load(std::memory_order_seq_cst);
+                if (p) protected_ptrs.push_back(p);
+            }
+        }
+        std::sort(protected_ptrs.begin(), protected_ptrs.end());
+
+        auto still_protected = std::partition(retired.begin(), retired.end(), [&](const Retired& r) {
+            return std::binary_search(protected_ptrs.begin(), protected_ptrs.end(), r.ptr);
+        });
+        for (auto it = still_protected; it != retired.end(); ++it) it->reclaim(it->ptr);
+        retired.erase(still_protected, retired.end());
+    }
+};
@@ -9,216 +9,40 @@
 #include <cmath>
 #include <sstream>
 #include <climits>
+#include <unordered_map>
+#include <algorithm>
+#include <deque>
 #include <SFML/Graphics.hpp>
 #include <SFML/System.hpp>
 #include <atomic>
+#include <span>
+#include "InfiniteBuffer.h"
+#include "LogAnalyzer.h"
+#include "TraceFile.h"
+#include "TracePlayback.h"
+#include "NodeBatch.h"
+#include "DriverConfig.h"
 using namespace std;
+using namespace infinite_buffer;
+using namespace log_analyzer;
 
-// Each node contains the data to be stored in it, a flag indicating whehter full or empty and a pointer to the next node.
-struct Node {
-    int data;
-    bool filled;
-    Node* next;
-    Node() : data(0), filled(false), next(nullptr) {}
-};
-
-// Custom made ticket lock
-
-// This lock helps in introducing fairness in the synchronization process as 
-// each producer/consumer is given a ticket value and is served in FIFO order
-class TicketLock {
-    private:
-        atomic<int> next_ticket{0};
-        atomic<int> now_serving{0};
-    
-    public:
-        void lock() {
-            int my_ticket = next_ticket.fetch_add(1);
-            while (now_serving.load() != my_ticket) {
-                this_thread::yield();  // Yield CPU to reduce contention
-            }
-        }
-    
-        void unlock() {
-            now_serving.fetch_add(1);
-        }
-
-    };
-
-// Infinite Buffer:-
-class LinkedListBuffer {
-private:
-    Node* head; // Producer writes at the head end
-    Node* tail; // Consumer reads at the tail end
-
-    TicketLock ticket_lock_producer;       // Mutex for synchronizing producers access to the buffer
-    mutex mutex_consumer;       // Mutex for synchronizing consumers access to the buffer
-    condition_variable cv_not_empty;        // Condition variable used by consumers to wait until an item is available
-
-    // Mutexes to protect access to performance statistics
-    mutex prod_stat_mutex;       
-    mutex cons_stat_mutex;
-
-    chrono::duration<double> total_produce_time{};      
-    chrono::duration<double> total_consume_time{};      
-        
-    chrono::steady_clock::time_point start_time;     
-
-
-public:
-    // A dummy node is always maintained which means that the buffer will never be empty.
-    // This is required to simplify edge case handling as head and tail pointers will never become null.
-    LinkedListBuffer() {
-        head = new Node();  // Initial dummy node
-        tail = head;        
-        start_time = chrono::steady_clock::now();       
-    }
-
-    
-
-
-    void produce(int item, int producer_id) {
-
-        auto request_lock_time = chrono::steady_clock::now();
-
-        // Acquiring ticket lock to ensure fair synchronization
-        ticket_lock_producer.lock();
-        auto acquired_lock_time = chrono::steady_clock::now();
-
-        auto wait_duration = acquired_lock_time - request_lock_time;
-        
-
-        head->data = item;
-        // Dynamically allocating a new node and linking it to the current node.
-        Node* new_node = new Node();
-        head->next = new_node;
-        head->filled = true;
-        head = new_node;
-        
-        auto now = chrono::steady_clock::now();
-        long long timestamp = chrono::duration_cast<chrono::microseconds>(now - start_time).count();
-        
-        double waited_ms = chrono::duration_cast<chrono::duration<double, milli>>(wait_duration).count();
-
-        // Logging
-        logEvent("[" + to_string(timestamp) + "us] Producer "+ to_string(producer_id)+" waited for "+to_string(waited_ms)+"ms and produced: "+to_string(item));
-        
-        // Releasing the producer lock
-        ticket_lock_producer.unlock();
-        // Notifying one of the waiting consumer threads
-        cv_not_empty.notify_one();
-        
-        auto end = chrono::steady_clock::now();
-
-        lock_guard<mutex> stats_lock(prod_stat_mutex);
-        total_produce_time += ((end - request_lock_time));
-    }
-
-    int consume(int consumer_id) {
-        auto request_lock_time = chrono::steady_clock::now();
-        
-        // First consumer acquires lock to ensure synchronization
-        unique_lock<mutex> lock(mutex_consumer);
-
-        cv_not_empty.wait(lock, [&]() {
-            return tail->filled;
-        });
-        auto acquired_lock_time = chrono::steady_clock::now();
-        
-        auto wait_duration = acquired_lock_time - request_lock_time;
-        
-        // Consuming the data item
-        int item = tail->data;
-        tail->filled = false;
-        
-        auto now = chrono::steady_clock::now();
-        long long timestamp = chrono::duration_cast<chrono::microseconds>(now - start_time).count();
-        
-        double waited_ms = chrono::duration_cast<chrono::duration<double, milli>>(wait_duration).count();
-
-        // Logging
-        logEvent()
-        logEvent("[" + to_string(timestamp) + "us] Consumer " + to_string(consumer_id)+" waited for "+to_string(waited_ms)+"ms and consumed: "+to_string(item));
-    
-        // Dynamically releasing the memory
-        Node* temp = tail;
-        tail = tail->next;
-        delete temp;
-        
-        // Releasing the lock.
-        lock.unlock();
-        
-        auto end = chrono::steady_clock::now();
-        lock_guard<mutex> stats_lock(cons_stat_mutex);
-        total_consume_time += (end - request_lock_time);
-    
-        return item;
-    }
-
-    vector<double> Stats() {
-        vector<double> time_stat;
-        time_stat.push_back(total_produce_time.count());
-        time_stat.push_back(total_consume_time.count());
-        return time_stat;
-    }
-
-private:
-    // Static mutex to ensure synchronized logging across all threads.
-    static mutex log_mutex;
-
-    static void logEvent(const string& event) {
-        lock_guard<mutex> lock(log_mutex);    
-        ofstream logFile("InfiniteBufferLogger.txt", ios::app);     
-        logFile << event << endl;
-    }
-};
-
-struct LogEvent {
-    long long timestamp;        
-    string type; // Producer or Consumer
-    int id;     // ID of the producer or consumer thread
-    int value;
-};
-
-// Visualizer class handles parsing log events and managing view state for graphical display of the buffer operations timeline
+// Visualizer class replays a trace of the run and manages view state for graphical display of the buffer operations timeline
 class Visualizer {
     sf::View view;     
     float scrollOffset = 0.0f;  
-private:
-    vector<LogEvent> events;   
-
-    void parseLogs() {
-        ifstream in("InfiniteBufferLogger.txt");
-        string line;
-
-        while (getline(in, line)) {
-            LogEvent e;
-
-            size_t ts_start = line.find('[');
-            size_t ts_end = line.find("us]");
-
-            if (ts_start == string::npos || ts_end == string::npos) continue;
-
-            string ts_str = line.substr(ts_start + 1, ts_end - ts_start - 1);
-            e.timestamp = stoll(ts_str);    // Converting string to long long
-
-            if(line.find("$") != string::npos) continue;
-
-            // Identifying whether the line represents a Producer or Consumer event
-            if (line.find("Producer") != string::npos) {
-                e.type = "Producer";
-                sscanf(line.c_str(), "[%*lldus] Producer %d produced: %d", &e.id, &e.value);
-            } else if (line.find("Consumer") != string::npos) {
-                e.type = "Consumer";
-                sscanf(line.c_str(), "[%*lldus] Consumer %d consumed: %d", &e.id, &e.value);
-            }
-            events.push_back(e);
-        }
-    }
+    string trace_path;
+    double speed;
 
 public:
+    Visualizer(string path, double playback_speed) : trace_path(std::move(path)), speed(playback_speed) {}
+
 void run() {
-    parseLogs();
+    // The trace is mapped, not parsed, so any run opens at once
+    TraceFile trace(trace_path);
+    if (!trace.isOpen()) {
+        cerr << "error: cannot read trace '" << trace_path << "' (record one with --trace)\n";
+        return;
+    }
 
     // Constants for visualizing nodes
     const int NODE_RADIUS = 25;
@@ -226,12 +50,41 @@ void run() {
     const int WINDOW_WIDTH = 1400;
     const int WINDOW_HEIGHT = 600;
 
+    // Grid layout: nodes fill rows left to right and wrap after max_x
+    const float first_x = 50, first_y = 100;
+    const float max_x = WINDOW_WIDTH - 100;
+    const float column_width = NODE_RADIUS * 2 + NODE_SPACING;
+    const float row_height = NODE_RADIUS * 2 + 30;
+    const size_t columns = static_cast<size_t>((max_x - first_x) / column_width) + 1;
+    const float CONSUMED_LINGER = 1.0f;     // Seconds (at --speed 1) a consumed node stays on screen before it is reclaimed
+    const double PACE_NS = 1e9 / 200;       // Trace nanoseconds played per second at --speed 1
+    const int64_t CONSUMED_LINGER_NS = static_cast<int64_t>(CONSUMED_LINGER * PACE_NS);
+    const size_t REPLAY_LIMIT = 1 << 16;    // Larger steps forward rebuild the nodes instead of replaying every record
+
     // Creating the window for rendering
     sf::RenderWindow window(sf::VideoMode(WINDOW_WIDTH, WINDOW_HEIGHT), "Infinite Buffer Producer-Consumer Visualisation");
     sf::Font font;
     font.loadFromFile("arial.ttf");
 
-    vector<pair<sf::CircleShape, sf::Text>> nodes;
+    // Nodes currently in the buffer, oldest first. Consumed nodes are reclaimed from the front.
+    // A node's sequence number is its production order; nodes[seq - front_seq] is node seq.
+    struct VisNode {
+        int value;
+        bool consumed;
+        int64_t consumed_at;
+        uint64_t next_same_value;   // Next live node with the same value, if any
+    };
+    deque<VisNode> nodes;
+    uint64_t front_seq = 0, next_seq = 0;
+
+    // Live (unconsumed) nodes by value: the oldest and newest of a chain linked through next_same_value,
+    // so that a consume finds its node in O(1) and repeated values are consumed oldest first
+    struct ValueChain {
+        uint64_t oldest, newest;
+    };
+    unordered_map<int, ValueChain> live_by_value;
+    NodeBatch batch(font, 16);
+    bool dirty = true;      // The batch is only rebuilt when the nodes or the view changed
 
     // FPS Display Setup
     sf::Clock fpsClock;
@@ -244,93 +97,124 @@ void run() {
     fpsText.setPosition(10, 10);
 
     // Time-based animation setup
-    if (events.empty()) return;  
-    long long startTime = events[0].timestamp; 
-    const float TIME_SCALE = 0.0002f; 
+    if (trace.size() == 0) return;  
+    TracePlayback playback(trace, PACE_NS, speed);
+    size_t applied = 0;     // The nodes show the first `applied` records of the trace
+
+    auto apply = [&](const LogRecord& r) {
+        int value = static_cast<int>(r.value);
+        if (r.role == LogRole::Producer) {
+            uint64_t seq = next_seq++;
+            nodes.push_back({value, false, 0, 0});
+            auto [chain, inserted] = live_by_value.try_emplace(value, ValueChain{seq, seq});
+            if (!inserted) {
+                nodes[chain->second.newest - front_seq].next_same_value = seq;
+                chain->second.newest = seq;
+            }
+        } 
+        else {
+            auto chain = live_by_value.find(value);
+            if (chain != live_by_value.end()) {
+                VisNode& node = nodes[chain->second.oldest - front_seq];
+                node.consumed = true;
+                node.consumed_at = r.timestamp_ns;
+                if (chain->second.oldest == chain->second.newest) live_by_value.erase(chain);
+                else chain->second.oldest = node.next_same_value;
+            }
+        }
+    };
 
-    sf::Clock globalClock; 
-    size_t current = 0;  
+    // Rebuilds the nodes as they stood after the first `to` records, at time t. In FIFO order the
+    // nodes still on screen (live, or consumed within the linger time) are the last ones produced,
+    // so only the records from the oldest of them on are replayed.
+    auto rebuild = [&](size_t to, int64_t t) {
+        nodes.clear();
+        live_by_value.clear();
+        front_seq = next_seq = 0;
+        uint64_t produced = trace.producedBefore(to), consumed = trace.consumedBefore(to);
+        uint64_t depth = produced > consumed ? produced - consumed : 0;
+        uint64_t lingering = consumed - trace.consumedBefore(min(to, trace.seek(t - CONSUMED_LINGER_NS)));
+        uint64_t shown = min(produced, depth + lingering);
+        for (size_t i = shown ? trace.producerRecord(produced - shown) : to; i < to; ++i) apply(trace[i]);
+        applied = to;
+    };
 
     view = window.getDefaultView();        // default view for the window
 
+    auto nodePosition = [&](size_t i) {
+        return sf::Vector2f(first_x + static_cast<float>(i % columns) * column_width,
+                            first_y + static_cast<float>(i / columns) * row_height);
+    };
+
     // This loop runs as long as visualizer runs
     while (window.isOpen()) {
         sf::Event event;
         while (window.pollEvent(event)) {
             if (event.type == sf::Event::Closed)
                 window.close();   
-            else if (event.type == sf::Event::MouseWheelScrolled)
+            else if (playback.handle(event, window))
+                continue;
+            else if (event.type == sf::Event::MouseWheelScrolled) {
                 view.move(0, -event.mouseWheelScroll.delta * 30); 
+                dirty = true;
+            }
         }
 
-        window.clear(sf::Color(30, 30, 30));
-        window.setView(view);
-
-        float x = 50, y = 100;  
-        const float max_x = WINDOW_WIDTH - 100;  
-
-        for (size_t i = 0; i < nodes.size(); ++i) {
-            auto& [circle, text] = nodes[i];
-            if (x > max_x) {
-                x = 50;    
-                y += NODE_RADIUS * 2 + 30;  
-            }
-            circle.setPosition(x, y);
-            text.setPosition(x + 5, y + 5);
-            x += NODE_RADIUS * 2 + NODE_SPACING;   
+        // Bringing the nodes to the playback time: replaying the records up to it, or rebuilding
+        // the nodes when playback went back or far ahead
+        float frameTime = fpsClock.restart().asSeconds();
+        int64_t now = playback.advance(frameTime);
+        size_t target = trace.seek(now + 1);
+        if (target < applied || target - applied > REPLAY_LIMIT) {
+            rebuild(target, now);
+            dirty = true;
+        }
+        for (; applied < target; ++applied) {
+            apply(trace[applied]);
+            dirty = true;
         }
 
-        for (size_t i = 1; i < nodes.size(); ++i) {
-            sf::Vertex line[] = {
-                sf::Vertex(nodes[i - 1].first.getPosition() + sf::Vector2f(NODE_RADIUS, NODE_RADIUS), sf::Color::White),
-                sf::Vertex(nodes[i].first.getPosition() + sf::Vector2f(NODE_RADIUS, NODE_RADIUS), sf::Color::White)
-            };
-            window.draw(line, 2, sf::Lines);
+        // Reclaiming consumed nodes once they have been shown for a while
+        while (!nodes.empty() && nodes.front().consumed && now - nodes.front().consumed_at >= CONSUMED_LINGER_NS) {
+            nodes.pop_front();
+            front_seq++;
+            dirty = true;
         }
 
-        float currentTime = globalClock.getElapsedTime().asSeconds();
-        while (current < events.size() && (events[current].timestamp - startTime) * TIME_SCALE <= currentTime) {
-            auto& e = events[current];
-            if (e.type == "Producer") {
-                sf::CircleShape node(NODE_RADIUS);
-                node.setFillColor(sf::Color::Blue);
-                node.setOutlineThickness(2);
-                node.setOutlineColor(sf::Color::White);
-
-                sf::Text txt;
-                txt.setFont(font);
-                txt.setString(to_string(e.value));
-                txt.setCharacterSize(16);
-                txt.setFillColor(sf::Color::White);
-
-                nodes.push_back({ node, txt });
-            } 
-            else if (e.type == "Consumer") {
-                for (auto& [circle, text] : nodes) {
-                    if (text.getString() == to_string(e.value)) {
-                        circle.setFillColor(sf::Color::Red);
-                        text.setString("");
-                        break;
-                    }
-                }
+        // Rebuilding the geometry of the rows inside the view only
+        if (dirty) {
+            batch.clear();
+            float top = view.getCenter().y - view.getSize().y / 2;
+            float bottom = view.getCenter().y + view.getSize().y / 2;
+            long first_row = max(0L, static_cast<long>(floor((top - first_y - NODE_RADIUS * 2) / row_height)));
+            long last_row = static_cast<long>(floor((bottom - first_y) / row_height)) + 1;
+            size_t begin = min(nodes.size(), static_cast<size_t>(first_row) * columns);
+            size_t end = last_row < 0 ? 0 : min(nodes.size(), static_cast<size_t>(last_row + 1) * columns);
+            const sf::Vector2f center_offset(NODE_RADIUS, NODE_RADIUS);
+
+            for (size_t i = max<size_t>(begin, 1); i < end; ++i)
+                batch.addLine(nodePosition(i - 1) + center_offset, nodePosition(i) + center_offset, sf::Color::White);
+            for (size_t i = begin; i < end; ++i) {
+                sf::Vector2f pos = nodePosition(i);
+                batch.addCircle(pos + center_offset, NODE_RADIUS, nodes[i].consumed ? sf::Color::Red : sf::Color::Blue, sf::Color::White, 2);
+                if (!nodes[i].consumed) batch.addNumber(nodes[i].value, pos + sf::Vector2f(5, 5), sf::Color::White);
             }
-            current++;    
+            dirty = false;
         }
 
         // FPS update
         frameCount++;
-        elapsedTime += fpsClock.restart().asSeconds();
+        elapsedTime += frameTime;
         if (elapsedTime >= 1.0f) {
-            fpsText.setString("FPS: " + to_string(frameCount));
+            fpsText.setString("FPS: " + to_string(frameCount) + " | Nodes: " + to_string(nodes.size()));
             frameCount = 0;
             elapsedTime = 0;
         }
 
-        for (auto& [circle, text] : nodes) {
-            window.draw(circle);
-            window.draw(text);
-        }
-
+        window.clear(sf::Color(30, 30, 30));
+        window.setView(view);
+        batch.draw(window);
+        playback.draw(window, font);
         window.draw(fpsText); 
         window.display();   
     }
@@ -338,160 +222,299 @@ void run() {
 };
 
 
-mutex LinkedListBuffer::log_mutex;
-
 // Threads information by defualt
-const int NUM_PRODUCERS = 5;
-const int NUM_CONSUMERS = 3;
-const int ITEMS_PER_PRODUCER = 30;
-const int ITEMS_PER_CONSUMER = 50;
-
-LinkedListBuffer buffer;  
-
-void producer(int id) {
-    for (int i = 0; i < ITEMS_PER_PRODUCER; ++i) {
+// All buffer implementations share the same driver so that they can be compared directly.
+// The ticket-locked buffer is the default; pass --mcs for the MCS-locked one, --lock-free for the lock-free one
+// --sharded for the work-stealing one with a shard per producer, --hybrid for the ring of --capacity slots
+// that spills into linked segments, --segmented for the lock-free queue of --segment-size slot segments,
+// --numa for the sharded buffer with one shard per NUMA node (pin the threads with --pin-*), or --priority
+// for the buffer of --lanes priority lanes. The other parameters are in DriverConfig.h.
+const vector<string> BUFFER_NAMES = {"ticket", "mcs", "lock-free", "sharded", "hybrid", "segmented", "numa", "priority"};
+
+template <typename Buffer>
+void producer(Buffer& buffer, int id, const DriverConfig& cfg) {
+    for (int i = 0; i < cfg.items_per_producer; ++i) {
         int item = id * 1000 + i;   
-        this_thread::sleep_for(chrono::milliseconds(10));   // Simulating the work done by producer
-        buffer.produce(item, id); 
+        if (cfg.produce_sleep_ms > 0)
+            this_thread::sleep_for(chrono::milliseconds(cfg.produce_sleep_ms));   // Simulating the work done by producer
+        // The priority buffer spreads the producers over its lanes, producer 1 on the most urgent one
+        if constexpr (requires { buffer.laneCount(); })
+            buffer.produce_to(static_cast<size_t>(id - 1) % buffer.laneCount(), item, id);
+        else
+            buffer.produce(item, id);
     }
 }
 
-void consumer(int id) {
-    for (int i = 0; i < ITEMS_PER_CONSUMER; ++i) {
-        buffer.consume(id); 
-        this_thread::sleep_for(chrono::milliseconds(18));  // Simulate the work done by consumer
+// Takes items until the buffer has been closed and drained, so no consumer needs to know how many
+// items the producers make
+template <typename Buffer>
+void consumer(Buffer& buffer, int id, const DriverConfig& cfg) {
+    while (buffer.consume_until(chrono::steady_clock::time_point::max(), id)) {
+        if (cfg.consume_sleep_ms > 0)
+            this_thread::sleep_for(chrono::milliseconds(cfg.consume_sleep_ms));  // Simulate the work done by consumer
     }
 }
 
-struct LogEntry {
-    long long timestamp;
-    bool is_produce;
-    double wait_time_ms;   
-};
+// Prints a live snapshot of the buffer every 100ms until done is set (--monitor). Reading it takes
+// neither the producer nor the consumer lock.
+template <typename Buffer>
+void monitor(Buffer& buffer, atomic<bool>& done) {
+    while (!done.load()) {
+        this_thread::sleep_for(chrono::milliseconds(100));
+        BufferSnapshot s = buffer.snapshot();
+        cout << "[monitor] Depth: " << s.depth
+             << " | High Watermark: " << s.high_watermark
+             << " | Enqueued: " << s.enqueued
+             << " | Dequeued: " << s.dequeued
+             << " | Blocked Producers: " << s.blocked_producers
+             << " | Blocked Consumers: " << s.blocked_consumers << endl;
+    }
+}
 
+// Runs all producer and consumer threads against the given buffer and returns its time stats.
+// Only the linked list buffers offer snapshot(), so --monitor is ignored for the others.
+template <typename Buffer>
+vector<double> runThreads(Buffer& buffer, const DriverConfig& cfg) {
+    vector<thread> producers;
+    vector<thread> consumers;
+    atomic<bool> done{false};
+    thread monitor_thread;
+    if constexpr (requires { buffer.snapshot(); }) {
+        if (cfg.monitor) monitor_thread = thread(monitor<Buffer>, ref(buffer), ref(done));
+    }
 
-// Driver code:-
-int main() {
-    ofstream("InfiniteBufferLogger.txt") << ""; 
+    // Each thread pins itself (--pin-producers, --pin-consumers) before it touches the buffer, so that
+    // the nodes it allocates come from its own NUMA node
+    for (int i = 0; i < cfg.producers; ++i) {
+        producers.emplace_back([&buffer, &cfg, i]() {
+            pinDriverThread(cfg.producer_cpus, i);
+            labelThread("Producer " + to_string(i + 1));
+            producer(buffer, i + 1, cfg);
+        });
+    }
 
-    vector<thread> threads;
+    for (int i = 0; i < cfg.consumers; ++i) {
+        consumers.emplace_back([&buffer, &cfg, i]() {
+            pinDriverThread(cfg.consumer_cpus, i);
+            labelThread("Consumer " + to_string(i + 1));
+            consumer(buffer, i + 1, cfg);
+        });
+    }
 
-    auto start_time = chrono::steady_clock::now(); 
-    for (int i = 0; i < NUM_PRODUCERS; ++i)
-        threads.emplace_back(producer, i + 1);
+    // Once every item is in, closing the buffer lets the consumers finish draining it and return
+    for (auto& t : producers)
+        t.join();
+    buffer.close();
+    for (auto& t : consumers)
+        t.join();
+    done = true;
+    if (monitor_thread.joinable()) monitor_thread.join();
 
-    for (int i = 0; i < NUM_CONSUMERS; ++i)
-        threads.emplace_back(consumer, i + 1);
+    return buffer.Stats();
+}
 
-    for (auto& t : threads)
-        t.join();
+template <typename Buffer>
+void printLatency(Buffer& buffer) {
+    cout << "\nLatency Percentiles\n";
+    printLatencySummary(cout, "Produce", buffer.latency(BufferOp::Produce));
+    printLatencySummary(cout, "Consume", buffer.latency(BufferOp::Consume));
+}
 
-    auto end_time = chrono::steady_clock::now();
+// Where the threads waited, per lock and condition, with the threads that had to wait under each.
+// Only the linked list buffers record it; --contention and --contention-folded also write it out.
+template <typename Buffer>
+void reportContention(Buffer& buffer, const DriverConfig& cfg) {
+    if constexpr (requires { buffer.contention(); }) {
+        ContentionReport report = buffer.contention();
+        cout << "\nContention (acquisitions, waits and hand-off latency)\n";
+        printContention(cout, report);
+        if (!cfg.contention.empty()) {
+            ofstream out(cfg.contention);
+            writeContentionJson(out, report);
+            out << "\n";
+            if (!out) cerr << "Cannot write " << cfg.contention << "\n";
+        }
+        if (!cfg.contention_folded.empty()) {
+            ofstream out(cfg.contention_folded);
+            writeContentionFolded(out, report, "InfiniteBuffer");
+            if (!out) cerr << "Cannot write " << cfg.contention_folded << "\n";
+        }
+    }
+}
 
-    vector<double> stat = buffer.Stats();  
 
-    ifstream log("InfiniteBufferLogger.txt");
-    string line;
-    vector<LogEntry> entries;
 
-    // total_producer_wait: Total time producers spent waiting to acquire the lock
-    // total_consumer_wait: Total time consumers spent waiting for an item to become available and to acquire lock
-    int total_produced = 0, total_consumed = 0;
-    double total_producer_wait = 0.0, total_consumer_wait = 0.0;
-    double max_producer_wait = 0.0, max_consumer_wait = 0.0;
+// Slabs the node pool of the buffer's node type had to allocate
+size_t nodeSlabs(const LockFreeLinkedListBuffer<int>&) {
+    return NodePool<LockFreeNode<int>>::slabCount();
+}
 
-    unordered_map<int, double> producer_wait_sum;
-    unordered_map<int, int> producer_wait_count;
-    unordered_map<int, double> producer_wait_max;
+template <typename T>
+size_t nodeSlabs(const PriorityBuffer<T>&) {
+    return PriorityBuffer<T>::slabCount();
+}
 
-    while (getline(log, line)) {
-        size_t ts_start = line.find('[');
-        size_t ts_end = line.find("us]");
-        if (ts_start == string::npos || ts_end == string::npos) continue;
+template <typename Buffer>
+size_t nodeSlabs(const Buffer&) {
+    return NodePool<Node<int>>::slabCount();
+}
 
-        long long timestamp = stoll(line.substr(ts_start + 1, ts_end - ts_start - 1));
+// Runs the producers and consumers against buffer, then prints the log analysis report and
+// shows the Visualizer unless running headless.
+template <typename Buffer>
+void runDriver(Buffer& buffer, const DriverConfig& cfg, const char* title) {
+    // With --binary-log the run writes compact records which are converted to the text log afterwards.
+    // With --trace it writes them as an indexed trace for the Visualizer, also exported to the text log.
+    // With --mmap-log the threads write their records straight into a memory-mapped log file.
+    LogSink sink = cfg.mmap_log ? LogSink::Mapped : LogSink::Writer;
+    LogFormat format = cfg.trace ? LogFormat::Trace : cfg.binary_log ? LogFormat::Binary : LogFormat::Text;
+    string log_path = cfg.trace ? "InfiniteBufferTrace.ibt" : cfg.binary_log ? "InfiniteBufferLogger.bin" : "InfiniteBufferLogger.txt";
+    buffer_logger.open(log_path, format, sink);
 
-        bool is_produce = (line.find("produced") != string::npos);
+    auto start_time = chrono::steady_clock::now(); 
+    vector<double> stat = runThreads(buffer, cfg);
 
-        double wait_ms = 0.0;
-        size_t wait_pos = line.find("Waited:");
-        if (wait_pos != string::npos) {
-            stringstream ss(line.substr(wait_pos + 8));
-            ss >> wait_ms;
-        }
+    auto end_time = chrono::steady_clock::now();
 
-        entries.push_back({timestamp, is_produce, wait_ms});
-
-        if (is_produce) {
-            total_produced++;
-            total_producer_wait += wait_ms;
-            if (wait_ms > max_producer_wait) max_producer_wait = wait_ms;
-        
-            size_t pid_pos = line.find("Producer ");
-            if (pid_pos != string::npos) {
-                int pid = stoi(line.substr(pid_pos + 9));
-                producer_wait_sum[pid] += wait_ms;
-                producer_wait_count[pid]++;
-                producer_wait_max[pid] = max(producer_wait_max[pid], wait_ms);
-            }
-        } else {
-            total_consumed++;
-            total_consumer_wait += wait_ms;
-            if (wait_ms > max_consumer_wait) max_consumer_wait = wait_ms;
-        }
-    }
+    buffer_logger.close();     // A trace is sorted and indexed here
+    if (format != LogFormat::Text) AsyncLogger::exportText(log_path, "InfiniteBufferLogger.txt");
 
-    // Sort entries by the timestamp
-    sort(entries.begin(), entries.end(), [](const LogEntry& a, const LogEntry& b) {
-        return a.timestamp < b.timestamp;
-    });
-
-    int buffer_count = 0;
-    int peak_buffer = 0;
-    for (const auto& e : entries) {
-        buffer_count += (e.is_produce ? 1 : -1);
-        if (buffer_count > peak_buffer)
-            peak_buffer = buffer_count;
-    }
+    // Single pass over the log; the binary log or trace is read directly rather than its text export
+    LogAnalysis analysis = analyzeLogFile(log_path);
+    uint64_t total_produced = analysis.produced, total_consumed = analysis.consumed;
+
+    int64_t peak_buffer = analysis.peak_occupancy;
 
     double total_runtime_sec = chrono::duration_cast<chrono::duration<double>>(end_time - start_time).count();
     
     cout << fixed << setprecision(3);
-    cout << "\nLOG ANALYSIS REPORT\n";
+    cout << "\nLOG ANALYSIS REPORT (" << title << " buffer)\n";
     cout << "Total Items Produced       : " << total_produced << "\n";
     cout << "Total Items Consumed       : " << total_consumed << "\n";
     cout << "Final Buffer Size          : " << (total_produced - total_consumed) << "\n";
     cout << "Peak Buffer Size (Nodes)   : " << peak_buffer << "\n";
+    cout << "Node Pool Slabs Allocated  : " << nodeSlabs(buffer) << "\n";
 
     cout << "\nRuntime\n";
     cout << "Total Runtime              : " << total_runtime_sec << " seconds\n";
     cout << "Total Produce Time (just to produce in buffer including lock acquiring time and writing time) : " << stat[0] << " seconds\n";
     cout << "Total Consume Time (just to consume from buffer including lock acquiring time and reading time): " << stat[1] << " seconds\n";
 
+    printLatency(buffer);
+    reportContention(buffer, cfg);
+
     cout << "\nProducer Stats\n";
-    cout << "Total Wait Time            : " << total_producer_wait << " ms\n";
-    cout << "Average Wait Time          : " << (total_produced ? total_producer_wait / total_produced : 0) << " ms\n";
-    cout << "Maximum Wait Time          : " << max_producer_wait << " ms\n";
+    cout << "Total Wait Time            : " << analysis.producer_wait_ms << " ms\n";
+    cout << "Average Wait Time          : " << (total_produced ? analysis.producer_wait_ms / total_produced : 0) << " ms\n";
+    cout << "Maximum Wait Time          : " << analysis.max_producer_wait_ms << " ms\n";
 
     cout << "\nConsumer Stats\n";
-    cout << "Total Wait Time            : " << total_consumer_wait << " ms\n";
-    cout << "Average Wait Time          : " << (total_consumed ? total_consumer_wait / total_consumed : 0) << " ms\n";
-    cout << "Maximum Wait Time          : " << max_consumer_wait << " ms\n";
+    cout << "Total Wait Time            : " << analysis.consumer_wait_ms << " ms\n";
+    cout << "Average Wait Time          : " << (total_consumed ? analysis.consumer_wait_ms / total_consumed : 0) << " ms\n";
+    cout << "Maximum Wait Time          : " << analysis.max_consumer_wait_ms << " ms\n";
 
     cout << "\nProducer Fairness (by Avg Wait Time)\n";
-    for (const auto& [pid, count] : producer_wait_count) {
-        double avg_wait = producer_wait_sum[pid] / count;
-        double max_wait = producer_wait_max[pid];
-    
+    for (const auto& [pid, p] : analysis.producers) {
         cout << "Producer " << pid
-             << " | Produced: " << count
-             << " | Avg Wait Time: " << avg_wait << " ms"
-             << " | Max Wait Time: " << max_wait << " ms"<<endl;
+             << " | Produced: " << p.count
+             << " | Avg Wait Time: " << p.wait_sum_ms / p.count << " ms"
+             << " | Max Wait Time: " << p.wait_max_ms << " ms"<<endl;
     }
 
+    // Balance of the sharded buffer: how deep each shard got and how much of it other consumers had to steal.
+    // In the per-node layout the stolen items are the ones forwarded to another socket.
+    if constexpr (requires { buffer.shardStats(0); }) {
+        cout << "\nShard Balance\n";
+        for (size_t i = 0; i < buffer.shardCount(); ++i) {
+            auto shard = buffer.shardStats(i);
+            if (buffer.perNumaNode()) cout << "Node " << NumaTopology::system().nodeId(i);
+            else cout << "Shard " << i + 1;
+            cout << " | Produced: " << shard.produced
+                 << " | Consumed: " << shard.consumed
+                 << " | Stolen: " << shard.stolen
+                 << " | Peak Depth: " << shard.peak_depth
+                 << " | Final Depth: " << shard.depth << endl;
+        }
+    }
+
+    // How often the hybrid buffer's ring overflowed, and how much of the run went through the segments
+    if constexpr (requires { buffer.spillCount(); }) {
+        cout << "\nRing Overflow\n";
+        cout << "Ring Capacity              : " << buffer.capacity() << "\n";
+        cout << "Times Spilled              : " << buffer.spillCount() << "\n";
+        cout << "Items Spilled to Segments  : " << buffer.spilledItems() << "\n";
+    }
+
+    // Per-lane traffic of the priority buffer; Wait is how long items sat in the lane before a consumer took them
+    if constexpr (requires { buffer.laneStats(0); }) {
+        cout << "\nLanes (" << (buffer.lanePolicy() == LanePolicy::StrictPriority ? "strict priority" : "weighted round-robin") << ")\n";
+        for (size_t i = 0; i < buffer.laneCount(); ++i) {
+            auto lane = buffer.laneStats(i);
+            cout << "Lane " << i
+                 << " | Produced: " << lane.produced
+                 << " | Consumed: " << lane.consumed
+                 << " | Peak Depth: " << lane.peak_depth
+                 << " | Wait p50: " << lane.wait_p50_ns / 1e6 << " ms"
+                 << " | Wait p99: " << lane.wait_p99_ns / 1e6 << " ms"
+                 << " | Wait p99.9: " << lane.wait_p999_ns / 1e6 << " ms" << endl;
+        }
+    }
+
+    if constexpr (requires { buffer.segmentsAllocated(); }) {
+        cout << "\nSegments\n";
+        cout << "Slots per Segment          : " << buffer.segmentSize() << "\n";
+        cout << "Segments Allocated         : " << buffer.segmentsAllocated() << "\n";
+    }
 
-    Visualizer vis;
-    vis.run(); // Running the visualizer.
+    // Headless runs (e.g. large buffers for profiling) skip the Visualizer entirely
+    if (!cfg.headless) {
+        // The Visualizer replays a trace; without --trace one is built from the log
+        if (!cfg.trace) exportTrace(log_path, "InfiniteBufferTrace.ibt");
+        Visualizer vis("InfiniteBufferTrace.ibt", cfg.speed);
+        vis.run(); // Running the visualizer.
+    }
+}
+
+// Driver code:-
+int main(int argc, char* argv[]) {
+    DriverConfig cfg;
+    if (!parseDriverConfig(argc, argv, BUFFER_NAMES, cfg)) return 1;
+    // --replay shows a recorded trace again without running any buffer
+    if (!cfg.replay.empty()) {
+        Visualizer vis(cfg.replay, cfg.speed);
+        vis.run();
+        return 0;
+    }
+
+    if (cfg.buffer == "lock-free") {
+        LockFreeLinkedListBuffer<int> buffer;
+        runDriver(buffer, cfg, "lock-free");
+    } else if (cfg.buffer == "mcs") {
+        LinkedListBuffer<int, McsLock> buffer;
+        runDriver(buffer, cfg, "MCS-locked");
+    } else if (cfg.buffer == "sharded") {
+        ShardedBuffer<int> buffer(static_cast<size_t>(cfg.producers));
+        runDriver(buffer, cfg, "sharded");
+    } else if (cfg.buffer == "numa") {
+        ShardedBuffer<int> buffer(per_numa_node);
+        runDriver(buffer, cfg, "per-NUMA-node sharded");
+    } else if (cfg.buffer == "priority") {
+        LaneOptions options;
+        options.policy = cfg.lane_policy == "weighted" ? LanePolicy::WeightedRoundRobin : LanePolicy::StrictPriority;
+        options.weights = cfg.lane_weights;
+        options.starvation_budget = cfg.starvation_budget;
+        PriorityBuffer<int> buffer(cfg.lanes, options);
+        runDriver(buffer, cfg, "priority");
+    } else if (cfg.buffer == "hybrid") {
+        HybridBuffer<int> buffer(cfg.capacity);
+        runDriver(buffer, cfg, "hybrid");
+    } else if (cfg.buffer == "segmented") {
+        SegmentedBuffer<int> buffer(cfg.segment_size);
+        runDriver(buffer, cfg, "segmented");
+    } else {
+        LinkedListBuffer<int> buffer;
+        runDriver(buffer, cfg, "ticket-locked");
+    }
 
     return 0;
 }
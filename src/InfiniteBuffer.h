@@ -0,0 +1,2662 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "AsyncLogger.h"
+#include "AsyncWait.h"
+#include "Contention.h"
+#include "Deadline.h"
+#include "HazardPointers.h"
+#include "Instrumentation.h"
+#include "Locks.h"
+#include "NodePool.h"
+#include "SlotStorage.h"
+#include "Topology.h"
+
+// Unbounded buffers: the locked linked list (LinkedListBuffer), its single-producer/single-consumer
+// version (LinkedListBuffer<T, SpscPolicy>), the lock-free Michael-Scott queue
+// (LockFreeLinkedListBuffer), the work-stealing ShardedBuffer, the ring-first HybridBuffer, the
+// array-segment SegmentedBuffer and the multi-lane PriorityBuffer. Kept apart from the driver and the
+// Visualizer so that the benchmark can build them without SFML.
+namespace infinite_buffer {
+
+// Each node contains the data to be stored in it, a flag indicating whehter full or empty and a pointer to the next node.
+// The data is only constructed while the node is filled (see SlotStorage). filled is what hands a node from the
+// producers to the consumers, which hold different locks, so it is atomic: setting it publishes data and next.
+template <typename T>
+struct Node {
+    SlotStorage<T> data;
+    std::atomic<bool> filled;
+    Node* next;
+    Node() : filled(false), next(nullptr) {}
+};
+
+// Infinite Buffer:-
+// T is the element type; it only needs to be move-constructible. ProducerLock orders the producers
+// (TicketLock, or McsLock for high producer counts); SpscPolicy selects the lock-free 1:1 version below.
+template <typename T, typename ProducerLock = TicketLock>
+class LinkedListBuffer {
+private:
+    Node<T>* head; // Producer writes at the head end
+    Node<T>* tail; // Consumer reads at the tail end
+
+    ProducerLock ticket_lock_producer;       // Mutex for synchronizing producers access to the buffer
+    std::mutex mutex_consumer;       // Mutex for synchronizing consumers access to the buffer
+    EventCount not_empty;       // Consumers park here until an item is available; producers never take mutex_consumer
+    AsyncWaiterQueue async_consumers;   // Coroutines parked in async_consume(), guarded by mutex_consumer
+    std::atomic<bool> closed{false};    // Set by close()
+
+    // Per-thread latency histograms and totals, recorded without a lock
+    BufferStats stats;
+    // Live depth and high-watermark for snapshot(), advanced under the locks already held
+    OccupancyCounters occupancy;
+    // Waits at the two locks and for items, per thread (see contention())
+    enum WaitSite : size_t { PRODUCER_LOCK, CONSUMER_LOCK, NOT_EMPTY };
+    ContentionProfile waits{"ticket_lock_producer", "mutex_consumer", "not_empty"};
+
+    uint64_t start_time;        // CycleClock ticks
+
+
+public:
+    // A dummy node is always maintained which means that the buffer will never be empty.
+    // This is required to simplify edge case handling as head and tail pointers will never become null.
+    LinkedListBuffer() {
+        head = NodePool<Node<T>>::allocate();  // Initial dummy node
+        tail = head;        
+        start_time = CycleClock::now();       
+    }
+
+    ~LinkedListBuffer() {
+        while (tail) {
+            Node<T>* next = tail->next;
+            if (tail->filled.load(std::memory_order_relaxed)) tail->data.destroy();
+            NodePool<Node<T>>::release(tail);
+            tail = next;
+        }
+    }
+
+    void produce(const T& item, int producer_id) {
+        emplace(producer_id, item);
+    }
+
+    void produce(T&& item, int producer_id) {
+        emplace(producer_id, std::move(item));
+    }
+
+    // Constructs the item directly in the head node from args
+    template <typename... Args>
+    void emplace(int producer_id, Args&&... args) {
+
+        uint64_t request_lock_time = CycleClock::now();
+
+        // Taking the next node from the pool before locking keeps the allocator out of the critical section
+        Node<T>* new_node = NodePool<Node<T>>::allocate();
+
+        // Acquiring ticket lock to ensure fair synchronization
+        LockWait lock_wait;
+        ticket_lock_producer.lock(&lock_wait);
+        uint64_t acquired_lock_time = CycleClock::now();
+
+        head->data.construct(std::forward<Args>(args)...);
+        int64_t logged_value = logValue(head->data.get());
+        // Linking the new node to the current node.
+        head->next = new_node;
+        occupancy.enqueued(1);
+        head->filled.store(true, std::memory_order_release);
+        head = new_node;
+        occupancy.published();
+        
+        uint64_t now = CycleClock::now();
+        
+        // Releasing the producer lock
+        ticket_lock_producer.unlock();
+        // Waking one of the waiting consumer threads; no syscall if none is parked
+        notifyConsumers(false);
+
+        // Logging outside the critical section; the timestamp was taken while still holding the lock
+        buffer_logger.log(LogRole::Producer, producer_id, logged_value, CycleClock::toNs(now - start_time), CycleClock::toNs(acquired_lock_time - request_lock_time));
+        
+        stats.record(BufferOp::Produce, request_lock_time, acquired_lock_time, now, CycleClock::now());
+        waits.record(PRODUCER_LOCK, lock_wait);
+
+        // Parked coroutines run on this thread, so only once the produce itself is complete
+        if (async_consumers.mayHaveWaiters()) resumeConsumers();
+    }
+
+    // Waits however long it takes; a forever() wait always ends with an item
+    T consume(int consumer_id) {
+        return *consumeWithin(WaitDeadline::forever(), consumer_id);
+    }
+
+    // Produces all items with one ticket lock acquisition and one wakeup. items[0] goes into the
+    // current head node; the nodes for the remaining items are filled outside the lock and spliced
+    // in behind it as one chain.
+    void produce_bulk(std::span<const T> items, int producer_id) {
+        if (items.empty()) return;
+        uint64_t request_lock_time = CycleClock::now();
+
+        Node<T>* chain_first = nullptr;
+        Node<T>* chain_last = nullptr;
+        for (size_t i = 1; i <= items.size(); ++i) {
+            Node<T>* node = NodePool<Node<T>>::allocate();
+            if (i < items.size()) {
+                node->data.construct(items[i]);
+                node->filled.store(true, std::memory_order_relaxed);     // Published by the release store on head below
+            }
+            if (chain_last) chain_last->next = node;
+            else chain_first = node;
+            chain_last = node;
+        }
+
+        LockWait lock_wait;
+        ticket_lock_producer.lock(&lock_wait);
+        uint64_t acquired_lock_time = CycleClock::now();
+
+        head->data.construct(items[0]);
+        head->next = chain_first;
+        occupancy.enqueued(items.size());
+        head->filled.store(true, std::memory_order_release);   // Publishes the whole chain
+        head = chain_last;        // The last node of the chain is the new empty head
+        occupancy.published();
+
+        uint64_t now = CycleClock::now();
+
+        ticket_lock_producer.unlock();
+        notifyConsumers(items.size() > 1);
+
+        for (const T& item : items)
+            buffer_logger.log(LogRole::Producer, producer_id, logValue(item), CycleClock::toNs(now - start_time), CycleClock::toNs(acquired_lock_time - request_lock_time));
+
+        stats.record(BufferOp::Produce, request_lock_time, acquired_lock_time, now, CycleClock::now(), items.size());
+        waits.record(PRODUCER_LOCK, lock_wait);
+
+        if (async_consumers.mayHaveWaiters()) resumeConsumers();
+    }
+
+    // Waits for at least one item, then takes up to min(out.size(), max) items that are ready
+    // in one pass under the consumer lock. Returns the number of items written to out.
+    size_t consume_bulk(std::span<T> out, size_t max, int consumer_id) {
+        size_t limit = std::min(out.size(), max);
+        if (limit == 0) return 0;
+        uint64_t request_lock_time = CycleClock::now();
+
+        std::unique_lock<std::mutex> lock = waits.lock(CONSUMER_LOCK, mutex_consumer);
+        waitUntilFilled(lock, WaitDeadline::forever());
+        uint64_t acquired_lock_time = CycleClock::now();
+
+        Node<T>* first = tail;
+        size_t count = 0;
+        while (count < limit && tail->filled.load(std::memory_order_acquire)) {
+            out[count++] = tail->data.take();
+            tail->filled.store(false, std::memory_order_relaxed);
+            tail = tail->next;
+        }
+        occupancy.dequeued(count);
+
+        uint64_t now = CycleClock::now();
+        lock.unlock();
+
+        for (size_t i = 0; i < count; ++i)
+            buffer_logger.log(LogRole::Consumer, consumer_id, logValue(out[i]), CycleClock::toNs(now - start_time), CycleClock::toNs(acquired_lock_time - request_lock_time));
+
+        // The consumed nodes are detached from the list, so they can be recycled without the lock
+        for (size_t i = 0; i < count; ++i) {
+            Node<T>* next = first->next;
+            NodePool<Node<T>>::release(first);
+            first = next;
+        }
+
+        stats.record(BufferOp::Consume, request_lock_time, acquired_lock_time, now, CycleClock::now(), count);
+
+        return count;
+    }
+
+    // Non-blocking and timed versions of produce() and consume(). Producing never waits here, so
+    // the produce calls only fail once the buffer is closed. The consume calls return nullopt when
+    // the deadline passes without an item, and at once when the buffer is closed and drained.
+    template <typename U>
+    bool try_produce(U&& item, int producer_id) {
+        if (closed.load(std::memory_order_acquire)) return false;
+        emplace(producer_id, std::forward<U>(item));
+        return true;
+    }
+
+    template <typename U, typename Rep, typename Period>
+    bool produce_for(U&& item, const std::chrono::duration<Rep, Period>&, int producer_id) {
+        return try_produce(std::forward<U>(item), producer_id);
+    }
+
+    template <typename U>
+    bool produce_until(U&& item, std::chrono::steady_clock::time_point, int producer_id) {
+        return try_produce(std::forward<U>(item), producer_id);
+    }
+
+    std::optional<T> try_consume(int consumer_id) {
+        return consumeWithin(WaitDeadline::none(), consumer_id);
+    }
+
+    template <typename Rep, typename Period>
+    std::optional<T> consume_for(const std::chrono::duration<Rep, Period>& timeout, int consumer_id) {
+        return consumeWithin(WaitDeadline::after(timeout), consumer_id);
+    }
+
+    std::optional<T> consume_until(std::chrono::steady_clock::time_point deadline, int consumer_id) {
+        return consumeWithin(WaitDeadline::at(deadline), consumer_id);
+    }
+
+    // No more items are coming: the try_/timed produce calls fail from now on, the try_/timed consume
+    // calls still take the items left but stop waiting once the buffer is empty, and every thread
+    // waiting in one of them wakes up. The blocking produce() and consume() are not affected.
+    void close() {
+        closed.store(true, std::memory_order_seq_cst);
+        not_empty.notifyAll();
+    }
+
+    bool isClosed() const {
+        return closed.load(std::memory_order_acquire);
+    }
+
+    std::vector<double> Stats() {
+        std::vector<double> time_stat;
+        time_stat.push_back(stats.summary(BufferOp::Produce).total_seconds);
+        time_stat.push_back(stats.summary(BufferOp::Consume).total_seconds);
+        return time_stat;
+    }
+
+    LatencySummary latency(BufferOp op) {
+        return stats.summary(op);
+    }
+
+    // Acquisitions of, and time spent waiting at, ticket_lock_producer, mutex_consumer and not_empty
+    // (the wait for an item), by thread; hand-off latency is from a producer's notify to the wake-up
+    ContentionReport contention() {
+        return waits.report();
+    }
+
+    // co_await async_consume(id) takes an item like consume(), but while the buffer is empty it parks
+    // the coroutine rather than the thread; the producer that publishes its item resumes it.
+    ConsumeAwaiter<LinkedListBuffer, T> async_consume(int consumer_id) {
+        return {*this, consumer_id};
+    }
+
+    // Producing never waits in the infinite buffer, so co_await async_produce() does not suspend
+    template <typename U>
+    ProduceAwaiter<LinkedListBuffer, T> async_produce(U&& item, int producer_id) {
+        return {*this, std::forward<U>(item), producer_id};
+    }
+
+    // Live view for a monitoring thread; takes neither the producer nor the consumer lock.
+    // Producers never block here, so blocked_producers stays 0.
+    BufferSnapshot snapshot() {
+        BufferSnapshot s = occupancy.snapshot();
+        s.produce = stats.summary(BufferOp::Produce);
+        s.consume = stats.summary(BufferOp::Consume);
+        return s;
+    }
+
+private:
+    friend class ::ConsumeAwaiter<LinkedListBuffer, T>;
+    friend class ::ProduceAwaiter<LinkedListBuffer, T>;
+
+    std::optional<T> consumeWithin(const WaitDeadline& deadline, int consumer_id) {
+        uint64_t request_lock_time = CycleClock::now();
+        
+        // First consumer acquires lock to ensure synchronization
+        std::unique_lock<std::mutex> lock = waits.lock(CONSUMER_LOCK, mutex_consumer);
+
+        if (!waitUntilFilled(lock, deadline)) return std::nullopt;
+        uint64_t acquired_lock_time = CycleClock::now();
+        
+        // Consuming the data item
+        int64_t logged_value = logValue(tail->data.get());
+        T item = tail->data.take();
+        tail->filled.store(false, std::memory_order_relaxed);
+        occupancy.dequeued(1);
+        
+        uint64_t now = CycleClock::now();
+    
+        Node<T>* temp = tail;
+        tail = tail->next;
+        
+        // Releasing the lock.
+        lock.unlock();
+
+        // Logging
+        buffer_logger.log(LogRole::Consumer, consumer_id, logged_value, CycleClock::toNs(now - start_time), CycleClock::toNs(acquired_lock_time - request_lock_time));
+
+        // Recycling the consumed node back to the pool outside the lock
+        NodePool<Node<T>>::release(temp);
+        
+        stats.record(BufferOp::Consume, request_lock_time, acquired_lock_time, now, CycleClock::now());
+    
+        return item;
+    }
+
+    bool suspendProducer(ItemWaiter<T>& waiter) {
+        emplace(waiter.thread_id, waiter.item.take());
+        return false;
+    }
+
+    // Parks waiter unless an item is ready; returns false if it completed at once
+    bool suspendConsumer(ItemWaiter<T>& waiter) {
+        std::unique_lock<std::mutex> lock(mutex_consumer);
+        async_consumers.push(&waiter);
+        if (!tail->filled.load(std::memory_order_seq_cst)) return true;
+
+        // Items are already there: complete the parked waiters, oldest first (this one is last)
+        ResumeList resumed;
+        handOff(lock, resumed);
+        bool completed = resumed.remove(&waiter);
+        resumed.resumeAll();
+        return !completed;
+    }
+
+    // Producer side, after publishing: completes the parked consumers and resumes them on this thread
+    void resumeConsumers() {
+        std::unique_lock<std::mutex> lock(mutex_consumer);
+        ResumeList resumed;
+        handOff(lock, resumed);
+        resumed.resumeAll();
+    }
+
+    // Moves ready items into parked consumers under the consumer lock, releases it, then logs them
+    // and recycles their nodes. The completed waiters are added to resumed.
+    void handOff(std::unique_lock<std::mutex>& lock, ResumeList& resumed) {
+        uint64_t acquired_lock_time = CycleClock::now();
+        Node<T>* first = tail;
+        size_t count = 0;
+        while (!async_consumers.empty() && tail->filled.load(std::memory_order_acquire)) {
+            ItemWaiter<T>* waiter = static_cast<ItemWaiter<T>*>(async_consumers.pop());
+            waiter->item.construct(tail->data.take());
+            tail->filled.store(false, std::memory_order_relaxed);
+            tail = tail->next;
+            resumed.add(waiter);
+            count++;
+        }
+        occupancy.dequeued(count);
+        uint64_t now = CycleClock::now();
+        lock.unlock();
+
+        resumed.forEach([&](AsyncWaiter& w) {
+            ItemWaiter<T>& waiter = static_cast<ItemWaiter<T>&>(w);
+            buffer_logger.log(LogRole::Consumer, waiter.thread_id, logValue(waiter.item.get()), CycleClock::toNs(now - start_time), CycleClock::toNs(acquired_lock_time - waiter.request_time));
+            stats.record(BufferOp::Consume, waiter.request_time, acquired_lock_time, now, CycleClock::now());
+        });
+        for (size_t i = 0; i < count; ++i) {
+            Node<T>* next = first->next;
+            NodePool<Node<T>>::release(first);
+            first = next;
+        }
+    }
+
+    // Producer side, after releasing the lock. The notify time is only taken while a consumer sleeps.
+    void notifyConsumers(bool all) {
+        if (occupancy.blockedCount(BufferOp::Consume).load(std::memory_order_relaxed) > 0) waits.notified(NOT_EMPTY);
+        if (all) not_empty.notifyAll();
+        else not_empty.notifyOne();
+    }
+
+    // Returns with mutex_consumer held: true once tail is filled, false if the deadline ran out
+    // first. Spins briefly, then parks on not_empty with the consumer lock released so that the other
+    // consumers can queue up behind it.
+    bool waitUntilFilled(std::unique_lock<std::mutex>& lock, const WaitDeadline& deadline) {
+        LockWait wait;
+        bool filled = true;
+        Backoff backoff;
+        while (!tail->filled.load(std::memory_order_acquire)) {
+            wait.spinning();
+            if (deadline.passed(closed)) {
+                filled = false;
+                break;
+            }
+            if (backoff.spin()) continue;
+            uint32_t key = not_empty.prepareWait();
+            if (tail->filled.load(std::memory_order_seq_cst)) {
+                not_empty.cancelWait();
+                break;
+            }
+            // Checked again after registering, for the handshake with close()
+            if (deadline.passed(closed)) {
+                not_empty.cancelWait();
+                filled = false;
+                break;
+            }
+            lock.unlock();
+            wait.parking();
+            occupancy.blockedCount(BufferOp::Consume).fetch_add(1, std::memory_order_relaxed);
+            not_empty.commitWait(key, deadline);
+            occupancy.blockedCount(BufferOp::Consume).fetch_sub(1, std::memory_order_relaxed);
+            wait.unparked();
+            lock.lock();
+            backoff.reset();
+        }
+        wait.done();
+        waits.record(NOT_EMPTY, wait);
+        return filled;
+    }
+};
+
+// Single-producer/single-consumer Infinite Buffer:-
+// Selected with LinkedListBuffer<T, SpscPolicy>; same API, but no lock, mutex or event count. Items
+// live in a chain of fixed-size segments instead of one node each. The producer fills its segment
+// front to back, publishing with one release store per item, and links a new segment when it is
+// full, so it never waits (wait-free). The consumer keeps a cached copy of the producer's index
+// and re-reads it only when it has caught up with the cache. A drained segment is handed back
+// to the producer through `spare`, so a steady state allocates nothing. A coroutine consumer
+// waits in a one-entry slot, which the producer checks after every item it publishes.
+template <typename T>
+class LinkedListBuffer<T, SpscPolicy> {
+private:
+    static constexpr size_t SEGMENT_SIZE = 256;
+
+    struct Segment {
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> written{0};   // Slots published by the producer
+        std::atomic<Segment*> next{nullptr};
+        SlotStorage<T> slots[SEGMENT_SIZE];
+    };
+
+    // Producer side
+    alignas(CACHE_LINE_SIZE) Segment* head; // Producer writes at the head end
+    size_t head_pos = 0;
+
+    // Consumer side
+    alignas(CACHE_LINE_SIZE) Segment* tail; // Consumer reads at the tail end
+    size_t tail_pos = 0;
+    size_t cached_written = 0;      // Consumer's last view of tail->written
+
+    alignas(CACHE_LINE_SIZE) std::atomic<Segment*> spare{nullptr};
+    std::atomic<bool> closed{false};    // Set by close()
+
+    BufferStats stats;
+    // Live depth and high-watermark for snapshot(). Each side only writes its own count; the producer
+    // reads the consumer's once per segment, so the high watermark is sampled at segment boundaries.
+    OccupancyCounters occupancy;
+
+    // The coroutine parked in async_consume(), if any. While it is parked the consumer side is idle, and
+    // the producer that takes it out of here owns that side until it has handed the waiter an item.
+    alignas(CACHE_LINE_SIZE) std::atomic<AsyncWaiter*> parked_consumer{nullptr};
+
+    uint64_t start_time;        // CycleClock ticks
+
+public:
+    LinkedListBuffer() {
+        head = tail = new Segment();
+        start_time = CycleClock::now();
+    }
+
+    ~LinkedListBuffer() {
+        size_t pos = tail_pos;
+        while (tail) {
+            Segment* next = tail->next.load(std::memory_order_relaxed);
+            size_t written = tail->written.load(std::memory_order_relaxed);
+            for (; pos < written; ++pos) tail->slots[pos].destroy();
+            delete tail;
+            tail = next;
+            pos = 0;
+        }
+        delete spare.load(std::memory_order_relaxed);
+    }
+
+    void produce(const T& item, int producer_id) {
+        emplace(producer_id, item);
+    }
+
+    void produce(T&& item, int producer_id) {
+        emplace(producer_id, std::move(item));
+    }
+
+    template <typename... Args>
+    void emplace(int producer_id, Args&&... args) {
+        uint64_t request_time = CycleClock::now();
+        if (head_pos == SEGMENT_SIZE) advanceHead();
+
+        head->slots[head_pos].construct(std::forward<Args>(args)...);
+        int64_t logged_value = logValue(head->slots[head_pos].get());
+        occupancy.enqueued(1);
+        head->written.store(++head_pos, std::memory_order_release);
+
+        uint64_t now = CycleClock::now();
+        buffer_logger.log(LogRole::Producer, producer_id, logged_value, CycleClock::toNs(now - start_time), 0);
+        stats.record(BufferOp::Produce, request_time, request_time, now, CycleClock::now());
+        if (consumerParked()) resumeConsumer();
+    }
+
+    T consume(int consumer_id) {
+        return *consumeWithin(WaitDeadline::forever(), consumer_id);
+    }
+
+    // Fills as much of the current segment as the items need and publishes that run with one store
+    void produce_bulk(std::span<const T> items, int producer_id) {
+        if (items.empty()) return;
+        uint64_t request_time = CycleClock::now();
+
+        occupancy.enqueued(items.size());
+        size_t done = 0;
+        while (done < items.size()) {
+            if (head_pos == SEGMENT_SIZE) advanceHead();
+            size_t run = std::min(items.size() - done, SEGMENT_SIZE - head_pos);
+            for (size_t i = 0; i < run; ++i) head->slots[head_pos + i].construct(items[done + i]);
+            head_pos += run;
+            head->written.store(head_pos, std::memory_order_release);
+            done += run;
+        }
+
+        uint64_t now = CycleClock::now();
+        for (const T& item : items)
+            buffer_logger.log(LogRole::Producer, producer_id, logValue(item), CycleClock::toNs(now - start_time), 0);
+        stats.record(BufferOp::Produce, request_time, request_time, now, CycleClock::now(), items.size());
+        if (consumerParked()) resumeConsumer();
+    }
+
+    // Waits for at least one item, then takes up to min(out.size(), max) published items.
+    // Returns the number of items written to out.
+    size_t consume_bulk(std::span<T> out, size_t max, int consumer_id) {
+        size_t limit = std::min(out.size(), max);
+        if (limit == 0) return 0;
+        uint64_t request_time = CycleClock::now();
+        waitForItems(WaitDeadline::forever());
+        uint64_t ready_time = CycleClock::now();
+
+        size_t count = 0;
+        while (count < limit && hasItem()) {
+            size_t run = std::min(limit - count, cached_written - tail_pos);
+            for (size_t i = 0; i < run; ++i) out[count + i] = tail->slots[tail_pos + i].take();
+            tail_pos += run;
+            count += run;
+        }
+        occupancy.dequeued(count);
+
+        uint64_t now = CycleClock::now();
+        for (size_t i = 0; i < count; ++i)
+            buffer_logger.log(LogRole::Consumer, consumer_id, logValue(out[i]), CycleClock::toNs(now - start_time), CycleClock::toNs(ready_time - request_time));
+        stats.record(BufferOp::Consume, request_time, ready_time, now, CycleClock::now(), count);
+        return count;
+    }
+
+    // Non-blocking and timed versions of produce() and consume(). Producing never waits here, so
+    // the produce calls only fail once the buffer is closed. The consume calls return nullopt when
+    // the deadline passes without an item, and at once when the buffer is closed and drained.
+    template <typename U>
+    bool try_produce(U&& item, int producer_id) {
+        if (closed.load(std::memory_order_acquire)) return false;
+        emplace(producer_id, std::forward<U>(item));
+        return true;
+    }
+
+    template <typename U, typename Rep, typename Period>
+    bool produce_for(U&& item, const std::chrono::duration<Rep, Period>&, int producer_id) {
+        return try_produce(std::forward<U>(item), producer_id);
+    }
+
+    template <typename U>
+    bool produce_until(U&& item, std::chrono::steady_clock::time_point, int producer_id) {
+        return try_produce(std::forward<U>(item), producer_id);
+    }
+
+    std::optional<T> try_consume(int consumer_id) {
+        return consumeWithin(WaitDeadline::none(), consumer_id);
+    }
+
+    template <typename Rep, typename Period>
+    std::optional<T> consume_for(const std::chrono::duration<Rep, Period>& timeout, int consumer_id) {
+        return consumeWithin(WaitDeadline::after(timeout), consumer_id);
+    }
+
+    std::optional<T> consume_until(std::chrono::steady_clock::time_point deadline, int consumer_id) {
+        return consumeWithin(WaitDeadline::at(deadline), consumer_id);
+    }
+
+    // No more items are coming: the try_/timed produce calls fail from now on, the try_/timed consume
+    // calls still take the items left but stop waiting once the buffer is empty, and a consumer
+    // waiting in one of them returns. The blocking produce() and consume() are not affected.
+    void close() {
+        closed.store(true, std::memory_order_seq_cst);
+    }
+
+    bool isClosed() const {
+        return closed.load(std::memory_order_acquire);
+    }
+
+    std::vector<double> Stats() {
+        std::vector<double> time_stat;
+        time_stat.push_back(stats.summary(BufferOp::Produce).total_seconds);
+        time_stat.push_back(stats.summary(BufferOp::Consume).total_seconds);
+        return time_stat;
+    }
+
+    LatencySummary latency(BufferOp op) {
+        return stats.summary(op);
+    }
+
+    // co_await async_consume(id) takes an item like consume(), but while the buffer is empty it parks
+    // the coroutine rather than the thread; the producer that publishes the next item resumes it. A
+    // parked async_consume() is the one consumer: no other consume call may run until it resumes.
+    ConsumeAwaiter<LinkedListBuffer, T> async_consume(int consumer_id) {
+        return {*this, consumer_id};
+    }
+
+    // Producing never waits in the infinite buffer, so co_await async_produce() does not suspend
+    template <typename U>
+    ProduceAwaiter<LinkedListBuffer, T> async_produce(U&& item, int producer_id) {
+        return {*this, std::forward<U>(item), producer_id};
+    }
+
+    // Live view for a monitoring thread. The producer never waits, so blocked_producers stays 0;
+    // blocked_consumers is 1 while the consumer has given up spinning and yields for an item.
+    BufferSnapshot snapshot() {
+        BufferSnapshot s = occupancy.snapshot();
+        s.produce = stats.summary(BufferOp::Produce);
+        s.consume = stats.summary(BufferOp::Consume);
+        return s;
+    }
+
+private:
+    friend class ::ConsumeAwaiter<LinkedListBuffer, T>;
+    friend class ::ProduceAwaiter<LinkedListBuffer, T>;
+
+    std::optional<T> consumeWithin(const WaitDeadline& deadline, int consumer_id) {
+        uint64_t request_time = CycleClock::now();
+        if (!waitForItems(deadline)) return std::nullopt;
+        uint64_t ready_time = CycleClock::now();
+
+        SlotStorage<T>& slot = tail->slots[tail_pos++];
+        int64_t logged_value = logValue(slot.get());
+        T item = slot.take();
+        occupancy.dequeued(1);
+
+        uint64_t now = CycleClock::now();
+        buffer_logger.log(LogRole::Consumer, consumer_id, logged_value, CycleClock::toNs(now - start_time), CycleClock::toNs(ready_time - request_time));
+        stats.record(BufferOp::Consume, request_time, ready_time, now, CycleClock::now());
+        return item;
+    }
+
+    bool suspendProducer(ItemWaiter<T>& waiter) {
+        emplace(waiter.thread_id, waiter.item.take());
+        return false;
+    }
+
+    // Parks waiter unless an item is ready; returns false if it completed at once. Parking and the
+    // producer's consumerParked() are both seq_cst read-modify-writes of parked_consumer, as in
+    // AsyncWaiterQueue, so either the re-check sees the producer's item or the producer sees the
+    // waiter. The re-check reads the occupancy counts rather than the tail segment, which the
+    // producer may already be consuming from.
+    bool suspendConsumer(ItemWaiter<T>& waiter) {
+        while (!hasItem()) {
+            parked_consumer.exchange(&waiter, std::memory_order_seq_cst);
+            if (occupancy.snapshot().depth == 0) return true;
+            // An item is on its way: take the waiter back, unless the producer already has it
+            if (parked_consumer.exchange(nullptr, std::memory_order_acquire) != &waiter) return true;
+        }
+        completeConsumer(waiter);
+        return false;
+    }
+
+    // Producer, after publishing
+    bool consumerParked() {
+        return parked_consumer.fetch_add(0, std::memory_order_seq_cst) != nullptr;
+    }
+
+    // Producer: hands the parked consumer the next item and resumes it on this thread. If the
+    // consumer took the item this produce published before it parked, the waiter goes back.
+    void resumeConsumer() {
+        AsyncWaiter* parked = parked_consumer.exchange(nullptr, std::memory_order_acquire);
+        if (!parked) return;
+        if (!hasItem()) {
+            parked_consumer.store(parked, std::memory_order_release);
+            return;
+        }
+        completeConsumer(static_cast<ItemWaiter<T>&>(*parked));
+        parked->handle.resume();
+    }
+
+    // Consumer side, with an item at tail_pos: moves it into waiter, then logs and records it
+    void completeConsumer(ItemWaiter<T>& waiter) {
+        uint64_t ready_time = CycleClock::now();
+        waiter.item.construct(tail->slots[tail_pos++].take());
+        occupancy.dequeued(1);
+
+        uint64_t now = CycleClock::now();
+        buffer_logger.log(LogRole::Consumer, waiter.thread_id, logValue(waiter.item.get()), CycleClock::toNs(now - start_time), CycleClock::toNs(ready_time - waiter.request_time));
+        stats.record(BufferOp::Consume, waiter.request_time, ready_time, now, CycleClock::now());
+    }
+
+    // Producer: the head segment is full, continue in a recycled or new one
+    void advanceHead() {
+        occupancy.published();
+        Segment* segment = spare.exchange(nullptr, std::memory_order_acquire);
+        if (segment) {
+            segment->written.store(0, std::memory_order_relaxed);
+            segment->next.store(nullptr, std::memory_order_relaxed);
+        } else {
+            segment = new Segment();
+        }
+        head->next.store(segment, std::memory_order_release);
+        head = segment;
+        head_pos = 0;
+    }
+
+    // Consumer: true if tail_pos is a published item, moving on to the next segment when the
+    // current one is used up. Only touches the producer's cache lines when the cache runs dry.
+    bool hasItem() {
+        while (true) {
+            if (tail_pos < cached_written) return true;
+            cached_written = tail->written.load(std::memory_order_acquire);
+            if (tail_pos < cached_written) return true;
+            if (tail_pos < SEGMENT_SIZE) return false;
+
+            Segment* next = tail->next.load(std::memory_order_acquire);
+            if (!next) return false;
+            Segment* drained = tail;
+            tail = next;
+            tail_pos = 0;
+            cached_written = 0;
+            // Keep one drained segment for the producer; free any older one
+            delete spare.exchange(drained, std::memory_order_acq_rel);
+        }
+    }
+
+    // Consumer: spins briefly, then yields until the producer publishes an item; false if the
+    // deadline runs out first. While it yields the consumer counts as blocked in the snapshot.
+    bool waitForItems(const WaitDeadline& deadline) {
+        Backoff backoff;
+        bool yielding = false;
+        bool ok = true;
+        while (!hasItem()) {
+            if (deadline.passed(closed)) {
+                ok = false;
+                break;
+            }
+            if (backoff.spin()) continue;
+            if (!yielding) occupancy.blockedCount(BufferOp::Consume).store(1, std::memory_order_relaxed);
+            yielding = true;
+            std::this_thread::yield();
+        }
+        if (yielding) occupancy.blockedCount(BufferOp::Consume).store(0, std::memory_order_relaxed);
+        return ok;
+    }
+};
+
+// Lock-free node: same role as Node, but the link is atomic so producers and consumers can
+// follow and swing it without holding a lock. A node is filled as soon as it is linked in.
+template <typename T>
+struct LockFreeNode {
+    SlotStorage<T> data;
+    std::atomic<LockFreeNode*> next;
+    LockFreeNode() : next(nullptr) {}
+};
+
+// Lock-free Infinite Buffer:-
+// Michael-Scott queue built on the same dummy-node design as LinkedListBuffer. The node at tail is
+// always the dummy; the first real item is tail->next. Producers link new nodes after head with a
+// CAS and consumers advance tail with a CAS, so no producer or consumer ever holds a lock. A consumer
+// that finds the queue empty spins briefly and then parks on an event count, which producers notify.
+// Unlinked dummies are reclaimed through hazard pointers (slot 0 = current node, slot 1 = its successor;
+// consume_bulk walks further with slots 1 and 2).
+template <typename T>
+class LockFreeLinkedListBuffer {
+private:
+    using NodeType = LockFreeNode<T>;
+
+    std::atomic<NodeType*> head; // Producer writes at the head end
+    std::atomic<NodeType*> tail; // Consumer reads at the tail end
+    EventCount not_empty;       // Consumers park here once the queue has stayed empty for a while
+    std::atomic<bool> closed{false};    // Set by close()
+
+    BufferStats stats;
+
+    uint64_t start_time;        // CycleClock ticks
+
+public:
+    LockFreeLinkedListBuffer() {
+        NodeType* dummy = NodePool<NodeType>::allocate();
+        head.store(dummy);
+        tail.store(dummy);
+        start_time = CycleClock::now();
+    }
+
+    ~LockFreeLinkedListBuffer() {
+        NodeType* node = tail.load();
+        bool is_dummy = true;
+        while (node) {
+            NodeType* next = node->next.load();
+            if (!is_dummy) node->data.destroy();
+            NodePool<NodeType>::release(node);
+            node = next;
+            is_dummy = false;
+        }
+    }
+
+    void produce(const T& item, int producer_id) {
+        emplace(producer_id, item);
+    }
+
+    void produce(T&& item, int producer_id) {
+        emplace(producer_id, std::move(item));
+    }
+
+    // Constructs the item in a fresh node before it is linked in, so no other thread can see it yet
+    template <typename... Args>
+    void emplace(int producer_id, Args&&... args) {
+        uint64_t request_time = CycleClock::now();
+
+        NodeType* new_node = NodePool<NodeType>::allocate();
+        new_node->data.construct(std::forward<Args>(args)...);
+        int64_t logged_value = logValue(new_node->data.get());
+
+        while (true) {
+            NodeType* last = HazardPointers::protect(0, head);
+            NodeType* next = last->next.load(std::memory_order_acquire);
+            if (last != head.load(std::memory_order_acquire)) continue;
+
+            if (next == nullptr) {
+                // Linking the new node publishes the item to consumers
+                if (last->next.compare_exchange_weak(next, new_node, std::memory_order_release, std::memory_order_relaxed)) {
+                    head.compare_exchange_strong(last, new_node, std::memory_order_release, std::memory_order_relaxed);
+                    break;
+                }
+            } else {
+                // Another producer linked a node but has not moved head yet; help it along
+                head.compare_exchange_strong(last, next, std::memory_order_release, std::memory_order_relaxed);
+            }
+        }
+        HazardPointers::clear(0);
+        not_empty.notifyOne();
+
+        uint64_t now = CycleClock::now();
+
+        // Logging; for the lock-free buffer the wait is the time spent retrying the CAS and there is
+        // no critical section to speak of
+        buffer_logger.log(LogRole::Producer, producer_id, logged_value, CycleClock::toNs(now - start_time), CycleClock::toNs(now - request_time));
+
+        stats.record(BufferOp::Produce, request_time, now, now, CycleClock::now());
+    }
+
+    T consume(int consumer_id) {
+        return *consumeWithin(WaitDeadline::forever(), consumer_id);
+    }
+
+    // Links all items with a single CAS: the nodes are filled and chained privately first,
+    // then the whole chain is published after head at once.
+    void produce_bulk(std::span<const T> items, int producer_id) {
+        if (items.empty()) return;
+        uint64_t request_time = CycleClock::now();
+
+        NodeType* chain_first = nullptr;
+        NodeType* chain_last = nullptr;
+        for (const T& item : items) {
+            NodeType* node = NodePool<NodeType>::allocate();
+            node->data.construct(item);
+            if (chain_last) chain_last->next.store(node, std::memory_order_relaxed);
+            else chain_first = node;
+            chain_last = node;
+        }
+
+        while (true) {
+            NodeType* last = HazardPointers::protect(0, head);
+            NodeType* next = last->next.load(std::memory_order_acquire);
+            if (last != head.load(std::memory_order_acquire)) continue;
+
+            if (next == nullptr) {
+                if (last->next.compare_exchange_weak(next, chain_first, std::memory_order_release, std::memory_order_relaxed)) {
+                    head.compare_exchange_strong(last, chain_last, std::memory_order_release, std::memory_order_relaxed);
+                    break;
+                }
+            } else {
+                head.compare_exchange_strong(last, next, std::memory_order_release, std::memory_order_relaxed);
+            }
+        }
+        HazardPointers::clear(0);
+        if (items.size() == 1) not_empty.notifyOne();
+        else not_empty.notifyAll();
+
+        uint64_t now = CycleClock::now();
+
+        for (const T& item : items)
+            buffer_logger.log(LogRole::Producer, producer_id, logValue(item), CycleClock::toNs(now - start_time), CycleClock::toNs(now - request_time));
+
+        stats.record(BufferOp::Produce, request_time, now, now, CycleClock::now(), items.size());
+    }
+
+    // Waits for at least one item, then dequeues up to min(out.size(), max) items by swinging
+    // tail past all of them with a single CAS. Returns the number of items written to out.
+    size_t consume_bulk(std::span<T> out, size_t max, int consumer_id) {
+        size_t limit = std::min(out.size(), max);
+        if (limit == 0) return 0;
+        uint64_t request_time = CycleClock::now();
+
+        NodeType* first;
+        NodeType* last_taken;
+        size_t count;
+        Backoff backoff;
+        while (true) {
+            first = HazardPointers::protect(0, tail);
+
+            // Walk hand over hand with the two remaining hazard slots. A node after first cannot be
+            // retired while tail is still first, so each hazard is validated against tail.
+            NodeType* cur = first;
+            count = 0;
+            bool restart = false;
+            while (count < limit) {
+                NodeType* next = cur->next.load(std::memory_order_acquire);
+                if (next == nullptr) break;
+                HazardPointers::set(1 + (count & 1), next);
+                if (tail.load(std::memory_order_seq_cst) != first) {
+                    restart = true;
+                    break;
+                }
+                // Never let tail overtake a lagging head; help head forward first. Whether this CAS
+                // succeeds or fails, head has moved past cur afterwards.
+                NodeType* lagging = cur;
+                if (head.load(std::memory_order_acquire) == cur)
+                    head.compare_exchange_strong(lagging, next, std::memory_order_release, std::memory_order_relaxed);
+                cur = next;
+                count++;
+            }
+            if (restart) continue;
+            if (count == 0) {
+                waitForItem(backoff, WaitDeadline::forever());
+                continue;
+            }
+            last_taken = cur;
+            if (tail.compare_exchange_strong(first, last_taken, std::memory_order_acq_rel, std::memory_order_relaxed)) break;
+        }
+        uint64_t dequeued_time = CycleClock::now();
+
+        // first and the nodes up to (not including) last_taken are now owned by this thread;
+        // last_taken is the new dummy and stays protected by its hazard slot until we are done
+        NodeType* node = first;
+        for (size_t i = 0; i < count; ++i) {
+            NodeType* next = node->next.load(std::memory_order_acquire);
+            out[i] = next->data.take();
+            HazardPointers::retire(node, &recycleNode);
+            node = next;
+        }
+        HazardPointers::clear(0);
+        HazardPointers::clear(1);
+        HazardPointers::clear(2);
+
+        uint64_t now = CycleClock::now();
+
+        for (size_t i = 0; i < count; ++i)
+            buffer_logger.log(LogRole::Consumer, consumer_id, logValue(out[i]), CycleClock::toNs(now - start_time), CycleClock::toNs(dequeued_time - request_time));
+
+        stats.record(BufferOp::Consume, request_time, dequeued_time, now, CycleClock::now(), count);
+
+        return count;
+    }
+
+    // Non-blocking and timed versions of produce() and consume(). Producing never waits here, so
+    // the produce calls only fail once the buffer is closed. The consume calls return nullopt when
+    // the deadline passes without an item, and at once when the buffer is closed and drained.
+    template <typename U>
+    bool try_produce(U&& item, int producer_id) {
+        if (closed.load(std::memory_order_acquire)) return false;
+        emplace(producer_id, std::forward<U>(item));
+        return true;
+    }
+
+    template <typename U, typename Rep, typename Period>
+    bool produce_for(U&& item, const std::chrono::duration<Rep, Period>&, int producer_id) {
+        return try_produce(std::forward<U>(item), producer_id);
+    }
+
+    template <typename U>
+    bool produce_until(U&& item, std::chrono::steady_clock::time_point, int producer_id) {
+        return try_produce(std::forward<U>(item), producer_id);
+    }
+
+    std::optional<T> try_consume(int consumer_id) {
+        return consumeWithin(WaitDeadline::none(), consumer_id);
+    }
+
+    template <typename Rep, typename Period>
+    std::optional<T> consume_for(const std::chrono::duration<Rep, Period>& timeout, int consumer_id) {
+        return consumeWithin(WaitDeadline::after(timeout), consumer_id);
+    }
+
+    std::optional<T> consume_until(std::chrono::steady_clock::time_point deadline, int consumer_id) {
+        return consumeWithin(WaitDeadline::at(deadline), consumer_id);
+    }
+
+    // No more items are coming: the try_/timed produce calls fail from now on, the try_/timed consume
+    // calls still take the items left but stop waiting once the buffer is empty, and every thread
+    // waiting in one of them wakes up. The blocking produce() and consume() are not affected.
+    void close() {
+        closed.store(true, std::memory_order_seq_cst);
+        not_empty.notifyAll();
+    }
+
+    bool isClosed() const {
+        return closed.load(std::memory_order_acquire);
+    }
+
+    std::vector<double> Stats() {
+        std::vector<double> time_stat;
+        time_stat.push_back(stats.summary(BufferOp::Produce).total_seconds);
+        time_stat.push_back(stats.summary(BufferOp::Consume).total_seconds);
+        return time_stat;
+    }
+
+    LatencySummary latency(BufferOp op) {
+        return stats.summary(op);
+    }
+
+private:
+    std::optional<T> consumeWithin(const WaitDeadline& deadline, int consumer_id) {
+        uint64_t request_time = CycleClock::now();
+
+        NodeType* first;
+        NodeType* next;
+        Backoff backoff;
+        while (true) {
+            first = HazardPointers::protect(0, tail);
+            NodeType* last = head.load(std::memory_order_acquire);
+            next = HazardPointers::protect(1, first->next);
+            if (first != tail.load(std::memory_order_acquire)) continue;
+
+            if (next == nullptr) {
+                if (deadline.passed(closed)) {
+                    HazardPointers::clear(0);
+                    HazardPointers::clear(1);
+                    return std::nullopt;
+                }
+                waitForItem(backoff, deadline);
+                continue;
+            }
+            if (first == last) {
+                // head is lagging behind a linked node; help it along before dequeuing
+                head.compare_exchange_strong(last, next, std::memory_order_release, std::memory_order_relaxed);
+                continue;
+            }
+            if (tail.compare_exchange_strong(first, next, std::memory_order_acq_rel, std::memory_order_relaxed)) break;
+        }
+        uint64_t dequeued_time = CycleClock::now();
+
+        // next becomes the new dummy; it stays protected by slot 1 while the item is moved out
+        int64_t logged_value = logValue(next->data.get());
+        T item = next->data.take();
+        HazardPointers::clear(0);
+        HazardPointers::clear(1);
+        HazardPointers::retire(first, &recycleNode);
+
+        uint64_t now = CycleClock::now();
+
+        // Logging
+        buffer_logger.log(LogRole::Consumer, consumer_id, logged_value, CycleClock::toNs(now - start_time), CycleClock::toNs(dequeued_time - request_time));
+
+        stats.record(BufferOp::Consume, request_time, dequeued_time, now, CycleClock::now());
+
+        return item;
+    }
+
+    // Consumer, with the queue found empty: spins for the first rounds, then parks on not_empty until a
+    // producer links a node, the deadline passes or the buffer is closed. The re-check after
+    // prepareWait() pairs with the producers' notify, as in the other event-count buffers.
+    void waitForItem(Backoff& backoff, const WaitDeadline& deadline) {
+        if (backoff.spin()) return;
+        uint32_t key = not_empty.prepareWait();
+        if (hasItem() || deadline.passed(closed)) not_empty.cancelWait();
+        else not_empty.commitWait(key, deadline);
+        backoff.reset();
+    }
+
+    // Consumer: is there an item after the dummy? Protects tail in hazard slot 0 to read its link.
+    bool hasItem() {
+        NodeType* first = HazardPointers::protect(0, tail);
+        return first->next.load(std::memory_order_seq_cst) != nullptr;
+    }
+
+    // Retired dummies go back to the node pool instead of the global allocator
+    static void recycleNode(void* node) {
+        NodePool<NodeType>::release(static_cast<NodeType*>(node));
+    }
+};
+
+// Sharded Infinite Buffer:-
+// Producers no longer funnel into one head pointer. The buffer holds one sub-queue (shard) per
+// producer or producer group: producer p always appends to shard (p - 1) % shard count, so the items
+// of one producer stay in FIFO order, while there is no global order across shards. Each shard is
+// a LinkedListBuffer-style list with its own producer and consumer locks. A consumer first drains
+// its home shard (c - 1) % shard count; when that is empty it steals from the other shards, taking
+// their consumer lock only if it is free (try_lock) so that stealing never queues behind the owner.
+// When no shard has an item, consumers park on one event count shared by all shards.
+//
+// ShardedBuffer(per_numa_node) is the per-socket layout: one shard per NUMA node, and threads are
+// routed by the node they run on instead of their id. Producers append to their own socket's shard,
+// whose nodes come from that socket's node pool, and consumers drain their socket's shard first, so
+// a socket's items cross the interconnect only when another socket's consumers run out of work and
+// steal them. Stealing is the forwarding between sockets; it needs no extra thread. Routing by node
+// only makes sense for pinned threads (see pinCurrentThread); on a single-node machine the layout is
+// one shard shared by everybody.
+struct PerNumaNode {
+    explicit PerNumaNode() = default;
+};
+inline constexpr PerNumaNode per_numa_node{};
+
+template <typename T>
+class ShardedBuffer {
+public:
+    // Per-shard counters for the balance report
+    struct ShardStats {
+        uint64_t produced = 0;
+        uint64_t consumed = 0;      // all items taken from the shard, stolen ones included
+        uint64_t stolen = 0;        // items taken by a consumer whose home shard is a different one
+        int64_t depth = 0;          // items currently in the shard
+        int64_t peak_depth = 0;
+    };
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Shard {
+        Node<T>* head;              // Producer writes at the head end
+        std::mutex producer_lock;
+
+        alignas(CACHE_LINE_SIZE) Node<T>* tail;    // Consumer reads at the tail end
+        std::mutex consumer_lock;
+
+        // Depth is the handshake with waiting consumers, so it is changed with seq_cst RMWs
+        alignas(CACHE_LINE_SIZE) std::atomic<int64_t> depth{0};
+        std::atomic<int64_t> peak_depth{0};        // written under producer_lock
+        std::atomic<uint64_t> produced{0};         // written under producer_lock
+        std::atomic<uint64_t> consumed{0};         // written under consumer_lock
+        std::atomic<uint64_t> stolen{0};           // written under consumer_lock
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    const bool by_node = false;     // Route by NUMA node instead of thread id
+    EventCount not_empty;
+    std::atomic<bool> closed{false};    // Set by close()
+
+    BufferStats stats;
+
+    uint64_t start_time;        // CycleClock ticks
+
+public:
+    explicit ShardedBuffer(size_t shard_count) {
+        createShards(std::max<size_t>(shard_count, 1));
+    }
+
+    explicit ShardedBuffer(PerNumaNode) : by_node(true) {
+        createShards(NumaTopology::system().nodeCount());
+    }
+
+    ~ShardedBuffer() {
+        for (auto& shard : shards) {
+            Node<T>* node = shard->tail;
+            while (node) {
+                Node<T>* next = node->next;
+                if (node->filled.load(std::memory_order_relaxed)) node->data.destroy();
+                NodePool<Node<T>>::release(node);
+                node = next;
+            }
+        }
+    }
+
+    size_t shardCount() const {
+        return shards.size();
+    }
+
+    // Shard i is the shard of NUMA node i
+    bool perNumaNode() const {
+        return by_node;
+    }
+
+    ShardStats shardStats(size_t index) const {
+        const Shard& s = *shards[index];
+        ShardStats out;
+        out.produced = s.produced.load(std::memory_order_relaxed);
+        out.consumed = s.consumed.load(std::memory_order_relaxed);
+        out.stolen = s.stolen.load(std::memory_order_relaxed);
+        out.depth = s.depth.load(std::memory_order_relaxed);
+        out.peak_depth = s.peak_depth.load(std::memory_order_relaxed);
+        return out;
+    }
+
+    void produce(const T& item, int producer_id) {
+        emplace(producer_id, item);
+    }
+
+    void produce(T&& item, int producer_id) {
+        emplace(producer_id, std::move(item));
+    }
+
+    template <typename... Args>
+    void emplace(int producer_id, Args&&... args) {
+        uint64_t request_lock_time = CycleClock::now();
+        Shard& shard = shardFor(producer_id);
+        Node<T>* new_node = NodePool<Node<T>>::allocate();
+
+        std::unique_lock<std::mutex> lock(shard.producer_lock);
+        uint64_t acquired_lock_time = CycleClock::now();
+
+        shard.head->data.construct(std::forward<Args>(args)...);
+        int64_t logged_value = logValue(shard.head->data.get());
+        shard.head->next = new_node;
+        shard.head->filled.store(true, std::memory_order_release);
+        shard.head = new_node;
+        published(shard, 1);
+
+        uint64_t now = CycleClock::now();
+        lock.unlock();
+        not_empty.notifyOne();
+
+        buffer_logger.log(LogRole::Producer, producer_id, logged_value, CycleClock::toNs(now - start_time), CycleClock::toNs(acquired_lock_time - request_lock_time));
+        stats.record(BufferOp::Produce, request_lock_time, acquired_lock_time, now, CycleClock::now());
+    }
+
+    T consume(int consumer_id) {
+        return *consumeWithin(WaitDeadline::forever(), consumer_id);
+    }
+
+    // Splices all items into the producer's shard with one lock acquisition, like LinkedListBuffer
+    void produce_bulk(std::span<const T> items, int producer_id) {
+        if (items.empty()) return;
+        uint64_t request_lock_time = CycleClock::now();
+        Shard& shard = shardFor(producer_id);
+
+        Node<T>* chain_first = nullptr;
+        Node<T>* chain_last = nullptr;
+        for (size_t i = 1; i <= items.size(); ++i) {
+            Node<T>* node = NodePool<Node<T>>::allocate();
+            if (i < items.size()) {
+                node->data.construct(items[i]);
+                node->filled.store(true, std::memory_order_relaxed);     // Published by the release store on head below
+            }
+            if (chain_last) chain_last->next = node;
+            else chain_first = node;
+            chain_last = node;
+        }
+
+        std::unique_lock<std::mutex> lock(shard.producer_lock);
+        uint64_t acquired_lock_time = CycleClock::now();
+        shard.head->data.construct(items[0]);
+        shard.head->next = chain_first;
+        shard.head->filled.store(true, std::memory_order_release);
+        shard.head = chain_last;
+        published(shard, static_cast<int64_t>(items.size()));
+
+        uint64_t now = CycleClock::now();
+        lock.unlock();
+        if (items.size() == 1) not_empty.notifyOne();
+        else not_empty.notifyAll();
+
+        for (const T& item : items)
+            buffer_logger.log(LogRole::Producer, producer_id, logValue(item), CycleClock::toNs(now - start_time), CycleClock::toNs(acquired_lock_time - request_lock_time));
+        stats.record(BufferOp::Produce, request_lock_time, acquired_lock_time, now, CycleClock::now(), items.size());
+    }
+
+    // Waits for at least one item, then takes up to min(out.size(), max) items from the first shard
+    // that has any (home shard first). Returns the number of items written to out.
+    size_t consume_bulk(std::span<T> out, size_t max, int consumer_id) {
+        size_t limit = std::min(out.size(), max);
+        if (limit == 0) return 0;
+        uint64_t request_time = CycleClock::now();
+        uint64_t acquired_time = 0;
+
+        size_t count = 0;
+        waitAndTake(consumer_id, limit, [&](Node<T>* node) {
+            out[count++] = node->data.take();
+        }, acquired_time, WaitDeadline::forever());
+
+        uint64_t now = CycleClock::now();
+        for (size_t i = 0; i < count; ++i)
+            buffer_logger.log(LogRole::Consumer, consumer_id, logValue(out[i]), CycleClock::toNs(now - start_time), CycleClock::toNs(acquired_time - request_time));
+        stats.record(BufferOp::Consume, request_time, acquired_time, now, CycleClock::now(), count);
+        return count;
+    }
+
+    // Non-blocking and timed versions of produce() and consume(). Producing never waits here, so
+    // the produce calls only fail once the buffer is closed. The consume calls return nullopt when
+    // the deadline passes without an item, and at once when the buffer is closed and drained.
+    template <typename U>
+    bool try_produce(U&& item, int producer_id) {
+        if (closed.load(std::memory_order_acquire)) return false;
+        emplace(producer_id, std::forward<U>(item));
+        return true;
+    }
+
+    template <typename U, typename Rep, typename Period>
+    bool produce_for(U&& item, const std::chrono::duration<Rep, Period>&, int producer_id) {
+        return try_produce(std::forward<U>(item), producer_id);
+    }
+
+    template <typename U>
+    bool produce_until(U&& item, std::chrono::steady_clock::time_point, int producer_id) {
+        return try_produce(std::forward<U>(item), producer_id);
+    }
+
+    std::optional<T> try_consume(int consumer_id) {
+        return consumeWithin(WaitDeadline::none(), consumer_id);
+    }
+
+    template <typename Rep, typename Period>
+    std::optional<T> consume_for(const std::chrono::duration<Rep, Period>& timeout, int consumer_id) {
+        return consumeWithin(WaitDeadline::after(timeout), consumer_id);
+    }
+
+    std::optional<T> consume_until(std::chrono::steady_clock::time_point deadline, int consumer_id) {
+        return consumeWithin(WaitDeadline::at(deadline), consumer_id);
+    }
+
+    // No more items are coming: the try_/timed produce calls fail from now on, the try_/timed consume
+    // calls still take the items left but stop waiting once the buffer is empty, and every thread
+    // waiting in one of them wakes up. The blocking produce() and consume() are not affected.
+    void close() {
+        closed.store(true, std::memory_order_seq_cst);
+        not_empty.notifyAll();
+    }
+
+    bool isClosed() const {
+        return closed.load(std::memory_order_acquire);
+    }
+
+    std::vector<double> Stats() {
+        std::vector<double> time_stat;
+        time_stat.push_back(stats.summary(BufferOp::Produce).total_seconds);
+        time_stat.push_back(stats.summary(BufferOp::Consume).total_seconds);
+        return time_stat;
+    }
+
+    LatencySummary latency(BufferOp op) {
+        return stats.summary(op);
+    }
+
+private:
+    std::optional<T> consumeWithin(const WaitDeadline& deadline, int consumer_id) {
+        uint64_t request_time = CycleClock::now();
+        uint64_t acquired_time = 0;
+
+        // Takes exactly one item; it passes through a SlotStorage so that T needs no default constructor
+        SlotStorage<T> taken;
+        bool took = waitAndTake(consumer_id, 1, [&](Node<T>* node) {
+            taken.construct(node->data.take());
+        }, acquired_time, deadline);
+        if (!took) return std::nullopt;
+
+        T item = taken.take();
+        uint64_t now = CycleClock::now();
+        buffer_logger.log(LogRole::Consumer, consumer_id, logValue(item), CycleClock::toNs(now - start_time), CycleClock::toNs(acquired_time - request_time));
+        stats.record(BufferOp::Consume, request_time, acquired_time, now, CycleClock::now());
+        return item;
+    }
+
+    void createShards(size_t shard_count) {
+        for (size_t i = 0; i < shard_count; ++i) {
+            auto shard = std::make_unique<Shard>();
+            shard->head = shard->tail = NodePool<Node<T>>::allocate();   // Dummy node, as in LinkedListBuffer
+            shards.push_back(std::move(shard));
+        }
+        start_time = CycleClock::now();
+    }
+
+    // A producer's shard, and the shard a consumer empties first
+    size_t homeShard(int id) const {
+        if (by_node) return NumaTopology::system().currentNode();
+        return static_cast<size_t>(id > 0 ? id - 1 : 0) % shards.size();
+    }
+
+    Shard& shardFor(int id) {
+        return *shards[homeShard(id)];
+    }
+
+    // Called under the shard's producer lock after count items were linked in
+    void published(Shard& shard, int64_t count) {
+        int64_t depth = shard.depth.fetch_add(count, std::memory_order_seq_cst) + count;
+        if (depth > shard.peak_depth.load(std::memory_order_relaxed)) shard.peak_depth.store(depth, std::memory_order_relaxed);
+        shard.produced.store(shard.produced.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    }
+
+    bool anyItems() const {
+        for (auto& shard : shards) {
+            if (shard->depth.load(std::memory_order_seq_cst) > 0) return true;
+        }
+        return false;
+    }
+
+    // Takes up to limit items from one shard and passes each node to take(node). The home shard's
+    // consumer lock is waited for; a victim's is only tried. Returns the number of items taken.
+    template <typename Take>
+    size_t takeFrom(Shard& shard, size_t limit, bool steal, Take& take) {
+        if (shard.depth.load(std::memory_order_relaxed) <= 0) return 0;
+        std::unique_lock<std::mutex> lock(shard.consumer_lock, std::defer_lock);
+        if (steal) {
+            if (!lock.try_lock()) return 0;
+        } else {
+            lock.lock();
+        }
+
+        Node<T>* first = shard.tail;
+        size_t count = 0;
+        while (count < limit && shard.tail->filled.load(std::memory_order_acquire)) {
+            take(shard.tail);
+            shard.tail->filled.store(false, std::memory_order_relaxed);
+            shard.tail = shard.tail->next;
+            count++;
+        }
+        if (count > 0) {
+            shard.depth.fetch_sub(static_cast<int64_t>(count), std::memory_order_relaxed);
+            shard.consumed.store(shard.consumed.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+            if (steal) shard.stolen.store(shard.stolen.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+        }
+        lock.unlock();
+
+        // The consumed nodes are detached from the shard, so they can be recycled without the lock
+        for (size_t i = 0; i < count; ++i) {
+            Node<T>* next = first->next;
+            NodePool<Node<T>>::release(first);
+            first = next;
+        }
+        return count;
+    }
+
+    // Home shard first, then every other shard in turn; parks when all of them are empty. Returns
+    // false if the deadline runs out before an item is taken.
+    template <typename Take>
+    bool waitAndTake(int consumer_id, size_t limit, Take take, uint64_t& acquired_time, const WaitDeadline& deadline) {
+        size_t home = homeShard(consumer_id);
+        Backoff backoff;
+        while (true) {
+            acquired_time = CycleClock::now();
+            if (takeFrom(*shards[home], limit, false, take) > 0) return true;
+            for (size_t i = 1; i < shards.size(); ++i) {
+                if (takeFrom(*shards[(home + i) % shards.size()], limit, true, take) > 0) return true;
+            }
+            if (deadline.passed(closed)) return false;
+            if (backoff.spin()) continue;
+
+            uint32_t key = not_empty.prepareWait();
+            if (anyItems() || deadline.passed(closed)) {
+                not_empty.cancelWait();
+            } else {
+                not_empty.commitWait(key, deadline);
+            }
+            backoff.reset();
+        }
+    }
+};
+
+// Hybrid Infinite Buffer:-
+// Runs on a fixed ring of ring_capacity slots while consumers keep up, and spills into a chain of
+// SEGMENT_SIZE-slot array segments when the ring is full, so a burst never stalls a producer and the
+// common case allocates nothing. Producers are ordered by ProducerLock, consumers by mutex_consumer,
+// as in LinkedListBuffer.
+//
+// FIFO order across the two parts comes from one rule: producers only write the ring while nothing is
+// spilled. Every unconsumed ring item is therefore older than every spilled item, and a consumer
+// takes from the ring first. It reads the spill count before looking at the ring, so seeing a
+// spilled item also makes every older ring item visible. Once the consumers have drained all
+// spilled items (and with them the ring), the next producer switches back to the ring. Drained
+// segments are handed back to the producers through `spare`, and a producer only takes one (before
+// the lock) when the spill head is about to need it.
+template <typename T, typename ProducerLock = TicketLock>
+class HybridBuffer {
+private:
+    static constexpr size_t SEGMENT_SIZE = 256;
+
+    struct alignas(CACHE_LINE_SIZE) RingSlot {
+        std::atomic<bool> filled{false};
+        SlotStorage<T> data;
+    };
+
+    struct Segment {
+        std::atomic<Segment*> next{nullptr};
+        SlotStorage<T> slots[SEGMENT_SIZE];
+    };
+
+    const size_t ring_capacity;
+    std::unique_ptr<RingSlot[]> ring;
+
+    // Producer side, under ticket_lock_producer
+    ProducerLock ticket_lock_producer;
+    size_t ring_head = 0;           // Producer writes at the head end
+    bool spilling = false;          // New items go to the segments until they have been drained
+    Segment* spill_head;
+    size_t spill_head_pos = 0;
+    // spilling && spill_head_pos == SEGMENT_SIZE: the next spilled item needs a new segment. Read
+    // without the lock as a hint for whether to fetch one before taking it.
+    std::atomic<bool> spill_head_full{false};
+    std::atomic<uint64_t> spill_events{0};     // Times the ring overflowed
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> spill_produced{0};  // Publishes the spilled items
+
+    // Consumer side, under mutex_consumer
+    alignas(CACHE_LINE_SIZE) std::mutex mutex_consumer;
+    size_t ring_tail = 0;           // Consumer reads at the tail end
+    Segment* spill_tail;
+    size_t spill_tail_pos = 0;
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> spill_consumed{0};
+
+    alignas(CACHE_LINE_SIZE) std::atomic<Segment*> spare{nullptr};
+    EventCount not_empty;
+    std::atomic<bool> closed{false};    // Set by close()
+
+    BufferStats stats;
+    OccupancyCounters occupancy;
+
+    uint64_t start_time;        // CycleClock ticks
+
+public:
+    explicit HybridBuffer(size_t requested_capacity = 1024)
+        : ring_capacity(std::max<size_t>(requested_capacity, 1)), ring(new RingSlot[ring_capacity]) {
+        spill_head = spill_tail = new Segment();
+        start_time = CycleClock::now();
+    }
+
+    ~HybridBuffer() {
+        size_t index = ring_tail;
+        while (ring[index].filled.load(std::memory_order_relaxed)) {
+            ring[index].data.destroy();
+            ring[index].filled.store(false, std::memory_order_relaxed);
+            index = advance(index);
+        }
+        uint64_t left = spill_produced.load(std::memory_order_relaxed) - spill_consumed.load(std::memory_order_relaxed);
+        size_t pos = spill_tail_pos;
+        while (spill_tail) {
+            Segment* next = spill_tail->next.load(std::memory_order_relaxed);
+            for (; pos < SEGMENT_SIZE && left > 0; ++pos, --left) spill_tail->slots[pos].destroy();
+            delete spill_tail;
+            spill_tail = next;
+            pos = 0;
+        }
+        delete spare.load(std::memory_order_relaxed);
+    }
+
+    size_t capacity() const {
+        return ring_capacity;
+    }
+
+    // Items that did not fit in the ring, and the number of times the ring overflowed
+    uint64_t spilledItems() const {
+        return spill_produced.load(std::memory_order_relaxed);
+    }
+
+    uint64_t spillCount() const {
+        return spill_events.load(std::memory_order_relaxed);
+    }
+
+    void produce(const T& item, int producer_id) {
+        emplace(producer_id, item);
+    }
+
+    void produce(T&& item, int producer_id) {
+        emplace(producer_id, std::move(item));
+    }
+
+    template <typename... Args>
+    void emplace(int producer_id, Args&&... args) {
+        uint64_t request_lock_time = CycleClock::now();
+        // A new segment is needed when the spill head is full; fetching it outside the lock keeps the
+        // allocator out of the critical section
+        Segment* reserve = spillReserve();
+
+        ticket_lock_producer.lock();
+        uint64_t acquired_lock_time = CycleClock::now();
+
+        occupancy.enqueued(1);
+        int64_t logged_value = put(reserve, std::forward<Args>(args)...);
+        occupancy.published();
+
+        uint64_t now = CycleClock::now();
+        ticket_lock_producer.unlock();
+        not_empty.notifyOne();
+        recycle(reserve);
+
+        buffer_logger.log(LogRole::Producer, producer_id, logged_value, CycleClock::toNs(now - start_time), CycleClock::toNs(acquired_lock_time - request_lock_time));
+        stats.record(BufferOp::Produce, request_lock_time, acquired_lock_time, now, CycleClock::now());
+    }
+
+    T consume(int consumer_id) {
+        return *consumeWithin(WaitDeadline::forever(), consumer_id);
+    }
+
+    // Writes all items under one producer lock acquisition and wakes the consumers once
+    void produce_bulk(std::span<const T> items, int producer_id) {
+        if (items.empty()) return;
+        uint64_t request_lock_time = CycleClock::now();
+        Segment* reserve = spillReserve();
+
+        ticket_lock_producer.lock();
+        uint64_t acquired_lock_time = CycleClock::now();
+
+        occupancy.enqueued(items.size());
+        for (const T& item : items) put(reserve, item);
+        occupancy.published();
+
+        uint64_t now = CycleClock::now();
+        ticket_lock_producer.unlock();
+        if (items.size() == 1) not_empty.notifyOne();
+        else not_empty.notifyAll();
+        recycle(reserve);
+
+        for (const T& item : items)
+            buffer_logger.log(LogRole::Producer, producer_id, logValue(item), CycleClock::toNs(now - start_time), CycleClock::toNs(acquired_lock_time - request_lock_time));
+        stats.record(BufferOp::Produce, request_lock_time, acquired_lock_time, now, CycleClock::now(), items.size());
+    }
+
+    // Waits for at least one item, then takes up to min(out.size(), max) ready items, ring first.
+    // Returns the number of items written to out.
+    size_t consume_bulk(std::span<T> out, size_t max, int consumer_id) {
+        size_t limit = std::min(out.size(), max);
+        if (limit == 0) return 0;
+        uint64_t request_lock_time = CycleClock::now();
+
+        std::unique_lock<std::mutex> lock(mutex_consumer);
+        waitForItem(lock, WaitDeadline::forever());
+        uint64_t acquired_lock_time = CycleClock::now();
+
+        size_t count = 0;
+        bool spilled;
+        while (count < limit) {
+            SlotStorage<T>* slot = oldest(spilled);
+            if (!slot) break;
+            out[count++] = slot->take();
+            pop(spilled);
+        }
+        occupancy.dequeued(count);
+
+        uint64_t now = CycleClock::now();
+        lock.unlock();
+
+        for (size_t i = 0; i < count; ++i)
+            buffer_logger.log(LogRole::Consumer, consumer_id, logValue(out[i]), CycleClock::toNs(now - start_time), CycleClock::toNs(acquired_lock_time - request_lock_time));
+        stats.record(BufferOp::Consume, request_lock_time, acquired_lock_time, now, CycleClock::now(), count);
+        return count;
+    }
+
+    std::vector<double> Stats() {
+        std::vector<double> time_stat;
+        time_stat.push_back(stats.summary(BufferOp::Produce).total_seconds);
+        time_stat.push_back(stats.summary(BufferOp::Consume).total_seconds);
+        return time_stat;
+    }
+
+    LatencySummary latency(BufferOp op) {
+        return stats.summary(op);
+    }
+
+    // Non-blocking and timed versions of produce() and consume(). Producing never waits here, so
+    // the produce calls only fail once the buffer is closed. The consume calls return nullopt when
+    // the deadline passes without an item, and at once when the buffer is closed and drained.
+    template <typename U>
+    bool try_produce(U&& item, int producer_id) {
+        if (closed.load(std::memory_order_acquire)) return false;
+        emplace(producer_id, std::forward<U>(item));
+        return true;
+    }
+
+    template <typename U, typename Rep, typename Period>
+    bool produce_for(U&& item, const std::chrono::duration<Rep, Period>&, int producer_id) {
+        return try_produce(std::forward<U>(item), producer_id);
+    }
+
+    template <typename U>
+    bool produce_until(U&& item, std::chrono::steady_clock::time_point, int producer_id) {
+        return try_produce(std::forward<U>(item), producer_id);
+    }
+
+    std::optional<T> try_consume(int consumer_id) {
+        return consumeWithin(WaitDeadline::none(), consumer_id);
+    }
+
+    template <typename Rep, typename Period>
+    std::optional<T> consume_for(const std::chrono::duration<Rep, Period>& timeout, int consumer_id) {
+        return consumeWithin(WaitDeadline::after(timeout), consumer_id);
+    }
+
+    std::optional<T> consume_until(std::chrono::steady_clock::time_point deadline, int consumer_id) {
+        return consumeWithin(WaitDeadline::at(deadline), consumer_id);
+    }
+
+    // No more items are coming: the try_/timed produce calls fail from now on, the try_/timed consume
+    // calls still take the items left but stop waiting once the buffer is empty, and every thread
+    // waiting in one of them wakes up. The blocking produce() and consume() are not affected.
+    void close() {
+        closed.store(true, std::memory_order_seq_cst);
+        not_empty.notifyAll();
+    }
+
+    bool isClosed() const {
+        return closed.load(std::memory_order_acquire);
+    }
+
+    // Live view for a monitoring thread; producers never block, so blocked_producers stays 0
+    BufferSnapshot snapshot() {
+        BufferSnapshot s = occupancy.snapshot();
+        s.produce = stats.summary(BufferOp::Produce);
+        s.consume = stats.summary(BufferOp::Consume);
+        return s;
+    }
+
+private:
+    std::optional<T> consumeWithin(const WaitDeadline& deadline, int consumer_id) {
+        uint64_t request_lock_time = CycleClock::now();
+
+        std::unique_lock<std::mutex> lock(mutex_consumer);
+        if (!waitForItem(lock, deadline)) return std::nullopt;
+        uint64_t acquired_lock_time = CycleClock::now();
+
+        bool spilled;
+        SlotStorage<T>* slot = oldest(spilled);
+        int64_t logged_value = logValue(slot->get());
+        T item = slot->take();
+        pop(spilled);
+        occupancy.dequeued(1);
+
+        uint64_t now = CycleClock::now();
+        lock.unlock();
+
+        buffer_logger.log(LogRole::Consumer, consumer_id, logged_value, CycleClock::toNs(now - start_time), CycleClock::toNs(acquired_lock_time - request_lock_time));
+        stats.record(BufferOp::Consume, request_lock_time, acquired_lock_time, now, CycleClock::now());
+        return item;
+    }
+
+    size_t advance(size_t index) const {
+        return index + 1 == ring_capacity ? 0 : index + 1;
+    }
+
+    // Producer, before the lock: a segment for put() if the spill head looked full, recycled if one
+    // is waiting. Produces that only write the ring leave spare alone.
+    Segment* spillReserve() {
+        if (!spill_head_full.load(std::memory_order_relaxed)) return nullptr;
+        Segment* segment = spare.exchange(nullptr, std::memory_order_acquire);
+        return segment ? segment : new Segment();
+    }
+
+    // Producer, after the lock: a reserve put() did not need goes back to spare, unless the consumers
+    // have parked another segment there meanwhile
+    void recycle(Segment* reserve) {
+        if (!reserve) return;
+        Segment* empty = nullptr;
+        if (!spare.compare_exchange_strong(empty, reserve, std::memory_order_release, std::memory_order_relaxed)) delete reserve;
+    }
+
+    // Producer, under ticket_lock_producer: stores one item in the ring or, when the ring is full or
+    // items are still spilled, at the end of the segment chain. A new segment comes from reserve
+    // (which is then set to nullptr), else from spare, else the allocator. Returns the logged value.
+    template <typename... Args>
+    int64_t put(Segment*& reserve, Args&&... args) {
+        if (spilling && spill_consumed.load(std::memory_order_acquire) == spill_produced.load(std::memory_order_relaxed)) {
+            // Everything spilled (and so everything in the ring before it) has been consumed
+            spilling = false;
+        }
+        RingSlot& slot = ring[ring_head];
+        if (!spilling && !slot.filled.load(std::memory_order_acquire)) {
+            slot.data.construct(std::forward<Args>(args)...);
+            int64_t logged_value = logValue(slot.data.get());
+            slot.filled.store(true, std::memory_order_release);
+            ring_head = advance(ring_head);
+            updateSpillHint();
+            return logged_value;
+        }
+        if (!spilling) {
+            spilling = true;
+            spill_events.store(spill_events.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        if (spill_head_pos == SEGMENT_SIZE) {
+            Segment* segment = reserve;
+            reserve = nullptr;
+            if (!segment) segment = spare.exchange(nullptr, std::memory_order_acquire);
+            if (!segment) segment = new Segment();
+            segment->next.store(nullptr, std::memory_order_relaxed);
+            spill_head->next.store(segment, std::memory_order_relaxed);   // Published by spill_produced
+            spill_head = segment;
+            spill_head_pos = 0;
+        }
+        SlotStorage<T>& target = spill_head->slots[spill_head_pos++];
+        target.construct(std::forward<Args>(args)...);
+        int64_t logged_value = logValue(target.get());
+        spill_produced.store(spill_produced.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        updateSpillHint();
+        return logged_value;
+    }
+
+    // Producer, under ticket_lock_producer; stores only on a change, as most produces leave it alone
+    void updateSpillHint() {
+        bool full = spilling && spill_head_pos == SEGMENT_SIZE;
+        if (full != spill_head_full.load(std::memory_order_relaxed)) spill_head_full.store(full, std::memory_order_relaxed);
+    }
+
+    // Consumer: is an item ready? seq_cst so that it pairs with the event count when parking.
+    bool hasItem(std::memory_order order) const {
+        return spill_consumed.load(std::memory_order_relaxed) < spill_produced.load(order) ||
+               ring[ring_tail].filled.load(order);
+    }
+
+    // Consumer, under mutex_consumer: the slot of the oldest ready item, or nullptr. The spill count
+    // is read first: an item seen there makes every older ring item visible.
+    SlotStorage<T>* oldest(bool& spilled) {
+        spilled = false;
+        bool any_spilled = spill_consumed.load(std::memory_order_relaxed) < spill_produced.load(std::memory_order_acquire);
+        if (ring[ring_tail].filled.load(std::memory_order_acquire)) return &ring[ring_tail].data;
+        if (!any_spilled) return nullptr;
+        if (spill_tail_pos == SEGMENT_SIZE) {
+            Segment* drained = spill_tail;
+            spill_tail = spill_tail->next.load(std::memory_order_relaxed);
+            spill_tail_pos = 0;
+            // Keep one drained segment for the producers; free any older one
+            delete spare.exchange(drained, std::memory_order_acq_rel);
+        }
+        spilled = true;
+        return &spill_tail->slots[spill_tail_pos];
+    }
+
+    // Consumer: frees the slot returned by oldest() once its item has been taken
+    void pop(bool spilled) {
+        if (spilled) {
+            spill_tail_pos++;
+            spill_consumed.store(spill_consumed.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        } else {
+            ring[ring_tail].filled.store(false, std::memory_order_release);
+            ring_tail = advance(ring_tail);
+        }
+    }
+
+    // Returns with mutex_consumer held: true once an item is ready, false if the deadline ran out
+    // first. Spins briefly, then parks on not_empty with the consumer lock released, like
+    // LinkedListBuffer::waitUntilFilled.
+    bool waitForItem(std::unique_lock<std::mutex>& lock, const WaitDeadline& deadline) {
+        Backoff backoff;
+        while (!hasItem(std::memory_order_acquire)) {
+            if (deadline.passed(closed)) return false;
+            if (backoff.spin()) continue;
+            uint32_t key = not_empty.prepareWait();
+            if (hasItem(std::memory_order_seq_cst)) {
+                not_empty.cancelWait();
+                break;
+            }
+            if (deadline.passed(closed)) {
+                not_empty.cancelWait();
+                return false;
+            }
+            lock.unlock();
+            occupancy.blockedCount(BufferOp::Consume).fetch_add(1, std::memory_order_relaxed);
+            not_empty.commitWait(key, deadline);
+            occupancy.blockedCount(BufferOp::Consume).fetch_sub(1, std::memory_order_relaxed);
+            lock.lock();
+            backoff.reset();
+        }
+        return true;
+    }
+};
+
+// Segmented Infinite Buffer:-
+// Lock-free unbounded queue whose links are array segments of segment_size slots instead of one
+// node per item, so the pointer overhead is one link per segment and consumers walk contiguous
+// slots. Producers claim a slot with one fetch_add on the segment's enqueue index; the index that
+// runs past the end links (or helps link) the next segment and moves head on. Consumers claim runs
+// of slots with a CAS on the dequeue index, never going past what producers have claimed, then wait
+// for each claimed slot's ready flag (its producer is between the claim and the store).
+//
+// Head and tail segments are protected with hazard pointers (slot 0). The consumer that moves tail
+// past a drained segment retires it, and it is recycled into a pool shared by all buffers of this
+// element type once no thread references it.
+template <typename T>
+class SegmentedBuffer {
+private:
+    struct Slot {
+        SlotStorage<T> data;
+        std::atomic<bool> ready{false};
+    };
+
+    struct Segment {
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> enqueue_index{0};    // Producers claim slots here
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> dequeue_index{0};    // Consumers claim slots here
+        std::atomic<Segment*> next{nullptr};
+        const size_t size;
+        const size_t numa_node;     // Node whose pool the segment returns to
+        std::unique_ptr<Slot[]> slots;
+
+        Segment(size_t slot_count, size_t node) : size(slot_count), numa_node(node), slots(new Slot[slot_count]) {
+            NumaTopology::system().preferNode(slots.get(), slot_count * sizeof(Slot), node);
+        }
+    };
+
+    // Drained segments waiting to be reused; a segment of another size is freed instead. Retired
+    // segments arrive a hazard pointer scan at a time, so the pool has to hold at least one scan's worth.
+    // There is one pool per NUMA node: producers link segments from their own node's pool, and a
+    // drained segment goes back to the pool of the node it was placed on, whichever consumer drained it.
+    struct SegmentPool {
+        static constexpr size_t MAX_SLOTS = 1 << 18;
+        std::mutex mutex;
+        std::vector<Segment*> free;
+
+        ~SegmentPool() {
+            for (Segment* segment : free) delete segment;
+        }
+    };
+
+    const size_t segment_size;
+    alignas(CACHE_LINE_SIZE) std::atomic<Segment*> head; // Producer writes at the head end
+    alignas(CACHE_LINE_SIZE) std::atomic<Segment*> tail; // Consumer reads at the tail end
+    std::atomic<uint64_t> segments_allocated{0};
+    EventCount not_empty;
+    std::atomic<bool> closed{false};    // Set by close()
+
+    BufferStats stats;
+
+    uint64_t start_time;        // CycleClock ticks
+
+public:
+    explicit SegmentedBuffer(size_t requested_segment_size = 256)
+        : segment_size(std::max<size_t>(requested_segment_size, 1)) {
+        Segment* first = allocateSegment();
+        head.store(first);
+        tail.store(first);
+        start_time = CycleClock::now();
+    }
+
+    ~SegmentedBuffer() {
+        Segment* segment = tail.load();
+        while (segment) {
+            Segment* next = segment->next.load();
+            size_t end = std::min(segment->enqueue_index.load(), segment->size);
+            for (size_t i = segment->dequeue_index.load(); i < end; ++i) {
+                if (segment->slots[i].ready.load()) segment->slots[i].data.destroy();
+            }
+            delete segment;
+            segment = next;
+        }
+    }
+
+    size_t segmentSize() const {
+        return segment_size;
+    }
+
+    // Segments that had to be allocated rather than taken from the pool
+    uint64_t segmentsAllocated() const {
+        return segments_allocated.load(std::memory_order_relaxed);
+    }
+
+    void produce(const T& item, int producer_id) {
+        emplace(producer_id, item);
+    }
+
+    void produce(T&& item, int producer_id) {
+        emplace(producer_id, std::move(item));
+    }
+
+    template <typename... Args>
+    void emplace(int producer_id, Args&&... args) {
+        uint64_t request_time = CycleClock::now();
+
+        int64_t logged_value = 0;
+        claimSlots(1, [&](Slot& slot, size_t) {
+            slot.data.construct(std::forward<Args>(args)...);
+            logged_value = logValue(slot.data.get());
+            slot.ready.store(true, std::memory_order_release);
+        });
+        not_empty.notifyOne();
+
+        uint64_t now = CycleClock::now();
+        // As for the lock-free buffer, the wait is the time spent claiming a slot
+        buffer_logger.log(LogRole::Producer, producer_id, logged_value, CycleClock::toNs(now - start_time), CycleClock::toNs(now - request_time));
+        stats.record(BufferOp::Produce, request_time, now, now, CycleClock::now());
+    }
+
+    T consume(int consumer_id) {
+        return *consumeWithin(WaitDeadline::forever(), consumer_id);
+    }
+
+    // Claims the slots for all items with one fetch_add per segment they span
+    void produce_bulk(std::span<const T> items, int producer_id) {
+        if (items.empty()) return;
+        uint64_t request_time = CycleClock::now();
+
+        claimSlots(items.size(), [&](Slot& slot, size_t i) {
+            slot.data.construct(items[i]);
+            slot.ready.store(true, std::memory_order_release);
+        });
+        if (items.size() == 1) not_empty.notifyOne();
+        else not_empty.notifyAll();
+
+        uint64_t now = CycleClock::now();
+        for (const T& item : items)
+            buffer_logger.log(LogRole::Producer, producer_id, logValue(item), CycleClock::toNs(now - start_time), CycleClock::toNs(now - request_time));
+        stats.record(BufferOp::Produce, request_time, now, now, CycleClock::now(), items.size());
+    }
+
+    // Waits for at least one item, then claims up to min(out.size(), max) slots of the tail segment
+    // with a single CAS. Returns the number of items written to out.
+    size_t consume_bulk(std::span<T> out, size_t max, int consumer_id) {
+        size_t limit = std::min(out.size(), max);
+        if (limit == 0) return 0;
+        uint64_t request_time = CycleClock::now();
+
+        size_t count = waitAndTake(limit, [&](Slot& slot, size_t i) { out[i] = slot.data.take(); }, WaitDeadline::forever());
+        uint64_t dequeued_time = CycleClock::now();
+
+        uint64_t now = CycleClock::now();
+        for (size_t i = 0; i < count; ++i)
+            buffer_logger.log(LogRole::Consumer, consumer_id, logValue(out[i]), CycleClock::toNs(now - start_time), CycleClock::toNs(dequeued_time - request_time));
+        stats.record(BufferOp::Consume, request_time, dequeued_time, now, CycleClock::now(), count);
+        return count;
+    }
+
+    // Non-blocking and timed versions of produce() and consume(). Producing never waits here, so
+    // the produce calls only fail once the buffer is closed. The consume calls return nullopt when
+    // the deadline passes without an item, and at once when the buffer is closed and drained.
+    template <typename U>
+    bool try_produce(U&& item, int producer_id) {
+        if (closed.load(std::memory_order_acquire)) return false;
+        emplace(producer_id, std::forward<U>(item));
+        return true;
+    }
+
+    template <typename U, typename Rep, typename Period>
+    bool produce_for(U&& item, const std::chrono::duration<Rep, Period>&, int producer_id) {
+        return try_produce(std::forward<U>(item), producer_id);
+    }
+
+    template <typename U>
+    bool produce_until(U&& item, std::chrono::steady_clock::time_point, int producer_id) {
+        return try_produce(std::forward<U>(item), producer_id);
+    }
+
+    std::optional<T> try_consume(int consumer_id) {
+        return consumeWithin(WaitDeadline::none(), consumer_id);
+    }
+
+    template <typename Rep, typename Period>
+    std::optional<T> consume_for(const std::chrono::duration<Rep, Period>& timeout, int consumer_id) {
+        return consumeWithin(WaitDeadline::after(timeout), consumer_id);
+    }
+
+    std::optional<T> consume_until(std::chrono::steady_clock::time_point deadline, int consumer_id) {
+        return consumeWithin(WaitDeadline::at(deadline), consumer_id);
+    }
+
+    // No more items are coming: the try_/timed produce calls fail from now on, the try_/timed consume
+    // calls still take the items left but stop waiting once the buffer is empty, and every thread
+    // waiting in one of them wakes up. The blocking produce() and consume() are not affected.
+    void close() {
+        closed.store(true, std::memory_order_seq_cst);
+        not_empty.notifyAll();
+    }
+
+    bool isClosed() const {
+        return closed.load(std::memory_order_acquire);
+    }
+
+    std::vector<double> Stats() {
+        std::vector<double> time_stat;
+        time_stat.push_back(stats.summary(BufferOp::Produce).total_seconds);
+        time_stat.push_back(stats.summary(BufferOp::Consume).total_seconds);
+        return time_stat;
+    }
+
+    LatencySummary latency(BufferOp op) {
+        return stats.summary(op);
+    }
+
+private:
+    std::optional<T> consumeWithin(const WaitDeadline& deadline, int consumer_id) {
+        uint64_t request_time = CycleClock::now();
+
+        SlotStorage<T> taken;
+        if (waitAndTake(1, [&](Slot& slot, size_t) { taken.construct(slot.data.take()); }, deadline) == 0) return std::nullopt;
+        uint64_t dequeued_time = CycleClock::now();
+
+        T item = taken.take();
+        uint64_t now = CycleClock::now();
+        buffer_logger.log(LogRole::Consumer, consumer_id, logValue(item), CycleClock::toNs(now - start_time), CycleClock::toNs(dequeued_time - request_time));
+        stats.record(BufferOp::Consume, request_time, dequeued_time, now, CycleClock::now());
+        return item;
+    }
+
+    static SegmentPool& segmentPool(size_t numa_node) {
+        static std::unique_ptr<SegmentPool[]> pools(new SegmentPool[NumaTopology::system().nodeCount()]);
+        return pools[numa_node];
+    }
+
+    Segment* allocateSegment() {
+        size_t node = NumaTopology::system().currentNode();
+        SegmentPool& pool = segmentPool(node);
+        {
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            while (!pool.free.empty()) {
+                Segment* segment = pool.free.back();
+                pool.free.pop_back();
+                if (segment->size == segment_size) return segment;
+                delete segment;
+            }
+        }
+        segments_allocated.fetch_add(1, std::memory_order_relaxed);
+        return new Segment(segment_size, node);
+    }
+
+    // Every slot of a pooled segment has been consumed, so the ready flags are already clear
+    static void recycleSegment(void* ptr) {
+        Segment* segment = static_cast<Segment*>(ptr);
+        segment->enqueue_index.store(0, std::memory_order_relaxed);
+        segment->dequeue_index.store(0, std::memory_order_relaxed);
+        segment->next.store(nullptr, std::memory_order_relaxed);
+        SegmentPool& pool = segmentPool(segment->numa_node);
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        if ((pool.free.size() + 1) * segment->size <= SegmentPool::MAX_SLOTS) pool.free.push_back(segment);
+        else delete segment;
+    }
+
+    // Producer: claims count slots in order, linking new segments as they fill up, and calls
+    // fill(slot, i) for the i-th claimed slot
+    template <typename Fill>
+    void claimSlots(size_t count, Fill fill) {
+        size_t done = 0;
+        while (done < count) {
+            Segment* segment = HazardPointers::protect(0, head);
+            size_t first = segment->enqueue_index.fetch_add(count - done, std::memory_order_relaxed);
+            size_t end = std::min(first + (count - done), segment->size);
+            for (size_t i = first; i < end; ++i) fill(segment->slots[i], done++);
+            if (done == count) break;
+
+            // The segment is full; link the next one if nobody has yet and move head on
+            Segment* next = segment->next.load(std::memory_order_acquire);
+            if (!next) {
+                Segment* fresh = allocateSegment();
+                if (segment->next.compare_exchange_strong(next, fresh, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    next = fresh;
+                } else {
+                    recycleSegment(fresh);
+                }
+            }
+            head.compare_exchange_strong(segment, next, std::memory_order_release, std::memory_order_relaxed);
+        }
+        HazardPointers::clear(0);
+    }
+
+    // Consumer: claims up to limit published-or-claimed slots of the tail segment and passes each to
+    // take(slot, i) once its producer has filled it. Returns 0 if the buffer is empty.
+    template <typename Take>
+    size_t tryTake(size_t limit, Take& take) {
+        while (true) {
+            Segment* segment = HazardPointers::protect(0, tail);
+            size_t first = segment->dequeue_index.load(std::memory_order_acquire);
+            size_t claimed = std::min(segment->enqueue_index.load(std::memory_order_acquire), segment->size);
+
+            if (first < claimed) {
+                size_t count = std::min(limit, claimed - first);
+                if (!segment->dequeue_index.compare_exchange_weak(first, first + count, std::memory_order_acq_rel, std::memory_order_relaxed))
+                    continue;
+                for (size_t i = 0; i < count; ++i) {
+                    Slot& slot = segment->slots[first + i];
+                    Backoff backoff;
+                    while (!slot.ready.load(std::memory_order_acquire)) {
+                        if (!backoff.spin()) std::this_thread::yield();
+                    }
+                    take(slot, i);
+                    slot.ready.store(false, std::memory_order_relaxed);
+                }
+                HazardPointers::clear(0);
+                return count;
+            }
+            if (first < segment->size) break;          // Nothing claimed past first yet: empty
+
+            // Every slot has been claimed; move on to the next segment once it is linked
+            Segment* next = segment->next.load(std::memory_order_acquire);
+            if (!next) break;
+            // Never let tail overtake head, so that a retired segment is never reachable from head
+            Segment* lagging = segment;
+            head.compare_exchange_strong(lagging, next, std::memory_order_release, std::memory_order_relaxed);
+            if (tail.compare_exchange_strong(segment, next, std::memory_order_acq_rel, std::memory_order_relaxed))
+                HazardPointers::retire(segment, &recycleSegment);
+        }
+        HazardPointers::clear(0);
+        return 0;
+    }
+
+    // Consumer: true if an item is (or is about to be) available; seq_cst for the event count handshake
+    bool hasItems() {
+        Segment* segment = HazardPointers::protect(0, tail);
+        size_t first = segment->dequeue_index.load(std::memory_order_seq_cst);
+        bool ready = first < std::min(segment->enqueue_index.load(std::memory_order_seq_cst), segment->size) ||
+                     (first >= segment->size && segment->next.load(std::memory_order_seq_cst) != nullptr);
+        HazardPointers::clear(0);
+        return ready;
+    }
+
+    // Spins briefly, then parks on not_empty until tryTake() gets at least one item. Returns 0 if
+    // the deadline runs out first.
+    template <typename Take>
+    size_t waitAndTake(size_t limit, Take take, const WaitDeadline& deadline) {
+        Backoff backoff;
+        while (true) {
+            size_t count = tryTake(limit, take);
+            if (count > 0) return count;
+            if (deadline.passed(closed)) return 0;
+            if (backoff.spin()) continue;
+            uint32_t key = not_empty.prepareWait();
+            if (hasItems() || deadline.passed(closed)) not_empty.cancelWait();
+            else not_empty.commitWait(key, deadline);
+            backoff.reset();
+        }
+    }
+};
+
+// Priority Infinite Buffer:-
+// K FIFO lanes, lane 0 the most urgent, so that urgent items do not queue behind bulk traffic. Each
+// lane is an intrusive multi-producer list with a dummy node: a producer links its node with one
+// exchange on the lane's head and one store to the previous node, so producers wait neither for each
+// other nor for a lock. Consumers share one consumer lock, and under it every item they take is chosen
+// by the lane policy:
+//   StrictPriority      the most urgent lane that has an item. With a starvation budget B > 0, a lane
+//                       that was passed over B times while it had items is served next.
+//   WeightedRoundRobin  the lanes take turns, lane i serving up to weights[i] items per turn.
+// Items of one lane stay in FIFO order. produce()/emplace(), produce_bulk() and the try/timed produce
+// calls use the last, least urgent lane; produce_to(), emplace_to() and produce_bulk_to() pick one. When
+// no lane has an item, consumers park on an event count as in ShardedBuffer.
+enum class LanePolicy { StrictPriority, WeightedRoundRobin };
+
+struct LaneOptions {
+    LanePolicy policy = LanePolicy::StrictPriority;
+    std::vector<uint32_t> weights;      // WeightedRoundRobin: items per turn of each lane; missing or 0 means 1
+    uint32_t starvation_budget = 0;     // StrictPriority: 0 never serves a less urgent lane early
+};
+
+template <typename T>
+class PriorityBuffer {
+public:
+    // Per-lane counters; wait is the time from an item being linked in to a consumer taking it
+    struct LaneStats {
+        uint64_t produced = 0;
+        uint64_t consumed = 0;
+        int64_t depth = 0;
+        int64_t peak_depth = 0;
+        double wait_p50_ns = 0;
+        double wait_p99_ns = 0;
+        double wait_p999_ns = 0;
+    };
+
+private:
+    struct LaneNode {
+        SlotStorage<T> data;
+        std::atomic<LaneNode*> next{nullptr};
+        uint64_t linked_time = 0;       // CycleClock ticks
+    };
+
+    struct alignas(CACHE_LINE_SIZE) Lane {
+        std::atomic<LaneNode*> head;                // Producers swap their node in at the head end
+
+        alignas(CACHE_LINE_SIZE) LaneNode* tail;    // Dummy node; consumers take tail->next under consumer_lock
+        uint32_t weight = 1;
+        uint32_t passed_over = 0;                   // StrictPriority: picks that skipped this lane while it had items
+        std::atomic<uint64_t> consumed{0};          // written under consumer_lock
+        LatencyHistogram wait;                      // written under consumer_lock
+
+        // Depth is the handshake with waiting consumers, so it is changed with seq_cst RMWs
+        alignas(CACHE_LINE_SIZE) std::atomic<int64_t> depth{0};
+        std::atomic<int64_t> peak_depth{0};
+        std::atomic<uint64_t> produced{0};
+    };
+
+    std::vector<std::unique_ptr<Lane>> lanes;
+    const LanePolicy policy;
+    const uint32_t starvation_budget;
+
+    std::mutex consumer_lock;
+    size_t turn_lane;               // WeightedRoundRobin, under consumer_lock: lane whose turn it is
+    uint32_t turn_left = 0;         // and how many more items it may take in this turn
+
+    EventCount not_empty;
+    std::atomic<bool> closed{false};    // Set by close()
+
+    BufferStats stats;
+
+    uint64_t start_time;        // CycleClock ticks
+
+public:
+    explicit PriorityBuffer(size_t lane_count, const LaneOptions& options = {})
+        : policy(options.policy), starvation_budget(options.starvation_budget) {
+        lane_count = std::max<size_t>(lane_count, 1);
+        for (size_t i = 0; i < lane_count; ++i) {
+            auto lane = std::make_unique<Lane>();
+            lane->tail = NodePool<LaneNode>::allocate();    // Dummy node
+            lane->head.store(lane->tail, std::memory_order_relaxed);
+            if (i < options.weights.size()) lane->weight = std::max<uint32_t>(options.weights[i], 1);
+            lanes.push_back(std::move(lane));
+        }
+        turn_lane = lanes.size() - 1;      // so that lane 0 has the first turn
+        start_time = CycleClock::now();
+    }
+
+    ~PriorityBuffer() {
+        for (auto& lane : lanes) {
+            LaneNode* node = lane->tail;
+            bool is_dummy = true;
+            while (node) {
+                LaneNode* next = node->next.load(std::memory_order_relaxed);
+                if (!is_dummy) node->data.destroy();
+                NodePool<LaneNode>::release(node);
+                node = next;
+                is_dummy = false;
+            }
+        }
+    }
+
+    size_t laneCount() const {
+        return lanes.size();
+    }
+
+    LanePolicy lanePolicy() const {
+        return policy;
+    }
+
+    // Slabs the node pool of the lanes' node type had to allocate
+    static size_t slabCount() {
+        return NodePool<LaneNode>::slabCount();
+    }
+
+    LaneStats laneStats(size_t index) const {
+        const Lane& lane = *lanes[index];
+        LaneStats out;
+        out.produced = lane.produced.load(std::memory_order_relaxed);
+        out.consumed = lane.consumed.load(std::memory_order_relaxed);
+        out.depth = lane.depth.load(std::memory_order_relaxed);
+        out.peak_depth = lane.peak_depth.load(std::memory_order_relaxed);
+        std::vector<uint64_t> counts;
+        lane.wait.addTo(counts);
+        double ns_per_tick = CycleClock::nsPerTick();
+        out.wait_p50_ns = LatencyHistogram::percentile(counts, 0.50) * ns_per_tick;
+        out.wait_p99_ns = LatencyHistogram::percentile(counts, 0.99) * ns_per_tick;
+        out.wait_p999_ns = LatencyHistogram::percentile(counts, 0.999) * ns_per_tick;
+        return out;
+    }
+
+    void produce(const T& item, int producer_id) {
+        emplace_to(lanes.size() - 1, producer_id, item);
+    }
+
+    void produce(T&& item, int producer_id) {
+        emplace_to(lanes.size() - 1, producer_id, std::move(item));
+    }
+
+    template <typename... Args>
+    void emplace(int producer_id, Args&&... args) {
+        emplace_to(lanes.size() - 1, producer_id, std::forward<Args>(args)...);
+    }
+
+    // lane is clamped to the last lane
+    template <typename U>
+    void produce_to(size_t lane, U&& item, int producer_id) {
+        emplace_to(lane, producer_id, std::forward<U>(item));
+    }
+
+    template <typename... Args>
+    void emplace_to(size_t lane_index, int producer_id, Args&&... args) {
+        uint64_t request_time = CycleClock::now();
+        Lane& lane = laneAt(lane_index);
+
+        LaneNode* node = NodePool<LaneNode>::allocate();
+        node->data.construct(std::forward<Args>(args)...);
+        int64_t logged_value = logValue(node->data.get());
+        node->linked_time = request_time;
+        link(lane, node, node, 1);
+
+        uint64_t now = CycleClock::now();
+        not_empty.notifyOne();
+
+        // As for the lock-free buffer, there is no lock to wait for; the wait is the time spent linking
+        buffer_logger.log(LogRole::Producer, producer_id, logged_value, CycleClock::toNs(now - start_time), CycleClock::toNs(now - request_time));
+        stats.record(BufferOp::Produce, request_time, now, now, CycleClock::now());
+    }
+
+    T consume(int consumer_id) {
+        return *consumeWithin(WaitDeadline::forever(), consumer_id);
+    }
+
+    void produce_bulk(std::span<const T> items, int producer_id) {
+        produce_bulk_to(lanes.size() - 1, items, producer_id);
+    }
+
+    // Chains the items privately, then links the whole chain with one exchange
+    void produce_bulk_to(size_t lane_index, std::span<const T> items, int producer_id) {
+        if (items.empty()) return;
+        uint64_t request_time = CycleClock::now();
+        Lane& lane = laneAt(lane_index);
+
+        LaneNode* chain_first = nullptr;
+        LaneNode* chain_last = nullptr;
+        for (const T& item : items) {
+            LaneNode* node = NodePool<LaneNode>::allocate();
+            node->data.construct(item);
+            node->linked_time = request_time;
+            if (chain_last) chain_last->next.store(node, std::memory_order_relaxed);
+            else chain_first = node;
+            chain_last = node;
+        }
+        link(lane, chain_first, chain_last, static_cast<int64_t>(items.size()));
+
+        uint64_t now = CycleClock::now();
+        if (items.size() == 1) not_empty.notifyOne();
+        else not_empty.notifyAll();
+
+        for (const T& item : items)
+            buffer_logger.log(LogRole::Producer, producer_id, logValue(item), CycleClock::toNs(now - start_time), CycleClock::toNs(now - request_time));
+        stats.record(BufferOp::Produce, request_time, now, now, CycleClock::now(), items.size());
+    }
+
+    // Waits for at least one item, then takes up to min(out.size(), max) items, each lane chosen by
+    // the policy. Returns the number of items written to out.
+    size_t consume_bulk(std::span<T> out, size_t max, int consumer_id) {
+        size_t limit = std::min(out.size(), max);
+        if (limit == 0) return 0;
+        uint64_t request_time = CycleClock::now();
+        uint64_t acquired_time = 0;
+
+        size_t count = 0;
+        waitAndTake(limit, [&](LaneNode* node) {
+            out[count++] = node->data.take();
+        }, acquired_time, WaitDeadline::forever());
+
+        uint64_t released_time = CycleClock::now();
+        for (size_t i = 0; i < count; ++i)
+            buffer_logger.log(LogRole::Consumer, consumer_id, logValue(out[i]), CycleClock::toNs(released_time - start_time), CycleClock::toNs(acquired_time - request_time));
+        stats.record(BufferOp::Consume, request_time, acquired_time, released_time, CycleClock::now(), count);
+        return count;
+    }
+
+    // Non-blocking and timed versions of produce() and consume(), on the last lane. Producing never
+    // waits here, so the produce calls only fail once the buffer is closed. The consume calls return
+    // nullopt when the deadline passes without an item, and at once when the buffer is closed and drained.
+    template <typename U>
+    bool try_produce(U&& item, int producer_id) {
+        if (closed.load(std::memory_order_acquire)) return false;
+        emplace(producer_id, std::forward<U>(item));
+        return true;
+    }
+
+    template <typename U, typename Rep, typename Period>
+    bool produce_for(U&& item, const std::chrono::duration<Rep, Period>&, int producer_id) {
+        return try_produce(std::forward<U>(item), producer_id);
+    }
+
+    template <typename U>
+    bool produce_until(U&& item, std::chrono::steady_clock::time_point, int producer_id) {
+        return try_produce(std::forward<U>(item), producer_id);
+    }
+
+    std::optional<T> try_consume(int consumer_id) {
+        return consumeWithin(WaitDeadline::none(), consumer_id);
+    }
+
+    template <typename Rep, typename Period>
+    std::optional<T> consume_for(const std::chrono::duration<Rep, Period>& timeout, int consumer_id) {
+        return consumeWithin(WaitDeadline::after(timeout), consumer_id);
+    }
+
+    std::optional<T> consume_until(std::chrono::steady_clock::time_point deadline, int consumer_id) {
+        return consumeWithin(WaitDeadline::at(deadline), consumer_id);
+    }
+
+    // No more items are coming: the try_/timed produce calls fail from now on, the try_/timed consume
+    // calls still take the items left but stop waiting once the buffer is empty, and every thread
+    // waiting in one of them wakes up. The blocking produce() and consume() are not affected.
+    void close() {
+        closed.store(true, std::memory_order_seq_cst);
+        not_empty.notifyAll();
+    }
+
+    bool isClosed() const {
+        return closed.load(std::memory_order_acquire);
+    }
+
+    std::vector<double> Stats() {
+        std::vector<double> time_stat;
+        time_stat.push_back(stats.summary(BufferOp::Produce).total_seconds);
+        time_stat.push_back(stats.summary(BufferOp::Consume).total_seconds);
+        return time_stat;
+    }
+
+    LatencySummary latency(BufferOp op) {
+        return stats.summary(op);
+    }
+
+private:
+    std::optional<T> consumeWithin(const WaitDeadline& deadline, int consumer_id) {
+        uint64_t request_time = CycleClock::now();
+        uint64_t acquired_time = 0;
+
+        // Takes exactly one item; it passes through a SlotStorage so that T needs no default constructor
+        SlotStorage<T> taken;
+        size_t count = waitAndTake(1, [&](LaneNode* node) {
+            taken.construct(node->data.take());
+        }, acquired_time, deadline);
+        if (count == 0) return std::nullopt;
+
+        T item = taken.take();
+        uint64_t now = CycleClock::now();
+        buffer_logger.log(LogRole::Consumer, consumer_id, logValue(item), CycleClock::toNs(now - start_time), CycleClock::toNs(acquired_time - request_time));
+        stats.record(BufferOp::Consume, request_time, acquired_time, now, CycleClock::now());
+        return item;
+    }
+
+    Lane& laneAt(size_t index) {
+        return *lanes[std::min(index, lanes.size() - 1)];
+    }
+
+    // Appends the chain first..last of count items. The exchange orders the lane's producers; consumers
+    // see the chain once the previous node points to it, and the depth is counted after that.
+    void link(Lane& lane, LaneNode* first, LaneNode* last, int64_t count) {
+        LaneNode* prev = lane.head.exchange(last, std::memory_order_acq_rel);
+        prev->next.store(first, std::memory_order_release);
+        lane.produced.fetch_add(static_cast<uint64_t>(count), std::memory_order_relaxed);
+        int64_t depth = lane.depth.fetch_add(count, std::memory_order_seq_cst) + count;
+        int64_t peak = lane.peak_depth.load(std::memory_order_relaxed);
+        while (depth > peak && !lane.peak_depth.compare_exchange_weak(peak, depth, std::memory_order_relaxed)) {}
+    }
+
+    // Caller holds consumer_lock
+    static bool ready(const Lane& lane) {
+        return lane.tail->next.load(std::memory_order_acquire) != nullptr;
+    }
+
+    // Caller holds consumer_lock. The lane to take the next item from, or lanes.size() if none has one.
+    size_t pickLane() {
+        size_t n = lanes.size();
+        if (policy == LanePolicy::WeightedRoundRobin) {
+            if (turn_left > 0 && ready(*lanes[turn_lane])) {
+                turn_left--;
+                return turn_lane;
+            }
+            // The turn passes on; i == n gives the current lane a new turn if it is the only one with items
+            for (size_t i = 1; i <= n; ++i) {
+                size_t l = (turn_lane + i) % n;
+                if (!ready(*lanes[l])) continue;
+                turn_lane = l;
+                turn_left = lanes[l]->weight - 1;
+                return l;
+            }
+            return n;
+        }
+
+        if (starvation_budget == 0) {
+            for (size_t l = 0; l < n; ++l) {
+                if (ready(*lanes[l])) return l;
+            }
+            return n;
+        }
+
+        // Every lane with items that is not served this time has been passed over once more; the most
+        // urgent one that has used up its budget goes first
+        size_t first = n;
+        size_t starving = n;
+        for (size_t l = 0; l < n; ++l) {
+            Lane& lane = *lanes[l];
+            if (!ready(lane)) {
+                lane.passed_over = 0;
+                continue;
+            }
+            if (first == n) first = l;
+            else if (starving == n && lane.passed_over >= starvation_budget) starving = l;
+            lane.passed_over++;
+        }
+        size_t chosen = starving < n ? starving : first;
+        if (chosen < n) lanes[chosen]->passed_over = 0;
+        return chosen;
+    }
+
+    // Takes up to limit items, picking the lane for each, and passes each node to take(node).
+    // Returns the number of items taken.
+    template <typename Take>
+    size_t tryTake(size_t limit, Take& take, uint64_t& acquired_time) {
+        std::lock_guard<std::mutex> lock(consumer_lock);
+        acquired_time = CycleClock::now();
+        size_t count = 0;
+        while (count < limit) {
+            size_t l = pickLane();
+            if (l == lanes.size()) break;
+            Lane& lane = *lanes[l];
+            LaneNode* dummy = lane.tail;
+            LaneNode* node = dummy->next.load(std::memory_order_acquire);
+            take(node);
+#if BUFFER_INSTRUMENTATION
+            lane.wait.record(CycleClock::now() - node->linked_time);
+#endif
+            lane.tail = node;      // The consumed node is the new dummy
+            lane.depth.fetch_sub(1, std::memory_order_relaxed);
+            lane.consumed.store(lane.consumed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            NodePool<LaneNode>::release(dummy);
+            count++;
+        }
+        return count;
+    }
+
+    bool anyItems() const {
+        for (auto& lane : lanes) {
+            if (lane->depth.load(std::memory_order_seq_cst) > 0) return true;
+        }
+        return false;
+    }
+
+    // Spins briefly, then parks on not_empty until tryTake() gets at least one item. Returns 0 if
+    // the deadline runs out first.
+    template <typename Take>
+    size_t waitAndTake(size_t limit, Take take, uint64_t& acquired_time, const WaitDeadline& deadline) {
+        Backoff backoff;
+        while (true) {
+            size_t count = tryTake(limit, take, acquired_time);
+            if (count > 0) return count;
+            if (deadline.passed(closed)) return 0;
+            if (backoff.spin()) continue;
+
+            uint32_t key = not_empty.prepareWait();
+            if (anyItems() || deadline.passed(closed)) {
+                // A counted item can still be unreachable while an earlier producer of its lane has
+                // swapped in its node but not linked it yet; give that producer a chance to finish
+                not_empty.cancelWait();
+                std::this_thread::yield();
+            } else {
+                not_empty.commitWait(key, deadline);
+            }
+            backoff.reset();
+        }
+    }
+};
+
+} // namespace infinite_buffer
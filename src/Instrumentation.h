@@ -0,0 +1,374 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Deadline.h"
+#include "Platform.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <x86intrin.h>
+#define BUFFER_HAVE_TSC 1
+#else
+#define BUFFER_HAVE_TSC 0
+#endif
+
+// Hot-path instrumentation for the buffers.
+//
+// Every produce/consume records three latencies into per-thread log-linear (HDR-style) histograms:
+//   lock wait        - from the request until the thread may touch the buffer (lock, CAS retries, waiting for space/items)
+//   critical section - from then until the buffer is released again
+//   end to end       - the whole call, including logging and notification
+// Timestamps come from the TSC where available, calibrated once against steady_clock. Counters are
+// written only by their owning thread with relaxed atomics, so recording takes no lock.
+//
+// Build with -DBUFFER_INSTRUMENTATION=0 to compile the recording out: no histograms, totals or contention
+// counters are kept and their reports say so. CycleClock keeps running, since the logs, the analysis and
+// the traces take their timestamps and wait times from it.
+#ifndef BUFFER_INSTRUMENTATION
+#define BUFFER_INSTRUMENTATION 1
+#endif
+
+class CycleClock {
+public:
+    static uint64_t now() {
+#if BUFFER_HAVE_TSC
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    // Nanoseconds per tick, measured against steady_clock the first time it is needed.
+    static double nsPerTick() {
+        static const double ns_per_tick = calibrate();
+        return ns_per_tick;
+    }
+
+    static int64_t toNs(uint64_t ticks) {
+        return static_cast<int64_t>(static_cast<double>(ticks) * nsPerTick());
+    }
+
+private:
+    static double calibrate() {
+#if BUFFER_HAVE_TSC
+        auto wall_start = std::chrono::steady_clock::now();
+        uint64_t tsc_start = __rdtsc();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        auto wall_end = std::chrono::steady_clock::now();
+        uint64_t tsc_end = __rdtsc();
+        double ns = std::chrono::duration<double, std::nano>(wall_end - wall_start).count();
+        return ns / static_cast<double>(tsc_end - tsc_start);
+#else
+        return std::chrono::steady_clock::period::num * 1e9 / std::chrono::steady_clock::period::den;
+#endif
+    }
+};
+
+// Log-linear histogram over tick counts: values below 2^SUB_BITS are exact, larger values fall into
+// 2^SUB_BITS sub-buckets per power of two (about 3% relative error).
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 5;
+    static constexpr uint64_t SUB_COUNT = 1ull << SUB_BITS;
+    static constexpr int MAX_MAGNITUDE = 48;      // values are clamped below 2^48 ticks
+    static constexpr size_t BUCKETS = (MAX_MAGNITUDE - SUB_BITS + 2) * SUB_COUNT;
+
+    // Only the owning thread records, so a relaxed load/store pair is enough
+    void record(uint64_t ticks) {
+        std::atomic<uint64_t>& b = buckets[bucketFor(ticks)];
+        b.store(b.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void addTo(std::vector<uint64_t>& totals) const {
+        totals.resize(BUCKETS);
+        for (size_t i = 0; i < BUCKETS; ++i) totals[i] += buckets[i].load(std::memory_order_relaxed);
+    }
+
+    static size_t bucketFor(uint64_t v) {
+        if (v >= (1ull << MAX_MAGNITUDE)) v = (1ull << MAX_MAGNITUDE) - 1;
+        int msb = 63 - countLeadingZeros(v | 1);
+        int shift = msb > SUB_BITS ? msb - SUB_BITS : 0;
+        return static_cast<size_t>(shift) * SUB_COUNT + static_cast<size_t>(v >> shift);
+    }
+
+    // Midpoint of the values that map to a bucket
+    static double bucketValue(size_t index) {
+        if (index < 2 * SUB_COUNT) return static_cast<double>(index);
+        size_t shift = index / SUB_COUNT - 1;
+        uint64_t low = (index - shift * SUB_COUNT) << shift;
+        return static_cast<double>(low) + static_cast<double>(1ull << shift) / 2;
+    }
+
+    // Value (in ticks) below which fraction q of the samples in the aggregated counts fall
+    static double percentile(const std::vector<uint64_t>& counts, double q) {
+        uint64_t total = 0;
+        for (uint64_t c : counts) total += c;
+        if (total == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(total - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            seen += counts[i];
+            if (seen >= rank) return bucketValue(i);
+        }
+        return bucketValue(counts.size() - 1);
+    }
+
+private:
+    std::atomic<uint64_t> buckets[BUCKETS] = {};
+
+    static int countLeadingZeros(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_clzll(v);
+#else
+        int n = 0;
+        for (uint64_t bit = 1ull << 63; bit && !(v & bit); bit >>= 1) n++;
+        return n;
+#endif
+    }
+};
+
+// One Record per thread that used the owning object, so that each thread records into its own
+// without a lock. A small per-thread cache of (owner -> record) makes the lookup a few compares;
+// it is keyed by a unique id rather than the owner's address, which a later owner may reuse. The
+// cache only speeds the lookup up: a thread that uses more owners than it holds finds its record
+// again in by_thread, under the mutex, and a record is only ever created once per thread and owner.
+template <typename Record>
+class ThreadRecords {
+public:
+    Record& local() {
+        thread_local LocalCache cache;
+        for (int i = 0; i < LocalCache::ENTRIES; ++i) {
+            if (cache.owner[i] == id) return *cache.record[i];
+        }
+        Record* record;
+        {
+            std::lock_guard<std::mutex> lock(records_mutex);
+            Record*& mine = by_thread[threadSerial()];
+            if (!mine) {
+                records.push_back(std::make_unique<Record>());
+                mine = records.back().get();
+            }
+            record = mine;
+        }
+        int slot = cache.next;
+        cache.next = (cache.next + 1) % LocalCache::ENTRIES;
+        cache.owner[slot] = id;
+        cache.record[slot] = record;
+        return *record;
+    }
+
+    // Calls f(record) for every thread's record, in the order the threads first recorded
+    template <typename F>
+    void forEach(F&& f) {
+        std::lock_guard<std::mutex> lock(records_mutex);
+        for (auto& r : records) f(static_cast<const Record&>(*r));
+    }
+
+private:
+    struct LocalCache {
+        static constexpr int ENTRIES = 4;
+        uint64_t owner[ENTRIES] = {};
+        Record* record[ENTRIES] = {};
+        int next = 0;
+    };
+
+    inline static std::atomic<uint64_t> next_id{1};
+    const uint64_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+
+    std::mutex records_mutex;
+    std::vector<std::unique_ptr<Record>> records;
+    std::unordered_map<uint64_t, Record*> by_thread;    // thread serial -> its record in records
+
+    // Unique per thread for the life of the process, unlike std::thread::id, which a later thread reuses
+    static uint64_t threadSerial() {
+        static std::atomic<uint64_t> next_serial{1};
+        thread_local uint64_t serial = next_serial.fetch_add(1, std::memory_order_relaxed);
+        return serial;
+    }
+};
+
+enum class BufferOp { Produce = 0, Consume = 1 };
+
+// Aggregated view of one operation type, in nanoseconds
+struct LatencySummary {
+    uint64_t operations = 0;
+    uint64_t items = 0;
+    double total_seconds = 0;
+    double p50_ns[3] = {};      // indexed by LatencyKind
+    double p99_ns[3] = {};
+    double p999_ns[3] = {};
+};
+
+enum LatencyKind { LOCK_WAIT = 0, CRITICAL_SECTION = 1, END_TO_END = 2 };
+
+// Per-buffer statistics made of one record per thread that used the buffer.
+class BufferStats {
+public:
+    BufferStats() {
+        CycleClock::nsPerTick();    // Calibrate up front rather than inside the first operation
+    }
+
+    // Records one call that moved `items` items. request/acquired/released/end are CycleClock ticks.
+    void record(BufferOp op, uint64_t request, uint64_t acquired, uint64_t released, uint64_t end, uint64_t items = 1) {
+#if BUFFER_INSTRUMENTATION
+        OpCounters& c = threads.local().ops[static_cast<int>(op)];
+        bump(c.operations, 1);
+        bump(c.items, items);
+        bump(c.total_ticks, end - request);
+        c.latency[LOCK_WAIT].record(acquired - request);
+        c.latency[CRITICAL_SECTION].record(released - acquired);
+        c.latency[END_TO_END].record(end - request);
+#else
+        (void)op; (void)request; (void)acquired; (void)released; (void)end; (void)items;
+#endif
+    }
+
+    // Safe to call while other threads are still recording; the result is then approximate.
+    LatencySummary summary(BufferOp op) {
+        LatencySummary s;
+        std::vector<uint64_t> counts[3];
+        uint64_t total_ticks = 0;
+        threads.forEach([&](const ThreadRecord& t) {
+            const OpCounters& c = t.ops[static_cast<int>(op)];
+            s.operations += c.operations.load(std::memory_order_relaxed);
+            s.items += c.items.load(std::memory_order_relaxed);
+            total_ticks += c.total_ticks.load(std::memory_order_relaxed);
+            for (int k = 0; k < 3; ++k) c.latency[k].addTo(counts[k]);
+        });
+        double ns_per_tick = CycleClock::nsPerTick();
+        s.total_seconds = static_cast<double>(total_ticks) * ns_per_tick / 1e9;
+        for (int k = 0; k < 3; ++k) {
+            s.p50_ns[k] = LatencyHistogram::percentile(counts[k], 0.50) * ns_per_tick;
+            s.p99_ns[k] = LatencyHistogram::percentile(counts[k], 0.99) * ns_per_tick;
+            s.p999_ns[k] = LatencyHistogram::percentile(counts[k], 0.999) * ns_per_tick;
+        }
+        return s;
+    }
+
+private:
+    struct OpCounters {
+        std::atomic<uint64_t> operations{0};
+        std::atomic<uint64_t> items{0};
+        std::atomic<uint64_t> total_ticks{0};
+        LatencyHistogram latency[3];
+    };
+
+    struct alignas(CACHE_LINE_SIZE) ThreadRecord {
+        OpCounters ops[2];
+    };
+
+    ThreadRecords<ThreadRecord> threads;
+
+    static void bump(std::atomic<uint64_t>& counter, uint64_t by) {
+        counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+};
+
+// Point-in-time view of a buffer, readable while it is in use (see LinkedListBuffer::snapshot).
+struct BufferSnapshot {
+    uint64_t enqueued = 0;
+    uint64_t dequeued = 0;
+    uint64_t depth = 0;                 // enqueued - dequeued
+    uint64_t high_watermark = 0;        // largest depth seen by a producer
+    int blocked_producers = 0;          // threads currently asleep waiting for space
+    int blocked_consumers = 0;          // threads currently asleep waiting for an item
+    uint64_t dropped = 0;               // items a full finite buffer's overflow policy turned away
+    LatencySummary produce;             // per-thread histograms: lock wait, critical section, end to end
+    LatencySummary consume;
+};
+
+// Live occupancy counters. Each count has one writer at a time: enqueued only moves while the
+// producer side is held and dequeued only while the consumer side is held, so updating them is a
+// relaxed load and store rather than a contended read-modify-write. A producer bumps enqueued
+// before it publishes the items and a consumer bumps dequeued after it has seen them, so a reader
+// never sees more dequeued than enqueued. The blocked counts change only around a sleep.
+class OccupancyCounters {
+public:
+    // Producer side, before the items become visible to consumers
+    void enqueued(uint64_t count) {
+        enqueue_count.store(enqueue_count.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    }
+
+    // Producer side, once the items are visible
+    void published() {
+        uint64_t depth = enqueue_count.load(std::memory_order_relaxed) - dequeue_count.load(std::memory_order_relaxed);
+        if (depth > high_watermark.load(std::memory_order_relaxed)) high_watermark.store(depth, std::memory_order_relaxed);
+    }
+
+    // Consumer side, after the items have been taken
+    void dequeued(uint64_t count) {
+        dequeue_count.store(dequeue_count.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    // cv.wait(lock, ready), counting the thread as blocked on `side` while it sleeps
+    template <typename Predicate>
+    void waitBlocked(BufferOp side, std::condition_variable& cv, std::unique_lock<std::mutex>& lock, Predicate ready) {
+        if (ready()) return;
+        std::atomic<int>& blocked = blockedCount(side);
+        blocked.fetch_add(1, std::memory_order_relaxed);
+        cv.wait(lock, ready);
+        blocked.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Same, but waking up by the deadline at the latest; returns ready()
+    template <typename Predicate>
+    bool waitBlocked(BufferOp side, std::condition_variable& cv, std::unique_lock<std::mutex>& lock,
+                     const WaitDeadline& deadline, Predicate ready) {
+        if (deadline.unbounded()) {
+            waitBlocked(side, cv, lock, ready);
+            return true;
+        }
+        if (ready()) return true;
+        std::atomic<int>& blocked = blockedCount(side);
+        blocked.fetch_add(1, std::memory_order_relaxed);
+        bool ok = cv.wait_until(lock, deadline.time(), ready);
+        blocked.fetch_sub(1, std::memory_order_relaxed);
+        return ok;
+    }
+
+    std::atomic<int>& blockedCount(BufferOp side) {
+        return side == BufferOp::Produce ? blocked_producers : blocked_consumers;
+    }
+
+    BufferSnapshot snapshot() const {
+        BufferSnapshot s;
+        s.dequeued = dequeue_count.load(std::memory_order_acquire);
+        s.enqueued = enqueue_count.load(std::memory_order_relaxed);
+        s.depth = s.enqueued - s.dequeued;
+        s.high_watermark = std::max(high_watermark.load(std::memory_order_relaxed), s.depth);
+        s.blocked_producers = blocked_producers.load(std::memory_order_relaxed);
+        s.blocked_consumers = blocked_consumers.load(std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> enqueue_count{0};
+    std::atomic<uint64_t> high_watermark{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> dequeue_count{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<int> blocked_producers{0};
+    std::atomic<int> blocked_consumers{0};
+};
+
+// Prints the percentile table of one operation type for the log analysis reports.
+inline void printLatencySummary(std::ostream& out, const char* label, const LatencySummary& s) {
+#if BUFFER_INSTRUMENTATION
+    static const char* kinds[3] = {"Lock Wait       ", "Critical Section", "End to End      "};
+    out << label << " (" << s.operations << " calls, " << s.items << " items; p50 / p99 / p99.9)\n";
+    for (int k = 0; k < 3; ++k) {
+        out << "  " << kinds[k] << "         : " << s.p50_ns[k] / 1000 << " / " << s.p99_ns[k] / 1000
+            << " / " << s.p999_ns[k] / 1000 << " us\n";
+    }
+#else
+    (void)s;
+    out << label << " : instrumentation disabled (built with BUFFER_INSTRUMENTATION=0)\n";
+#endif
+}
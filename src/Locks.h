@@ -0,0 +1,254 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include "Deadline.h"
+#include "Instrumentation.h"
+#include "Platform.h"
+
+// How long one acquisition of a lock (or one wait for a condition) took, split into spinning and
+// parked time, for the contention profile (Contention.h). The waiting side calls spinning() each
+// time it finds it has to wait, parking() and unparked() around every sleep and done() once it is
+// through. An acquisition that never had to wait stays uncontended and never reads the clock, and
+// with BUFFER_INSTRUMENTATION=0 no wait does.
+struct LockWait {
+    bool contended = false;
+    uint32_t parks = 0;
+    uint64_t spin_ticks = 0;
+    uint64_t park_ticks = 0;
+    uint64_t last_park = 0;     // CycleClock ticks when the last sleep began
+    uint64_t woke_at = 0;       // and when it ended
+    uint64_t mark = 0;
+
+    void spinning() {
+        if (contended) return;
+        contended = true;
+        mark = ticks();
+    }
+
+    void parking() {
+        uint64_t now = ticks();
+        spin_ticks += now - mark;
+        last_park = mark = now;
+    }
+
+    void unparked() {
+        uint64_t now = ticks();
+        park_ticks += now - mark;
+        parks++;
+        woke_at = mark = now;
+    }
+
+    void done() {
+        if (contended) spin_ticks += ticks() - mark;
+    }
+
+    static uint64_t ticks() {
+        return BUFFER_INSTRUMENTATION ? CycleClock::now() : 0;
+    }
+};
+
+// Custom made ticket lock
+
+// This lock helps in introducing fairness in the synchronization process as
+// each producer/consumer is given a ticket value and is served in FIFO order.
+//
+// The thread whose ticket is next spins briefly with pause and exponential backoff; everybody
+// further back in the line (and the next thread once its spin budget is used up) parks on
+// now_serving with atomic::wait, so waiting producers cost no CPU. unlock() only issues the
+// wake-up syscall when somebody is actually parked. lock(&wait) also measures the wait (see LockWait).
+class TicketLock {
+    private:
+        alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> next_ticket{0};
+        alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> now_serving{0};
+        std::atomic<uint32_t> parked{0};
+
+    public:
+        void lock(LockWait* wait = nullptr) {
+            uint32_t my_ticket = next_ticket.fetch_add(1, std::memory_order_relaxed);
+            Backoff backoff;
+            while (true) {
+                uint32_t serving = now_serving.load(std::memory_order_acquire);
+                if (serving == my_ticket) break;
+                if (wait) wait->spinning();
+                if (my_ticket - serving == 1 && backoff.spin()) continue;
+
+                // The parked count and now_serving form a Dekker-style handshake with unlock(),
+                // which is the one place that needs seq_cst
+                if (wait) wait->parking();
+                parked.fetch_add(1, std::memory_order_seq_cst);
+                now_serving.wait(serving, std::memory_order_seq_cst);
+                parked.fetch_sub(1, std::memory_order_relaxed);
+                if (wait) wait->unparked();
+                backoff.reset();
+            }
+            if (wait) wait->done();
+        }
+
+        void unlock() {
+            // Only the lock holder writes now_serving
+            now_serving.store(now_serving.load(std::memory_order_relaxed) + 1, std::memory_order_seq_cst);
+            if (parked.load(std::memory_order_seq_cst) > 0) now_serving.notify_all();
+        }
+
+    };
+
+// MCS queue lock: FIFO like TicketLock, but every waiter spins (and then parks) on a flag in its
+// own queue node, so a hand-off touches only the successor's cache line and wakes exactly one
+// thread. This scales better than the ticket lock when many producers contend.
+//
+// Queue nodes are thread-local; a thread may hold up to MAX_NESTED MCS locks at a time and must
+// release them in reverse order of acquisition.
+class McsLock {
+    private:
+        static constexpr int MAX_NESTED = 4;
+        enum : uint32_t { GRANTED = 0, SPINNING = 1, PARKED = 2 };
+
+        struct alignas(CACHE_LINE_SIZE) QNode {
+            std::atomic<QNode*> next{nullptr};
+            std::atomic<uint32_t> state{GRANTED};
+        };
+
+        struct NodeStack {
+            QNode nodes[MAX_NESTED];
+            int depth = 0;
+        };
+
+        alignas(CACHE_LINE_SIZE) std::atomic<QNode*> tail{nullptr};
+        QNode* holder = nullptr;    // Written only by the thread that owns the lock
+
+        static NodeStack& localNodes() {
+            thread_local NodeStack stack;
+            return stack;
+        }
+
+    public:
+        void lock(LockWait* wait = nullptr) {
+            NodeStack& stack = localNodes();
+            QNode* node = &stack.nodes[stack.depth++];
+            node->next.store(nullptr, std::memory_order_relaxed);
+            node->state.store(SPINNING, std::memory_order_relaxed);
+
+            QNode* prev = tail.exchange(node, std::memory_order_acq_rel);
+            if (prev) {
+                prev->next.store(node, std::memory_order_release);
+                if (wait) wait->spinning();
+                Backoff backoff;
+                while (node->state.load(std::memory_order_acquire) != GRANTED) {
+                    if (backoff.spin()) continue;
+                    uint32_t expected = SPINNING;
+                    if (node->state.compare_exchange_strong(expected, PARKED, std::memory_order_acquire)) {
+                        if (wait) wait->parking();
+                        node->state.wait(PARKED, std::memory_order_acquire);
+                        if (wait) wait->unparked();
+                    }
+                }
+                if (wait) wait->done();
+            }
+            holder = node;
+        }
+
+        void unlock() {
+            QNode* node = holder;
+            QNode* succ = node->next.load(std::memory_order_acquire);
+            if (!succ) {
+                QNode* expected = node;
+                if (tail.compare_exchange_strong(expected, nullptr, std::memory_order_release, std::memory_order_relaxed)) {
+                    localNodes().depth--;
+                    return;
+                }
+                // A new waiter swapped itself in but has not linked to us yet
+                while (!(succ = node->next.load(std::memory_order_acquire))) cpuRelax();
+            }
+            if (succ->state.exchange(GRANTED, std::memory_order_acq_rel) == PARKED) succ->state.notify_one();
+            localNodes().depth--;
+        }
+
+    };
+
+// Event count: lets a thread sleep until a condition that is published without any mutex (an
+// atomic flag, a sequence number) becomes true, without the lost-wakeup window of pairing a
+// condition_variable with a mutex the publisher does not hold.
+//
+// Waiter:                                   Notifier:
+//     if (ready()) done                         make the condition true
+//     key = prepareWait()                       notifyOne() / notifyAll()
+//     if (ready()) cancelWait(), done
+//     commitWait(key)
+//
+// prepareWait() registers the waiter before the condition is re-checked, and the notifier checks
+// for registered waiters after publishing, so one of the two always sees the other. Notifying
+// costs one uncontended atomic operation and no syscall when nobody is waiting.
+//
+// atomic::wait cannot time out, so a waiter with a time limit sleeps on a condition variable
+// instead; a notifier takes its mutex only while such a waiter is registered.
+class EventCount {
+    private:
+        alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> epoch{0};
+        std::atomic<uint32_t> waiters{0};
+        std::atomic<uint32_t> timed_waiters{0};
+        std::mutex timed_mutex;
+        std::condition_variable timed_cv;
+
+        void signal(bool all) {
+            // Read-modify-write rather than a plain load: it is ordered with the waiter's increment in
+            // waiters' modification order, so either it sees the waiter or the waiter sees what the
+            // caller published before notifying
+            if (waiters.fetch_add(0, std::memory_order_seq_cst) == 0) return;
+            epoch.fetch_add(1, std::memory_order_seq_cst);
+            if (all) epoch.notify_all();
+            else epoch.notify_one();
+            // Same handshake with the timed waiters, which check epoch under timed_mutex
+            if (timed_waiters.load(std::memory_order_seq_cst) > 0) {
+                std::lock_guard<std::mutex> lock(timed_mutex);
+                timed_cv.notify_all();
+            }
+        }
+
+    public:
+        uint32_t prepareWait() {
+            waiters.fetch_add(1, std::memory_order_seq_cst);
+            return epoch.load(std::memory_order_seq_cst);
+        }
+
+        void cancelWait() {
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        // Returns once a notify has happened after prepareWait() (or spuriously); the caller re-checks
+        void commitWait(uint32_t key) {
+            epoch.wait(key, std::memory_order_seq_cst);
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        // Like commitWait(key), but returns by the deadline at the latest
+        void commitWait(uint32_t key, const WaitDeadline& deadline) {
+            if (deadline.unbounded()) {
+                commitWait(key);
+                return;
+            }
+            timed_waiters.fetch_add(1, std::memory_order_seq_cst);
+            {
+                std::unique_lock<std::mutex> lock(timed_mutex);
+                timed_cv.wait_until(lock, deadline.time(), [&] { return epoch.load(std::memory_order_seq_cst) != key; });
+            }
+            timed_waiters.fetch_sub(1, std::memory_order_relaxed);
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        void notifyOne() {
+            signal(false);
+        }
+
+        void notifyAll() {
+            signal(true);
+        }
+
+    };
+
+// Not a lock: passed in place of the producer lock (LinkedListBuffer<T, SpscPolicy>) it selects the
+// single-producer/single-consumer version of a buffer, which needs no locks at all. The caller
+// guarantees that at most one thread produces and one thread consumes at a time.
+struct SpscPolicy {};
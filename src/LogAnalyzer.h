@@ -0,0 +1,275 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <queue>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "AsyncLogger.h"
+#include "MappedLog.h"
+
+// Single-pass analysis of a buffer log, text, binary or trace.
+//
+// The log is parsed in place through a read-only mapping (MappedFile) and every line (or binary
+// record) is folded into running totals as soon as it is parsed, so memory does not grow with the
+// log. Peak occupancy needs the events in timestamp order. Neither sink writes them fully sorted:
+// the writer thread sorts each batch, and the mapped sink writes records as they happen. Either way a
+// record is only ever a little out of place, so a bounded min-heap of REORDER_WINDOW events restores
+// the order instead of sorting the whole log. Events that arrive after the window has moved past them
+// are applied at once and counted in late_records.
+//
+// Large logs can be split into chunks analysed by separate threads; every part of the result is
+// mergeable, including peak occupancy (peak of a + b = max(peak a, net a + peak b)).
+
+namespace log_analyzer {
+
+struct ProducerWaitStats {
+    uint64_t count = 0;
+    double wait_sum_ms = 0;
+    double wait_max_ms = 0;
+};
+
+struct LogAnalysis {
+    uint64_t produced = 0;
+    uint64_t consumed = 0;
+    double producer_wait_ms = 0;        // sum over all produce events
+    double consumer_wait_ms = 0;
+    double max_producer_wait_ms = 0;
+    double max_consumer_wait_ms = 0;
+    std::map<int, ProducerWaitStats> producers;
+
+    int64_t net_occupancy = 0;          // produced - consumed, in timestamp order
+    int64_t peak_occupancy = 0;
+    uint64_t late_records = 0;          // fell outside the reorder window
+    uint64_t malformed_lines = 0;
+
+    // Appends `next`, which covers the part of the log right after this one.
+    void merge(const LogAnalysis& next) {
+        produced += next.produced;
+        consumed += next.consumed;
+        producer_wait_ms += next.producer_wait_ms;
+        consumer_wait_ms += next.consumer_wait_ms;
+        max_producer_wait_ms = std::max(max_producer_wait_ms, next.max_producer_wait_ms);
+        max_consumer_wait_ms = std::max(max_consumer_wait_ms, next.max_consumer_wait_ms);
+        for (const auto& [id, p] : next.producers) {
+            ProducerWaitStats& mine = producers[id];
+            mine.count += p.count;
+            mine.wait_sum_ms += p.wait_sum_ms;
+            mine.wait_max_ms = std::max(mine.wait_max_ms, p.wait_max_ms);
+        }
+        peak_occupancy = std::max(peak_occupancy, net_occupancy + next.peak_occupancy);
+        net_occupancy += next.net_occupancy;
+        late_records += next.late_records;
+        malformed_lines += next.malformed_lines;
+    }
+};
+
+// Parses one line of the text log (without the newline):
+//     [<timestamp>us] Producer <id> waited for <wait>ms and produced: <value>
+// Returns false for anything else, e.g. the Visualizer's separator lines.
+inline bool parseLogLine(const char* p, const char* end, LogRecord& r) {
+    auto skip = [&](const char* literal) {
+        size_t n = std::strlen(literal);
+        if (static_cast<size_t>(end - p) < n || std::memcmp(p, literal, n) != 0) return false;
+        p += n;
+        return true;
+    };
+    auto number = [&](auto& out) {
+        auto [next, ec] = std::from_chars(p, end, out);
+        if (ec != std::errc()) return false;
+        p = next;
+        return true;
+    };
+
+    long long timestamp_us = 0, value = 0;
+    double wait_ms = 0;
+    if (!skip("[") || !number(timestamp_us) || !skip("us] ")) return false;
+    if (skip("Producer ")) r.role = LogRole::Producer;
+    else if (skip("Consumer ")) r.role = LogRole::Consumer;
+    else return false;
+    if (!number(r.thread_id) || !skip(" waited for ") || !number(wait_ms) || !skip("ms and ")) return false;
+    if (!skip(r.role == LogRole::Producer ? "produced: " : "consumed: ") || !number(value)) return false;
+
+    r.timestamp_ns = timestamp_us * 1000;
+    r.wait_ns = static_cast<int64_t>(wait_ms * 1e6);
+    r.value = value;
+    return true;
+}
+
+// Folds records into a LogAnalysis one at a time.
+class StreamingAnalyzer {
+public:
+    static constexpr size_t REORDER_WINDOW = 1 << 16;
+
+    void add(const LogRecord& r) {
+        double wait_ms = static_cast<double>(r.wait_ns) / 1e6;
+        if (r.role == LogRole::Producer) {
+            result.produced++;
+            result.producer_wait_ms += wait_ms;
+            result.max_producer_wait_ms = std::max(result.max_producer_wait_ms, wait_ms);
+            ProducerWaitStats& p = result.producers[r.thread_id];
+            p.count++;
+            p.wait_sum_ms += wait_ms;
+            p.wait_max_ms = std::max(p.wait_max_ms, wait_ms);
+        } else {
+            result.consumed++;
+            result.consumer_wait_ms += wait_ms;
+            result.max_consumer_wait_ms = std::max(result.max_consumer_wait_ms, wait_ms);
+        }
+
+        int delta = (r.role == LogRole::Producer) ? 1 : -1;
+        if (released_any && r.timestamp_ns < released_until) {
+            result.late_records++;
+            apply(delta);
+            return;
+        }
+        window.push({r.timestamp_ns, delta});
+        if (window.size() > REORDER_WINDOW) release();
+    }
+
+    void addMalformed() {
+        result.malformed_lines++;
+    }
+
+    // Applies what is left in the reorder window and returns the result.
+    LogAnalysis finish() {
+        while (!window.empty()) release();
+        return result;
+    }
+
+private:
+    using Event = std::pair<int64_t, int>;     // timestamp, occupancy change
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> window;
+    int64_t released_until = 0;
+    bool released_any = false;
+    LogAnalysis result;
+
+    void release() {
+        Event e = window.top();
+        window.pop();
+        released_until = e.first;
+        released_any = true;
+        apply(e.second);
+    }
+
+    void apply(int delta) {
+        result.net_occupancy += delta;
+        result.peak_occupancy = std::max(result.peak_occupancy, result.net_occupancy);
+    }
+};
+
+// Calls f(begin, end) for every non-empty line in [p, end), without the line break.
+template <typename F>
+void forEachLine(const char* p, const char* end, F&& f) {
+    while (p < end) {
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        const char* line_end = nl ? nl : end;
+        const char* e = line_end;
+        if (e > p && e[-1] == '\r') --e;
+        if (e > p) f(p, e);
+        p = line_end + 1;
+    }
+}
+
+inline bool isBinaryLog(const char* data, size_t size) {
+    return size >= sizeof(AsyncLogger::BINARY_MAGIC) &&
+           std::memcmp(data, AsyncLogger::BINARY_MAGIC, sizeof(AsyncLogger::BINARY_MAGIC)) == 0;
+}
+
+// A trace (LogFormat::Trace) holds binary records between its header and its index
+inline bool isTraceLog(const char* data, size_t size) {
+    return size >= sizeof(TraceHeader) &&
+           std::memcmp(data, AsyncLogger::TRACE_MAGIC, sizeof(AsyncLogger::TRACE_MAGIC)) == 0;
+}
+
+namespace detail {
+
+constexpr size_t MIN_CHUNK_BYTES = 8 << 20;     // smaller logs are not worth another thread
+
+inline LogAnalysis analyzeText(const char* begin, const char* end) {
+    StreamingAnalyzer analyzer;
+    forEachLine(begin, end, [&](const char* p, const char* e) {
+        LogRecord r;
+        if (parseLogLine(p, e, r)) analyzer.add(r);
+        else analyzer.addMalformed();
+    });
+    return analyzer.finish();
+}
+
+inline LogAnalysis analyzeBinary(const char* begin, const char* end) {
+    StreamingAnalyzer analyzer;
+    // Copying each record out keeps the reads aligned whatever the mapping offset
+    for (const char* p = begin; p + sizeof(LogRecord) <= end; p += sizeof(LogRecord)) {
+        LogRecord r;
+        std::memcpy(&r, p, sizeof(r));
+        analyzer.add(r);
+    }
+    return analyzer.finish();
+}
+
+} // namespace detail
+
+// Analyses a log already in memory, detecting the binary format from its header. threads = 0 picks
+// one thread per MIN_CHUNK_BYTES of log, up to the number of hardware threads.
+inline LogAnalysis analyzeLog(const char* data, size_t size, unsigned threads = 0) {
+    if (size == 0) return {};
+    bool trace = isTraceLog(data, size);
+    bool binary = trace || isBinaryLog(data, size);
+    const char* begin = data + (trace ? sizeof(TraceHeader) : binary ? sizeof(AsyncLogger::BINARY_MAGIC) : 0);
+    const char* end = data + size;
+    if (trace) {
+        TraceHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if (header.index_offset != 0) end = data + std::min<size_t>(header.index_offset, size);
+    }
+
+    if (threads == 0) {
+        size_t by_size = std::max<size_t>(1, size / detail::MIN_CHUNK_BYTES);
+        threads = static_cast<unsigned>(std::min<size_t>(by_size, std::max(1u, std::thread::hardware_concurrency())));
+    }
+
+    // Split into chunks on record (binary) or line (text) boundaries
+    std::vector<const char*> bounds{begin};
+    size_t records = static_cast<size_t>(end - begin) / sizeof(LogRecord);
+    for (unsigned i = 1; i < threads; ++i) {
+        const char* at;
+        if (binary) {
+            at = begin + records / threads * i * sizeof(LogRecord);
+        } else {
+            at = begin + static_cast<size_t>(end - begin) / threads * i;
+            const char* nl = static_cast<const char*>(std::memchr(at, '\n', static_cast<size_t>(end - at)));
+            at = nl ? nl + 1 : end;
+        }
+        bounds.push_back(std::max(at, bounds.back()));
+    }
+    bounds.push_back(end);
+
+    auto analyzeRange = [&](size_t i) {
+        return binary ? detail::analyzeBinary(bounds[i], bounds[i + 1]) : detail::analyzeText(bounds[i], bounds[i + 1]);
+    };
+    std::vector<LogAnalysis> parts(bounds.size() - 1);
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < parts.size(); ++i) {
+        workers.emplace_back([&, i] { parts[i] = analyzeRange(i); });
+    }
+    parts[0] = analyzeRange(0);
+    for (auto& w : workers) w.join();
+
+    LogAnalysis result = parts[0];
+    for (size_t i = 1; i < parts.size(); ++i) result.merge(parts[i]);
+    return result;
+}
+
+// Analyses a log file in place through a read-only mapping.
+inline LogAnalysis analyzeLogFile(const std::string& path, unsigned threads = 0) {
+    MappedFile log(path);
+    return analyzeLog(log.data(), log.size(), threads);
+}
+
+} // namespace log_analyzer
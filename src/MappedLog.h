@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define BUFFER_HAVE_MMAP 1
+#else
+#define BUFFER_HAVE_MMAP 0
+#endif
+
+// Memory-mapped log files.
+//
+// MappedLogSink lets every logging thread write straight into a shared mapping of the log file:
+// a thread reserves its bytes with one fetch_add on the write offset and copies the record in, with
+// no writer thread, queue or syscall. The whole address range the log may ever use is reserved up
+// front, so the mapping never moves; the file behind it is extended in GROW_BYTES steps, which is
+// the only time a writer takes a lock. close() trims the file to the bytes actually written.
+//
+// MappedFile is the read side: a read-only mapping through which the analyzer and the Visualizer
+// parse the log in place (zero-copy) instead of copying it line by line through ifstream.
+//
+// Without mmap (non-POSIX builds) the sink is unavailable and MappedFile reads the file into memory.
+
+class MappedLogSink {
+public:
+    static constexpr size_t RESERVE_BYTES = sizeof(void*) == 8 ? (1ull << 36) : (1ull << 30);  // address space, not memory
+    static constexpr size_t GROW_BYTES = 64ull << 20;
+
+    MappedLogSink() = default;
+    MappedLogSink(const MappedLogSink&) = delete;
+    MappedLogSink& operator=(const MappedLogSink&) = delete;
+
+    ~MappedLogSink() {
+        close();
+    }
+
+    // Truncates the file, preallocates the first GROW_BYTES and maps the reserved range.
+    bool open(const std::string& path) {
+        close();
+#if BUFFER_HAVE_MMAP
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return false;
+        void* mapping = ::mmap(nullptr, RESERVE_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+        base = static_cast<char*>(mapping);
+        write_offset.store(0, std::memory_order_relaxed);
+        dropped.store(0, std::memory_order_relaxed);
+        file_size.store(0, std::memory_order_relaxed);
+        grow(GROW_BYTES);
+        return true;
+#else
+        (void)path;
+        return false;
+#endif
+    }
+
+    // Copies n bytes into the log. Safe to call from any number of threads, but not concurrently
+    // with close(). Bytes that would go past RESERVE_BYTES are dropped and counted.
+    void append(const void* data, size_t n) {
+        size_t offset = write_offset.fetch_add(n, std::memory_order_relaxed);
+        size_t end = offset + n;
+        if (end > RESERVE_BYTES) {
+            dropped.fetch_add(n, std::memory_order_relaxed);
+            return;
+        }
+        if (end > file_size.load(std::memory_order_acquire)) grow(end);
+        std::memcpy(base + offset, data, n);
+    }
+
+    uint64_t droppedBytes() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+    bool isOpen() const {
+        return base != nullptr;
+    }
+
+    // Unmaps and trims the file to what was written. Every append must have returned.
+    void close() {
+#if BUFFER_HAVE_MMAP
+        if (!base) return;
+        size_t written = std::min(write_offset.load(std::memory_order_relaxed), RESERVE_BYTES);
+        ::munmap(base, RESERVE_BYTES);
+        if (::ftruncate(fd, static_cast<off_t>(written)) != 0) std::perror("MappedLogSink: ftruncate");
+        ::close(fd);
+        base = nullptr;
+        fd = -1;
+#endif
+    }
+
+private:
+    char* base = nullptr;
+    int fd = -1;
+    alignas(64) std::atomic<size_t> write_offset{0};
+    alignas(64) std::atomic<size_t> file_size{0};
+    std::atomic<uint64_t> dropped{0};
+    std::mutex grow_mutex;
+
+    // Extends the file so that it covers at least `end` bytes
+    void grow(size_t end) {
+#if BUFFER_HAVE_MMAP
+        std::lock_guard<std::mutex> lock(grow_mutex);
+        size_t size = file_size.load(std::memory_order_relaxed);
+        if (size >= end) return;
+        size_t target = std::min(RESERVE_BYTES, std::max(end, size + GROW_BYTES));
+        target = (target + GROW_BYTES - 1) / GROW_BYTES * GROW_BYTES;
+        target = std::min(target, RESERVE_BYTES);
+        // posix_fallocate reserves the blocks so that writing into the mapping cannot hit a full disk
+        // (SIGBUS); where it is not supported, plain ftruncate still makes the pages addressable
+#if defined(__linux__)
+        if (::posix_fallocate(fd, 0, static_cast<off_t>(target)) != 0)
+#endif
+        {
+            if (::ftruncate(fd, static_cast<off_t>(target)) != 0) std::perror("MappedLogSink: ftruncate");
+        }
+        file_size.store(target, std::memory_order_release);
+#else
+        (void)end;
+#endif
+    }
+};
+
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+#if BUFFER_HAVE_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* mapping = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                bytes = static_cast<const char*>(mapping);
+                length = static_cast<size_t>(st.st_size);
+                ::madvise(mapping, length, MADV_SEQUENTIAL);
+            }
+        }
+        opened = true;
+        ::close(fd);
+#else
+        std::FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) return;
+        char block[1 << 16];
+        size_t n;
+        while ((n = std::fread(block, 1, sizeof(block), f)) > 0) copy.insert(copy.end(), block, block + n);
+        std::fclose(f);
+        bytes = copy.data();
+        length = copy.size();
+        opened = true;
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+#if BUFFER_HAVE_MMAP
+        if (bytes) ::munmap(const_cast<char*>(bytes), length);
+#endif
+    }
+
+    const char* data() const {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+    bool isOpen() const {
+        return opened;
+    }
+
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+    bool opened = false;
+#if !BUFFER_HAVE_MMAP
+    std::vector<char> copy;
+#endif
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cmath>
+#include <string>
+#include <SFML/Graphics.hpp>
+
+// Batched geometry for the Visualizers.
+//
+// A frame's circles, connecting lines and node labels are appended to three vertex arrays and drawn
+// with three draw calls, however many nodes are on screen. Labels are built from the font's glyph
+// atlas: the glyphs for the digits and '-' are looked up once, and every label becomes textured
+// quads over the atlas texture. The callers only add what lies inside the current view.
+class NodeBatch {
+public:
+    static constexpr int CIRCLE_SEGMENTS = 24;
+
+    NodeBatch(const sf::Font& font, unsigned character_size) : text_size(character_size) {
+        for (int i = 0; i < CIRCLE_SEGMENTS; ++i) {
+            float angle = 2 * 3.14159265f * static_cast<float>(i) / CIRCLE_SEGMENTS;
+            unit_circle[i] = sf::Vector2f(std::cos(angle), std::sin(angle));
+        }
+        // Loading every glyph before taking the texture, so the atlas does not change under us
+        for (int d = 0; d < 10; ++d) glyphs[d] = font.getGlyph('0' + d, character_size, false);
+        glyphs[10] = font.getGlyph('-', character_size, false);
+        atlas = &font.getTexture(character_size);
+    }
+
+    void clear() {
+        circles.clear();
+        lines.clear();
+        labels.clear();
+    }
+
+    // Filled circle with an outline drawn outside the radius, like sf::CircleShape
+    void addCircle(sf::Vector2f center, float radius, sf::Color fill, sf::Color outline, float outline_thickness) {
+        addDisc(center, radius + outline_thickness, outline);
+        addDisc(center, radius, fill);
+    }
+
+    void addLine(sf::Vector2f from, sf::Vector2f to, sf::Color color) {
+        lines.append(sf::Vertex(from, color));
+        lines.append(sf::Vertex(to, color));
+    }
+
+    // Number label whose top-left corner is at position, laid out like sf::Text
+    void addNumber(long long value, sf::Vector2f position, sf::Color color) {
+        std::string digits = std::to_string(value);
+        float x = position.x;
+        float baseline = position.y + static_cast<float>(text_size);
+        for (char c : digits) {
+            const sf::Glyph& g = glyphs[c == '-' ? 10 : c - '0'];
+            float left = x + g.bounds.left, top = baseline + g.bounds.top;
+            float right = left + g.bounds.width, bottom = top + g.bounds.height;
+            float u0 = static_cast<float>(g.textureRect.left), v0 = static_cast<float>(g.textureRect.top);
+            float u1 = u0 + static_cast<float>(g.textureRect.width), v1 = v0 + static_cast<float>(g.textureRect.height);
+            addQuad(labels, {left, top}, {right, bottom}, {u0, v0}, {u1, v1}, color);
+            x += g.advance;
+        }
+    }
+
+    size_t vertexCount() const {
+        return circles.getVertexCount() + lines.getVertexCount() + labels.getVertexCount();
+    }
+
+    void draw(sf::RenderWindow& window) const {
+        window.draw(lines);
+        window.draw(circles);
+        sf::RenderStates states;
+        states.texture = atlas;
+        window.draw(labels, states);
+    }
+
+private:
+    unsigned text_size;
+    sf::Vector2f unit_circle[CIRCLE_SEGMENTS];
+    sf::Glyph glyphs[11];
+    const sf::Texture* atlas = nullptr;
+
+    sf::VertexArray circles{sf::Triangles};
+    sf::VertexArray lines{sf::Lines};
+    sf::VertexArray labels{sf::Triangles};
+
+    void addDisc(sf::Vector2f center, float radius, sf::Color color) {
+        for (int i = 0; i < CIRCLE_SEGMENTS; ++i) {
+            const sf::Vector2f& a = unit_circle[i];
+            const sf::Vector2f& b = unit_circle[(i + 1) % CIRCLE_SEGMENTS];
+            circles.append(sf::Vertex(center, color));
+            circles.append(sf::Vertex(center + a * radius, color));
+            circles.append(sf::Vertex(center + b * radius, color));
+        }
+    }
+
+    static void addQuad(sf::VertexArray& array, sf::Vector2f top_left, sf::Vector2f bottom_right,
+                        sf::Vector2f tex_top_left, sf::Vector2f tex_bottom_right, sf::Color color) {
+        sf::Vertex tl(top_left, color, tex_top_left);
+        sf::Vertex tr({bottom_right.x, top_left.y}, color, {tex_bottom_right.x, tex_top_left.y});
+        sf::Vertex bl({top_left.x, bottom_right.y}, color, {tex_top_left.x, tex_bottom_right.y});
+        sf::Vertex br(bottom_right, color, tex_bottom_right);
+        array.append(tl);
+        array.append(tr);
+        array.append(br);
+        array.append(tl);
+        array.append(br);
+        array.append(bl);
+    }
+};
@@ -0,0 +1,259 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+#include "Topology.h"
+
+// Slab allocator for buffer nodes.
+//
+// Nodes are carved out of slabs of SLAB_NODES nodes and recycled through a free list instead of
+// going back to the global allocator. Every thread keeps a private cache of free nodes, so in the
+// steady state allocate() and release() neither allocate nor lock. Threads exchange free nodes
+// with the shared pool BATCH nodes at a time. Slabs are handed back to the system only when the
+// shared pool holds more than HIGH_WATERMARK idle nodes and a whole slab is free.
+//
+// On a NUMA machine there is one shared pool per node. A slab belongs to the node of the thread that
+// grew it and is placed in that node's memory; its first slot records the node. A thread allocates
+// from its own node's pool (the node it ran on when it first used the pool, so threads that should
+// stay local are pinned before that), while released nodes go back towards the pool of their slab.
+// Nodes therefore do not drift to the consumers' socket: a producer on socket 0 keeps reusing
+// socket 0 memory however far away the consumers run.
+template <typename T>
+class NodePool {
+public:
+    static constexpr size_t BATCH = 64;
+    static constexpr size_t SLAB_NODES = 16 * BATCH;
+    static constexpr size_t HIGH_WATERMARK = 16 * SLAB_NODES;     // per node
+
+    template <typename... Args>
+    static T* allocate(Args&&... args) {
+        FreeNode* node;
+        Cache* cache = localCache();
+        if (cache) {
+            FreeList& local = cache->lists[cache->node];
+            if (!local.first) refill(*cache);
+            node = local.first;
+            local.first = node->next;
+            local.count--;
+        } else {
+            node = takeShared(NumaTopology::system().currentNode());
+        }
+        return new (node) T(std::forward<Args>(args)...);
+    }
+
+    static void release(T* ptr) {
+        ptr->~T();
+        FreeNode* node = reinterpret_cast<FreeNode*>(ptr);
+        size_t home = homeNode(node);
+
+        Cache* cache = localCache();
+        if (!cache) {
+            giveShared(node, home);
+            return;
+        }
+        FreeList& list = cache->lists[home];
+        node->next = list.first;
+        list.first = node;
+        if (++list.count >= 2 * BATCH) spill(list, home, BATCH);
+    }
+
+    // Number of slabs currently owned by the pool (one slab = SLAB_NODES nodes), on all nodes.
+    static size_t slabCount() {
+        size_t count = 0;
+        for (size_t n = 0; n < NumaTopology::system().nodeCount(); ++n) count += slabCount(n);
+        return count;
+    }
+
+    static size_t slabCount(size_t numa_node) {
+        Shared& shared = sharedPool(numa_node);
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        return shared.slabs.size();
+    }
+
+private:
+    union FreeNode {
+        FreeNode* next;
+        size_t home;        // first slot of a slab: the NUMA node the slab belongs to
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    // A slab is its header slot and SLAB_NODES nodes, aligned to a power of two at least that large,
+    // so the header of any node is found by masking the node's address.
+    static constexpr size_t SLAB_BYTES = (SLAB_NODES + 1) * sizeof(FreeNode);
+    static constexpr size_t SLAB_ALIGN = std::bit_ceil(SLAB_BYTES);
+
+    // Free nodes are kept in chains of (normally) BATCH nodes so that a refill or spill
+    // is one push/pop under the pool mutex.
+    struct Batch {
+        FreeNode* first;
+        size_t size;
+    };
+
+    struct Shared {
+        std::mutex mutex;
+        std::vector<Batch> batches;
+        size_t idle = 0;
+        std::vector<FreeNode*> slabs;
+        size_t trim_threshold = HIGH_WATERMARK;
+
+        ~Shared() {
+            for (FreeNode* slab : slabs) freeSlab(slab);
+        }
+    };
+
+    struct FreeList {
+        FreeNode* first = nullptr;
+        size_t count = 0;
+    };
+
+    // lists[n] holds free nodes of node n's slabs; the thread allocates from lists[node]
+    struct Cache {
+        size_t node = NumaTopology::system().currentNode();
+        std::vector<FreeList> lists = std::vector<FreeList>(NumaTopology::system().nodeCount());
+
+        // A thread that exits gives its cached nodes back to the shared pools
+        ~Cache() {
+            for (size_t n = 0; n < lists.size(); ++n) {
+                while (lists[n].count >= BATCH) spill(lists[n], n, BATCH);
+                if (lists[n].count) spill(lists[n], n, lists[n].count);
+            }
+            cache_destroyed = true;
+        }
+    };
+
+    // Set once the thread's cache is gone. Nodes released later on that thread (e.g. by
+    // thread-exit hooks or static destructors) go straight to the shared pool.
+    inline static thread_local bool cache_destroyed = false;
+
+    static Shared& sharedPool(size_t numa_node) {
+        static std::unique_ptr<Shared[]> pools(new Shared[NumaTopology::system().nodeCount()]);
+        return pools[numa_node];
+    }
+
+    static Cache* localCache() {
+        if (cache_destroyed) return nullptr;
+        thread_local Cache cache;
+        return &cache;
+    }
+
+    static size_t homeNode(FreeNode* node) {
+        return reinterpret_cast<FreeNode*>(reinterpret_cast<uintptr_t>(node) & ~(SLAB_ALIGN - 1))->home;
+    }
+
+    // Caller holds the pool mutex. The memory policy is set before the nodes are first written, so a
+    // multi-node machine backs the slab with that node's pages.
+    static void grow(Shared& shared, size_t numa_node) {
+        FreeNode* block = static_cast<FreeNode*>(::operator new(SLAB_BYTES, std::align_val_t(SLAB_ALIGN)));
+        NumaTopology::system().preferNode(block, SLAB_BYTES, numa_node);
+        block->home = numa_node;
+        FreeNode* slab = block + 1;
+        shared.slabs.push_back(slab);
+        for (size_t b = 0; b < SLAB_NODES; b += BATCH) {
+            for (size_t i = b; i + 1 < b + BATCH; ++i) slab[i].next = &slab[i + 1];
+            slab[b + BATCH - 1].next = nullptr;
+            shared.batches.push_back({&slab[b], BATCH});
+        }
+        shared.idle += SLAB_NODES;
+    }
+
+    static void freeSlab(FreeNode* slab) {
+        ::operator delete(slab - 1, std::align_val_t(SLAB_ALIGN));
+    }
+
+    // Takes one batch from the thread's node pool, growing it by a new slab when it has none.
+    static void refill(Cache& cache) {
+        Shared& shared = sharedPool(cache.node);
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        if (shared.batches.empty()) grow(shared, cache.node);
+        Batch batch = shared.batches.back();
+        shared.batches.pop_back();
+        shared.idle -= batch.size;
+        if (shared.idle < HIGH_WATERMARK) shared.trim_threshold = HIGH_WATERMARK;
+        cache.lists[cache.node].first = batch.first;
+        cache.lists[cache.node].count = batch.size;
+    }
+
+    // Slow paths used once the thread cache has been destroyed.
+    static FreeNode* takeShared(size_t numa_node) {
+        Shared& shared = sharedPool(numa_node);
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        if (shared.batches.empty()) grow(shared, numa_node);
+        Batch& batch = shared.batches.back();
+        FreeNode* node = batch.first;
+        batch.first = node->next;
+        if (--batch.size == 0) shared.batches.pop_back();
+        shared.idle--;
+        return node;
+    }
+
+    static void giveShared(FreeNode* node, size_t home) {
+        Shared& shared = sharedPool(home);
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        node->next = nullptr;
+        shared.batches.push_back({node, 1});
+        shared.idle++;
+    }
+
+    // Moves n nodes from one of the thread cache's lists to the pool of node home as one chain.
+    static void spill(FreeList& list, size_t home, size_t n) {
+        FreeNode* first = list.first;
+        FreeNode* last = first;
+        for (size_t i = 1; i < n; ++i) last = last->next;
+        list.first = last->next;
+        list.count -= n;
+        last->next = nullptr;
+
+        Shared& shared = sharedPool(home);
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        shared.batches.push_back({first, n});
+        shared.idle += n;
+        if (shared.idle > shared.trim_threshold) trim(shared);
+    }
+
+    // Frees every slab whose nodes are all idle in the shared pool and rebuilds the batches
+    // from what is left. Runs only once the idle count passes the watermark.
+    static void trim(Shared& shared) {
+        std::vector<FreeNode*> idle;
+        for (const Batch& batch : shared.batches) {
+            for (FreeNode* n = batch.first; n; n = n->next) idle.push_back(n);
+        }
+        std::sort(idle.begin(), idle.end());
+        std::sort(shared.slabs.begin(), shared.slabs.end());
+
+        std::vector<FreeNode*> kept_slabs;
+        std::vector<FreeNode*> kept_nodes;
+        auto it = idle.begin();
+        for (FreeNode* slab : shared.slabs) {
+            auto slab_end = std::lower_bound(it, idle.end(), slab + SLAB_NODES);
+            it = std::lower_bound(it, slab_end, slab);
+            if (static_cast<size_t>(slab_end - it) == SLAB_NODES) {
+                freeSlab(slab);
+            } else {
+                kept_slabs.push_back(slab);
+                kept_nodes.insert(kept_nodes.end(), it, slab_end);
+            }
+            it = slab_end;
+        }
+        shared.slabs.swap(kept_slabs);
+
+        shared.batches.clear();
+        for (size_t b = 0; b < kept_nodes.size(); b += BATCH) {
+            size_t end = std::min(b + BATCH, kept_nodes.size());
+            for (size_t i = b; i + 1 < end; ++i) kept_nodes[i]->next = kept_nodes[i + 1];
+            kept_nodes[end - 1]->next = nullptr;
+            shared.batches.push_back({kept_nodes[b], end - b});
+        }
+        shared.idle = kept_nodes.size();
+
+        // Slabs that are still partly in use keep the pool above the watermark;
+        // wait for another slab's worth of idle nodes before scanning again
+        shared.trim_threshold = std::max(HIGH_WATERMARK, shared.idle + SLAB_NODES);
+    }
+};
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <optional>
+#include <span>
+#include "Deadline.h"
+#include "Locks.h"
+#include "Platform.h"
+#include "Topology.h"
+
+// Zero-copy transport for large payloads: the buffers carry PayloadRef descriptors into a
+// PayloadArena instead of the payload bytes.
+//
+// The arena is one contiguous region of fixed-size blocks, allocated, placed and faulted in once,
+// so it can also be registered with a device (RDMA, io_uring fixed buffers) as a whole. A producer
+// acquires a block, writes its message in place, commits the length and produces the descriptor; a
+// consumer reads the message where it lies and releases the block. Neither side copies the payload or
+// allocates, whatever its size: the buffers move 16 bytes, which they store inline (see SlotStorage).
+//
+//     PayloadRef region = arena.acquire();
+//     size_t n = fill(region.writable());
+//     buffer.produce(arena.commit(region, n), id);
+//     ...
+//     PayloadRef message = buffer.consume(id);
+//     handle(message.bytes());
+//     arena.release(message);
+
+// A block of an arena: where it is, how many bytes of it hold the message, and which block it is.
+// Trivially copyable, so any buffer can carry it as its element type.
+struct PayloadRef {
+    std::byte* data = nullptr;
+    uint32_t length = 0;
+    uint32_t block = 0;         // handle for PayloadArena::release()
+
+    std::span<const std::byte> bytes() const {
+        return {data, length};
+    }
+};
+
+// Message sizes show up in the drivers' logs
+inline int64_t logValue(const PayloadRef& ref) {
+    return ref.length;
+}
+
+class PayloadArena {
+public:
+    // block_count blocks of at least block_size bytes each, on the given NUMA node
+    PayloadArena(size_t block_size, size_t block_count, size_t numa_node = NumaTopology::system().currentNode())
+        : BLOCK_SIZE(std::max<size_t>(block_size, 1)),
+          STRIDE((BLOCK_SIZE + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE),
+          BLOCK_COUNT(std::clamp<size_t>(block_count, 1, NO_BLOCK - 1)),
+          next(new std::atomic<uint32_t>[BLOCK_COUNT]) {
+        region = static_cast<std::byte*>(::operator new(regionBytes(), std::align_val_t(REGION_ALIGN)));
+        // Placement first, then writing every page, so no message pays for a page fault
+        NumaTopology::system().preferNode(region, regionBytes(), numa_node);
+        std::memset(region, 0, regionBytes());
+
+        for (uint32_t i = 0; i < BLOCK_COUNT; ++i) next[i].store(i + 1 < BLOCK_COUNT ? i + 1 : NO_BLOCK, std::memory_order_relaxed);
+        free_top.store(pack(0, 0), std::memory_order_release);
+        free_count.store(BLOCK_COUNT, std::memory_order_relaxed);
+    }
+
+    ~PayloadArena() {
+        ::operator delete(region, std::align_val_t(REGION_ALIGN));
+    }
+
+    PayloadArena(const PayloadArena&) = delete;
+    PayloadArena& operator=(const PayloadArena&) = delete;
+
+    // A free block to fill; waits while all blocks are out
+    PayloadRef acquire() {
+        return *acquireWithin(WaitDeadline::forever());
+    }
+
+    // Same, or nullopt if no block is free (by the deadline)
+    std::optional<PayloadRef> try_acquire() {
+        return acquireWithin(WaitDeadline::none());
+    }
+
+    template <typename Rep, typename Period>
+    std::optional<PayloadRef> acquire_for(const std::chrono::duration<Rep, Period>& timeout) {
+        return acquireWithin(WaitDeadline::after(timeout));
+    }
+
+    // The descriptor to produce once length bytes of region have been written (at most blockSize())
+    PayloadRef commit(PayloadRef region_ref, size_t length) const {
+        region_ref.length = static_cast<uint32_t>(std::min(length, BLOCK_SIZE));
+        return region_ref;
+    }
+
+    // The whole block of an acquired region, to write into
+    std::span<std::byte> writable(const PayloadRef& region_ref) const {
+        return {region_ref.data, BLOCK_SIZE};
+    }
+
+    // Returns the block of a consumed message to the arena; ref and its bytes are not used afterwards
+    void release(const PayloadRef& ref) {
+        uint32_t block = ref.block;
+        uint64_t top = free_top.load(std::memory_order_relaxed);
+        do {
+            next[block].store(index(top), std::memory_order_relaxed);
+        // Release: the reads of this message happen before the block is handed out again
+        } while (!free_top.compare_exchange_weak(top, pack(block, tag(top) + 1), std::memory_order_release, std::memory_order_relaxed));
+        free_count.fetch_add(1, std::memory_order_relaxed);
+        freed.notifyOne();
+    }
+
+    bool owns(const PayloadRef& ref) const {
+        return ref.block < BLOCK_COUNT && ref.data == blockData(ref.block);
+    }
+
+    size_t blockSize() const {
+        return BLOCK_SIZE;
+    }
+
+    size_t blockCount() const {
+        return BLOCK_COUNT;
+    }
+
+    // Blocks neither acquired nor in flight; a snapshot
+    size_t available() const {
+        return free_count.load(std::memory_order_relaxed);
+    }
+
+    // The registered memory: every block lies inside it
+    std::span<std::byte> memory() const {
+        return {region, regionBytes()};
+    }
+
+private:
+    static constexpr uint32_t NO_BLOCK = UINT32_MAX;
+    static constexpr size_t REGION_ALIGN = 4096;
+
+    const size_t BLOCK_SIZE;
+    const size_t STRIDE;                // distance between blocks, whole cache lines
+    const size_t BLOCK_COUNT;
+
+    std::byte* region = nullptr;
+    // Free blocks form a stack linked through next[], outside the blocks, so a popped block's bytes
+    // are never written by the arena. The top carries a tag against ABA.
+    std::unique_ptr<std::atomic<uint32_t>[]> next;
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> free_top{pack(NO_BLOCK, 0)};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> free_count{0};
+    EventCount freed;                   // producers waiting for a block
+
+    static uint64_t pack(uint32_t block, uint32_t tag) {
+        return (static_cast<uint64_t>(tag) << 32) | block;
+    }
+
+    static uint32_t index(uint64_t top) {
+        return static_cast<uint32_t>(top);
+    }
+
+    static uint32_t tag(uint64_t top) {
+        return static_cast<uint32_t>(top >> 32);
+    }
+
+    size_t regionBytes() const {
+        return (STRIDE * BLOCK_COUNT + REGION_ALIGN - 1) / REGION_ALIGN * REGION_ALIGN;
+    }
+
+    std::byte* blockData(uint32_t block) const {
+        return region + static_cast<size_t>(block) * STRIDE;
+    }
+
+    std::optional<PayloadRef> tryPop() {
+        uint64_t top = free_top.load(std::memory_order_acquire);
+        while (index(top) != NO_BLOCK) {
+            uint32_t block = index(top);
+            if (free_top.compare_exchange_weak(top, pack(next[block].load(std::memory_order_relaxed), tag(top) + 1),
+                                               std::memory_order_acquire, std::memory_order_acquire)) {
+                free_count.fetch_sub(1, std::memory_order_relaxed);
+                return PayloadRef{blockData(block), 0, block};
+            }
+        }
+        return std::nullopt;
+    }
+
+    std::optional<PayloadRef> acquireWithin(const WaitDeadline& deadline) {
+        while (true) {
+            if (std::optional<PayloadRef> ref = tryPop()) return ref;
+            if (deadline.passed()) return std::nullopt;
+            uint32_t key = freed.prepareWait();
+            if (std::optional<PayloadRef> ref = tryPop()) {
+                freed.cancelWait();
+                return ref;
+            }
+            freed.commitWait(key, deadline);
+        }
+    }
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+// Size used to pad hot atomics onto their own cache line so that unrelated threads do not false-share.
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+// Spin-wait hint: tells the core we are busy-waiting (pause on x86, yield on ARM).
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+// Exponential backoff for short spin phases. spin() pauses for 1, 2, 4, ... MAX_PAUSES iterations and
+// returns false once the spin budget is used up, at which point the caller should park instead.
+class Backoff {
+public:
+    static constexpr int MAX_PAUSES = 64;
+    static constexpr int MAX_ROUNDS = 12;
+
+    bool spin() {
+        if (rounds >= MAX_ROUNDS) return false;
+        for (int i = 0; i < pauses; ++i) cpuRelax();
+        if (pauses < MAX_PAUSES) pauses <<= 1;
+        rounds++;
+        return true;
+    }
+
+    void reset() {
+        pauses = 1;
+        rounds = 0;
+    }
+
+private:
+    int pauses = 1;
+    int rounds = 0;
+};
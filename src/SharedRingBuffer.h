@@ -0,0 +1,411 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include "AsyncLogger.h"
+#include "Deadline.h"
+#include "Instrumentation.h"
+#include "Platform.h"
+#include "SlotStorage.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// The bounded ring for producers and consumers in different processes.
+namespace finite_buffer {
+
+// An event count (see EventCount in Locks.h) whose waiters may sleep in other processes: it lives in
+// the shared mapping and waits on a futex that is not process-private. Without futexes a waiter
+// yields instead of sleeping.
+//
+// Rather than counting its waiters it keeps a SLEEPING bit in the futex word. A notify that finds the
+// bit clear costs a fence and a load. The notify that clears it makes the one wake-up call, for
+// every sleeper, so a producer running ahead of a parked consumer does not pay a system call per item
+// until the consumer gets to run.
+class ProcessEventCount {
+public:
+    // Announces a waiter; the caller then checks its condition once more before commitWait(key)
+    uint32_t prepareWait() {
+        uint32_t key = word.fetch_or(SLEEPING, std::memory_order_seq_cst) | SLEEPING;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return key;
+    }
+
+    // Returns once a notify has happened after prepareWait(), by the deadline, or spuriously
+    void commitWait(uint32_t key, const WaitDeadline& deadline) {
+#if defined(__linux__) && defined(SYS_futex)
+        timespec timeout;
+        timespec* limit = nullptr;
+        if (!deadline.unbounded()) {
+            auto left = deadline.time() - WaitDeadline::Clock::now();
+            if (left <= WaitDeadline::Clock::duration::zero()) return;
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(left).count();
+            timeout.tv_sec = static_cast<time_t>(ns / 1000000000);
+            timeout.tv_nsec = static_cast<long>(ns % 1000000000);
+            limit = &timeout;
+        }
+        static_assert(sizeof(word) == sizeof(uint32_t));
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, key, limit, nullptr, 0);
+#else
+        (void)key;
+        (void)deadline;
+        std::this_thread::yield();
+#endif
+    }
+
+    // After publishing what the waiters wait for
+    void notify() {
+        // Orders the caller's publication with the waiter's fetch_or: either the waiter sees it, or
+        // this sees the bit
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint32_t value = word.load(std::memory_order_relaxed);
+        if (!(value & SLEEPING)) return;
+        // A failed exchange means another notify cleared the bit and makes the call
+        if (!word.compare_exchange_strong(value, (value & ~SLEEPING) + 2, std::memory_order_relaxed)) return;
+#if defined(__linux__) && defined(SYS_futex)
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+    }
+
+private:
+    static constexpr uint32_t SLEEPING = 1;     // the rest of the word counts notifies, in steps of 2
+
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> word{0};
+};
+
+// -------------------- Shared Ring Buffer --------------------
+// RingBuffer's algorithm laid out in one block of memory with no pointers in it: a header with the
+// positions, the closed flag and two process-shared event counts, followed by the slots. Any process
+// that maps the block, at any address, can produce and consume. T must be trivially copyable, since
+// items are handed between address spaces as bytes; carry payloads that contain pointers as offsets.
+//
+// create() and open() place the ring in POSIX shared memory under a name (/dev/shm on Linux), and
+// createAnonymous() in a shared mapping that processes forked afterwards inherit. Waiting spins
+// briefly, then sleeps on a futex. Latency statistics and the log are kept per process. A process
+// that dies in the middle of an operation can leave its slot claimed forever; recovering from that
+// is up to the application.
+template <typename T>
+class SharedRingBuffer {
+    static_assert(std::is_trivially_copyable_v<T>, "SharedRingBuffer copies items between processes as bytes");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+                  "the positions must be address-free atomics");
+
+public:
+    ~SharedRingBuffer() {
+#if defined(__linux__)
+        munmap(header, mapped_bytes);
+#endif
+    }
+
+    SharedRingBuffer(const SharedRingBuffer&) = delete;
+    SharedRingBuffer& operator=(const SharedRingBuffer&) = delete;
+
+    // Bytes of shared memory a ring of the given capacity (rounded up to a power of two) takes
+    static size_t bytesFor(size_t requested_capacity) {
+        return sizeof(Header) + roundUpToPowerOfTwo(requested_capacity) * sizeof(Slot);
+    }
+
+    // Creates the named ring; nullptr (with errno set) if it exists already or the system refuses
+    static std::unique_ptr<SharedRingBuffer> create(const std::string& name, size_t requested_capacity) {
+#if defined(__linux__)
+        size_t capacity = roundUpToPowerOfTwo(requested_capacity);
+        size_t bytes = bytesFor(capacity);
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) return nullptr;
+        void* memory = MAP_FAILED;
+        if (ftruncate(fd, static_cast<off_t>(bytes)) == 0)
+            memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (memory == MAP_FAILED) {
+            shm_unlink(name.c_str());
+            return nullptr;
+        }
+        return std::unique_ptr<SharedRingBuffer>(new SharedRingBuffer(format(memory, capacity), bytes));
+#else
+        (void)name;
+        (void)requested_capacity;
+        return nullptr;
+#endif
+    }
+
+    // Maps the named ring another process created. nullptr if there is none, if it is not (yet) a
+    // ring of this T, or if the system refuses.
+    static std::unique_ptr<SharedRingBuffer> open(const std::string& name) {
+#if defined(__linux__)
+        int fd = shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0) return nullptr;
+        struct stat st;
+        void* memory = MAP_FAILED;
+        size_t bytes = 0;
+        if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(Header)) {
+            bytes = static_cast<size_t>(st.st_size);
+            memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (memory == MAP_FAILED) return nullptr;
+        Header* h = static_cast<Header*>(memory);
+        if (!h->ready.load(std::memory_order_acquire) || h->magic != MAGIC || h->version != VERSION ||
+            h->item_size != sizeof(T) || h->item_align != alignof(T) || bytes < bytesFor(h->capacity)) {
+            munmap(memory, bytes);
+            return nullptr;
+        }
+        return std::unique_ptr<SharedRingBuffer>(new SharedRingBuffer(h, bytes));
+#else
+        (void)name;
+        return nullptr;
+#endif
+    }
+
+    // Removes the name; processes that have the ring mapped keep using it
+    static bool unlink(const std::string& name) {
+#if defined(__linux__)
+        return shm_unlink(name.c_str()) == 0;
+#else
+        (void)name;
+        return false;
+#endif
+    }
+
+    // A ring without a name, shared with the processes this one forks after creating it
+    static std::unique_ptr<SharedRingBuffer> createAnonymous(size_t requested_capacity) {
+#if defined(__linux__)
+        size_t capacity = roundUpToPowerOfTwo(requested_capacity);
+        size_t bytes = bytesFor(capacity);
+        void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) return nullptr;
+        return std::unique_ptr<SharedRingBuffer>(new SharedRingBuffer(format(memory, capacity), bytes));
+#else
+        (void)requested_capacity;
+        return nullptr;
+#endif
+    }
+
+    size_t capacity() const {
+        return static_cast<size_t>(header->capacity);
+    }
+
+    void produce(const T& item, int producer_id) {
+        produceWithin(WaitDeadline::forever(), item, producer_id);
+    }
+
+    T consume(int consumer_id) {
+        return *consumeWithin(WaitDeadline::forever(), consumer_id);
+    }
+
+    // Non-blocking and timed versions, with the semantics of RingBuffer's
+    bool try_produce(const T& item, int producer_id) {
+        return produceWithin(WaitDeadline::none(), item, producer_id);
+    }
+
+    template <typename Rep, typename Period>
+    bool produce_for(const T& item, const std::chrono::duration<Rep, Period>& timeout, int producer_id) {
+        return produceWithin(WaitDeadline::after(timeout), item, producer_id);
+    }
+
+    bool produce_until(const T& item, std::chrono::steady_clock::time_point deadline, int producer_id) {
+        return produceWithin(WaitDeadline::at(deadline), item, producer_id);
+    }
+
+    std::optional<T> try_consume(int consumer_id) {
+        return consumeWithin(WaitDeadline::none(), consumer_id);
+    }
+
+    template <typename Rep, typename Period>
+    std::optional<T> consume_for(const std::chrono::duration<Rep, Period>& timeout, int consumer_id) {
+        return consumeWithin(WaitDeadline::after(timeout), consumer_id);
+    }
+
+    std::optional<T> consume_until(std::chrono::steady_clock::time_point deadline, int consumer_id) {
+        return consumeWithin(WaitDeadline::at(deadline), consumer_id);
+    }
+
+    // For every process: the try_/timed produce calls fail from now on, and the try_/timed consume
+    // calls stop waiting once the ring is empty. The blocking produce() and consume() are not affected.
+    void close() {
+        header->closed.store(true, std::memory_order_seq_cst);
+        header->not_full.notify();
+        header->not_empty.notify();
+    }
+
+    bool isClosed() const {
+        return header->closed.load(std::memory_order_acquire);
+    }
+
+    std::vector<double> Stats() {
+        std::vector<double> time_stat;
+        time_stat.push_back(stats.summary(BufferOp::Produce).total_seconds);
+        time_stat.push_back(stats.summary(BufferOp::Consume).total_seconds);
+        return time_stat;
+    }
+
+    // This process's operations only
+    LatencySummary latency(BufferOp op) {
+        return stats.summary(op);
+    }
+
+private:
+    static constexpr uint64_t MAGIC = 0x474e495242424853ull;   // "SHBBRING"
+    static constexpr uint32_t VERSION = 1;
+
+    struct alignas(CACHE_LINE_SIZE) Slot {
+        std::atomic<uint64_t> sequence;
+        SlotStorage<T> data;
+    };
+
+    struct Header {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t item_size;
+        uint32_t item_align;
+        uint64_t capacity;
+        std::atomic<bool> ready;        // set last by format(); open() refuses a ring before that
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> enqueue_pos;
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> dequeue_pos;
+        alignas(CACHE_LINE_SIZE) std::atomic<bool> closed;
+        ProcessEventCount not_full;     // producers that found the ring full
+        ProcessEventCount not_empty;    // consumers that found it empty
+    };
+
+    Header* header;
+    Slot* slots;
+    size_t mask;
+    size_t mapped_bytes;
+
+    BufferStats stats;
+    uint64_t start_time;        // CycleClock ticks
+
+    SharedRingBuffer(Header* h, size_t bytes)
+        : header(h), slots(reinterpret_cast<Slot*>(h + 1)), mask(static_cast<size_t>(h->capacity) - 1), mapped_bytes(bytes) {
+        start_time = CycleClock::now();
+    }
+
+    static size_t roundUpToPowerOfTwo(size_t n) {
+        size_t p = 2;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    // Lays out an empty ring in zero-filled shared memory
+    static Header* format(void* memory, size_t capacity) {
+        Header* h = new (memory) Header();
+        h->magic = MAGIC;
+        h->version = VERSION;
+        h->item_size = sizeof(T);
+        h->item_align = alignof(T);
+        h->capacity = capacity;
+        h->enqueue_pos.store(0, std::memory_order_relaxed);
+        h->dequeue_pos.store(0, std::memory_order_relaxed);
+        h->closed.store(false, std::memory_order_relaxed);
+        Slot* s = reinterpret_cast<Slot*>(h + 1);
+        for (size_t i = 0; i < capacity; ++i) {
+            new (&s[i]) Slot();
+            s[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        h->ready.store(true, std::memory_order_release);
+        return h;
+    }
+
+    Slot& slotAt(uint64_t pos) {
+        return slots[pos & mask];
+    }
+
+    // Spins briefly, then sleeps on event until ready(); false if the deadline runs out first
+    template <typename Ready>
+    bool waitFor(ProcessEventCount& event, Ready ready, const WaitDeadline& deadline) {
+        Backoff backoff;
+        while (!ready()) {
+            if (deadline.passed(header->closed)) return false;
+            if (backoff.spin()) continue;
+            uint32_t key = event.prepareWait();
+            if (ready() || deadline.passed(header->closed)) continue;
+            event.commitWait(key, deadline);
+        }
+        return true;
+    }
+
+    bool produceWithin(const WaitDeadline& deadline, const T& item, int producer_id) {
+        if (deadline.endsOnClose() && isClosed()) return false;
+        uint64_t request_time = CycleClock::now();
+
+        // The slot at enqueue_pos is free, or taken by a producer that will move enqueue_pos on
+        auto has_space = [this] {
+            uint64_t pos = header->enqueue_pos.load(std::memory_order_relaxed);
+            return static_cast<int64_t>(slotAt(pos).sequence.load(std::memory_order_acquire) - pos) >= 0;
+        };
+
+        Slot* slot;
+        uint64_t pos = header->enqueue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            slot = &slotAt(pos);
+            int64_t diff = static_cast<int64_t>(slot->sequence.load(std::memory_order_acquire) - pos);
+            if (diff == 0) {
+                if (header->enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else {
+                // Full: wait for a consumer in any process to free the slot
+                if (diff < 0 && !waitFor(header->not_full, has_space, deadline)) return false;
+                pos = header->enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        uint64_t claimed_time = CycleClock::now();
+
+        slot->data.construct(item);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        header->not_empty.notify();
+
+        uint64_t now = CycleClock::now();
+        buffer_logger.log(LogRole::Producer, producer_id, logValue(item), CycleClock::toNs(now - start_time), CycleClock::toNs(now - request_time));
+        stats.record(BufferOp::Produce, request_time, claimed_time, now, CycleClock::now());
+        return true;
+    }
+
+    std::optional<T> consumeWithin(const WaitDeadline& deadline, int consumer_id) {
+        uint64_t request_time = CycleClock::now();
+
+        auto has_item = [this] {
+            uint64_t pos = header->dequeue_pos.load(std::memory_order_relaxed);
+            return static_cast<int64_t>(slotAt(pos).sequence.load(std::memory_order_acquire) - (pos + 1)) >= 0;
+        };
+
+        Slot* slot;
+        uint64_t pos = header->dequeue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            slot = &slotAt(pos);
+            int64_t diff = static_cast<int64_t>(slot->sequence.load(std::memory_order_acquire) - (pos + 1));
+            if (diff == 0) {
+                if (header->dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else {
+                // Empty: wait for a producer in any process to fill the slot
+                if (diff < 0 && !waitFor(header->not_empty, has_item, deadline)) return std::nullopt;
+                pos = header->dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        uint64_t claimed_time = CycleClock::now();
+
+        T item = slot->data.take();
+        // Hand the slot back to producers for the next lap
+        slot->sequence.store(pos + mask + 1, std::memory_order_release);
+        header->not_full.notify();
+
+        uint64_t now = CycleClock::now();
+        buffer_logger.log(LogRole::Consumer, consumer_id, logValue(item), CycleClock::toNs(now - start_time), CycleClock::toNs(now - request_time));
+        stats.record(BufferOp::Consume, request_time, claimed_time, now, CycleClock::now());
+        return item;
+    }
+};
+
+} // namespace finite_buffer
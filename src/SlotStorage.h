@@ -0,0 +1,66 @@
+#pragma once
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Storage for one buffer element inside a node or ring slot.
+//
+// The general version keeps raw, suitably aligned bytes and manages the element's lifetime by
+// hand: the producer constructs the item in place (so large structs are built directly in the
+// slot and move-only types work) and the consumer moves it out and destroys it. An empty slot
+// therefore never holds a live T, and no default constructor is needed.
+template <typename T, bool Inline = std::is_trivially_copyable_v<T> && sizeof(T) <= 2 * sizeof(void*)>
+class SlotStorage {
+private:
+    alignas(T) unsigned char bytes[sizeof(T)];
+
+public:
+    template <typename... Args>
+    void construct(Args&&... args) {
+        new (bytes) T(std::forward<Args>(args)...);
+    }
+
+    T& get() {
+        return *std::launder(reinterpret_cast<T*>(bytes));
+    }
+
+    // Moves the element out and ends its lifetime.
+    T take() {
+        T item = std::move(get());
+        destroy();
+        return item;
+    }
+
+    void destroy() {
+        get().~T();
+    }
+};
+
+// Small trivially-copyable types (ints, pointers, small PODs) are stored as a plain member:
+// constructing is a copy and taking is a load, with no lifetime bookkeeping.
+template <typename T>
+class SlotStorage<T, true> {
+private:
+    union {
+        T value;
+    };
+
+public:
+    SlotStorage() {}
+
+    template <typename... Args>
+    void construct(Args&&... args) {
+        value = T(std::forward<Args>(args)...);
+    }
+
+    T& get() {
+        return value;
+    }
+
+    T take() {
+        return value;
+    }
+
+    void destroy() {}
+};
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// NUMA layout of the machine and thread placement, without a libnuma dependency.
+//
+// The node map comes from /sys/devices/system/node/node<K>/cpulist and is read once. Nodes are
+// numbered densely from 0 in id order, so pools and shards can be indexed by node. Where there is no
+// such directory (other systems, containers hiding it) the machine is one node and every call here
+// is cheap: currentNode() returns 0 without asking the kernel, and preferNode() does nothing.
+class NumaTopology {
+public:
+    static const NumaTopology& system() {
+        static const NumaTopology topology;
+        return topology;
+    }
+
+    size_t nodeCount() const {
+        return node_ids.size();
+    }
+
+    // Kernel id of the node with dense index node
+    int nodeId(size_t node) const {
+        return node_ids[node];
+    }
+
+    // Node of a cpu; cpus the map does not know belong to node 0
+    size_t nodeOfCpu(int cpu) const {
+        if (cpu < 0 || static_cast<size_t>(cpu) >= cpu_nodes.size()) return 0;
+        return cpu_nodes[static_cast<size_t>(cpu)];
+    }
+
+    // Node of the cpu the calling thread runs on right now, which only stays true for pinned threads
+    size_t currentNode() const {
+        if (nodeCount() == 1) return 0;
+#if defined(__linux__)
+        return nodeOfCpu(sched_getcpu());
+#else
+        return 0;
+#endif
+    }
+
+    // Asks the kernel to back [addr, addr + bytes) with memory of node, moving pages that are already
+    // there. Only whole pages inside the range are affected, and a failure leaves the default
+    // first-touch placement, so this is a hint and nothing more.
+    void preferNode(void* addr, size_t bytes, size_t node) const {
+#if defined(__linux__) && defined(SYS_mbind)
+        if (nodeCount() == 1 || node >= nodeCount()) return;
+        const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+        uintptr_t begin = (reinterpret_cast<uintptr_t>(addr) + page - 1) & ~(page - 1);
+        uintptr_t end = (reinterpret_cast<uintptr_t>(addr) + bytes) & ~(page - 1);
+        if (begin >= end) return;
+
+        constexpr int MPOL_PREFERRED_MODE = 1;      // <numaif.h> values, which come with libnuma
+        constexpr unsigned MPOL_MF_MOVE_FLAG = 1u << 1;
+        constexpr size_t BITS = 8 * sizeof(unsigned long);
+        size_t id = static_cast<size_t>(node_ids[node]);
+        std::vector<unsigned long> mask(id / BITS + 1, 0);
+        mask[id / BITS] |= 1ul << (id % BITS);
+        syscall(SYS_mbind, begin, end - begin, MPOL_PREFERRED_MODE, mask.data(), mask.size() * BITS + 1, MPOL_MF_MOVE_FLAG);
+#else
+        (void)addr;
+        (void)bytes;
+        (void)node;
+#endif
+    }
+
+    // "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}; also the format of the drivers' --pin-* options.
+    // Returns an empty list if the text is not such a list.
+    static std::vector<int> parseCpuList(const std::string& text) {
+        std::vector<int> cpus;
+        size_t pos = 0;
+        while (pos < text.size()) {
+            size_t comma = text.find(',', pos);
+            std::string part = text.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+            pos = comma == std::string::npos ? text.size() : comma + 1;
+            part.erase(std::remove_if(part.begin(), part.end(), [](char c) { return c == ' ' || c == '\n' || c == '\r'; }), part.end());
+            if (part.empty()) continue;
+            size_t dash = part.find('-');
+            try {
+                size_t used = 0;
+                int first = std::stoi(part.substr(0, dash), &used);
+                int last = first;
+                if (used != (dash == std::string::npos ? part.size() : dash)) return {};
+                if (dash != std::string::npos) {
+                    std::string rest = part.substr(dash + 1);
+                    last = std::stoi(rest, &used);
+                    if (used != rest.size()) return {};
+                }
+                if (first < 0 || last < first) return {};
+                for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+            } catch (const std::exception&) {
+                return {};
+            }
+        }
+        return cpus;
+    }
+
+private:
+    std::vector<int> node_ids;          // dense index -> kernel node id
+    std::vector<size_t> cpu_nodes;      // cpu -> dense node index
+
+    NumaTopology() {
+#if defined(__linux__)
+        // Node ids may have gaps; stop after a run of missing ones
+        for (int id = 0, missing = 0; missing < 64; ++id) {
+            std::ifstream in("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+            std::string list;
+            if (!in || !std::getline(in, list)) {
+                missing++;
+                continue;
+            }
+            missing = 0;
+            size_t node = node_ids.size();
+            node_ids.push_back(id);
+            for (int cpu : parseCpuList(list)) {
+                if (static_cast<size_t>(cpu) >= cpu_nodes.size()) cpu_nodes.resize(static_cast<size_t>(cpu) + 1, 0);
+                cpu_nodes[static_cast<size_t>(cpu)] = node;
+            }
+        }
+#endif
+        if (node_ids.empty()) node_ids.push_back(0);
+    }
+};
+
+// Restricts the calling thread to one cpu. Returns false if the system refuses (no such cpu, not in
+// the process's cpuset) or has no thread affinity, in which case the thread runs where it did.
+inline bool pinCurrentThread(int cpu) {
+#if defined(__linux__)
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
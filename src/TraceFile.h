@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "AsyncLogger.h"
+#include "LogAnalyzer.h"
+#include "MappedLog.h"
+
+// Read side of the indexed trace format (LogFormat::Trace, layout in AsyncLogger.h).
+//
+// Opening a trace maps it read-only and checks its header: nothing is parsed or copied, so a trace
+// of millions of events opens in constant time and only the pages that are looked at are read.
+// The records are sorted by timestamp. seek() finds the first record at or after a time through the
+// time index (one bucket, then a binary search inside it), and the checkpoints answer how many
+// producer records lie before a position, or where the n-th one is, in O(log n). The Visualizer
+// rebuilds its view at any point of the run from these without replaying the run up to there.
+//
+//     TraceFile trace("FiniteBufferTrace.ibt");
+//     size_t at = trace.seek(trace.firstNs() + 5'000'000);        // 5 ms into the run
+//     uint64_t depth = trace.producedBefore(at) - trace.consumedBefore(at);
+//
+// exportTrace() builds a trace from a text or binary log of an earlier run.
+
+class TraceFile {
+public:
+    explicit TraceFile(const std::string& path) : file(path) {
+        if (file.size() < sizeof(TraceHeader)) return;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, AsyncLogger::TRACE_MAGIC, sizeof(header.magic)) != 0 || header.index_offset == 0) return;
+        size_t index_bytes = (header.bucket_count + 1 + checkpointCount()) * sizeof(uint64_t);
+        if (header.index_offset != sizeof(TraceHeader) + header.record_count * sizeof(LogRecord) ||
+            header.index_offset + index_bytes > file.size())
+            return;
+        // The header and the records keep every field at its natural alignment within the mapping
+        records = reinterpret_cast<const LogRecord*>(file.data() + sizeof(TraceHeader));
+        time_index = reinterpret_cast<const uint64_t*>(file.data() + header.index_offset);
+        checkpoints = time_index + header.bucket_count + 1;
+        valid = true;
+    }
+
+    TraceFile(const TraceFile&) = delete;
+    TraceFile& operator=(const TraceFile&) = delete;
+
+    // False for a missing file, a log that is not a trace, or a trace that was never finished
+    bool isOpen() const {
+        return valid;
+    }
+
+    size_t size() const {
+        return valid ? header.record_count : 0;
+    }
+
+    const LogRecord& operator[](size_t i) const {
+        return records[i];
+    }
+
+    int64_t firstNs() const {
+        return header.first_ns;
+    }
+
+    int64_t lastNs() const {
+        return header.last_ns;
+    }
+
+    // Index of the first record with a timestamp at or after t (size() if there is none)
+    size_t seek(int64_t t) const {
+        if (!valid || t <= header.first_ns) return 0;
+        if (t > header.last_ns) return size();
+        uint64_t bucket = static_cast<uint64_t>(t - header.first_ns) / static_cast<uint64_t>(header.bucket_ns);
+        const LogRecord* from = records + time_index[bucket];
+        const LogRecord* to = records + time_index[bucket + 1];
+        return static_cast<size_t>(std::lower_bound(from, to, t, [](const LogRecord& r, int64_t at) {
+            return r.timestamp_ns < at;
+        }) - records);
+    }
+
+    // Producer records among the first i records
+    uint64_t producedBefore(size_t i) const {
+        if (i >= size()) return header.produced_count;
+        size_t c = i / TRACE_CHECKPOINT;
+        uint64_t produced = checkpoints[c];
+        for (size_t j = c * TRACE_CHECKPOINT; j < i; ++j) produced += records[j].role == LogRole::Producer;
+        return produced;
+    }
+
+    uint64_t consumedBefore(size_t i) const {
+        return std::min(i, size()) - producedBefore(i);
+    }
+
+    // Index of the n-th producer record (from 0), or size() if there are no more than n
+    size_t producerRecord(uint64_t n) const {
+        if (n >= header.produced_count) return size();
+        // The last checkpoint with at most n producers before it; the record is within its stretch
+        size_t c = static_cast<size_t>(std::upper_bound(checkpoints, checkpoints + checkpointCount(), n) - checkpoints) - 1;
+        uint64_t produced = checkpoints[c];
+        for (size_t j = c * TRACE_CHECKPOINT; j < size(); ++j) {
+            if (records[j].role != LogRole::Producer) continue;
+            if (produced++ == n) return j;
+        }
+        return size();
+    }
+
+private:
+    MappedFile file;
+    TraceHeader header{};
+    const LogRecord* records = nullptr;
+    const uint64_t* time_index = nullptr;
+    const uint64_t* checkpoints = nullptr;
+    bool valid = false;
+
+    size_t checkpointCount() const {
+        return header.record_count / TRACE_CHECKPOINT + 1;
+    }
+};
+
+// Writes a trace of the text or binary log at log_path (e.g. a run without --trace) to trace_path.
+inline bool exportTrace(const std::string& log_path, const std::string& trace_path) {
+    MappedFile log(log_path);
+    if (!log.isOpen()) return false;
+    const char* data = log.data();
+    const char* end = data + log.size();
+    std::vector<LogRecord> records;
+    // Already a trace: nothing to convert
+    if (log_analyzer::isTraceLog(data, log.size())) return false;
+    if (log_analyzer::isBinaryLog(data, log.size())) {
+        for (const char* p = data + sizeof(AsyncLogger::BINARY_MAGIC); p + sizeof(LogRecord) <= end; p += sizeof(LogRecord)) {
+            LogRecord r;
+            std::memcpy(&r, p, sizeof(r));
+            records.push_back(r);
+        }
+    } else {
+        log_analyzer::forEachLine(data, end, [&](const char* begin, const char* line_end) {
+            LogRecord r;
+            if (log_analyzer::parseLogLine(begin, line_end, r)) records.push_back(r);
+        });
+    }
+    return AsyncLogger::writeTrace(trace_path, records);
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <SFML/Graphics.hpp>
+#include "TraceFile.h"
+
+// Playback clock and controls of the Visualizers.
+//
+// A trace plays at pace_ns * speed trace nanoseconds per second (the drivers' --speed). The time
+// shown depends only on where playback is in the trace, never on the frame rate, so a trace replays
+// the same way every time, and the Visualizers rebuild their view for any point of it.
+//
+//   Space          pause / resume
+//   Up / Down      double / halve the speed
+//   Left / Right   step back / forward by a twentieth of the run
+//   Home / End     jump to the start / end
+//   timeline       click or drag on the bar at the bottom of the window to scrub
+class TracePlayback {
+public:
+    static constexpr double MIN_SPEED = 1.0 / 64;
+    static constexpr double MAX_SPEED = 1 << 20;
+
+    TracePlayback(const TraceFile& trace, double pace_ns, double speed)
+        : first_ns(trace.firstNs()),
+          span_ns(static_cast<double>(trace.lastNs() - trace.firstNs())),
+          pace(pace_ns),
+          rate(std::clamp(speed, MIN_SPEED, MAX_SPEED)) {}
+
+    // Handles the playback keys and the timeline; returns false for any other event
+    bool handle(const sf::Event& event, const sf::RenderWindow& window) {
+        if (event.type == sf::Event::KeyPressed) {
+            switch (event.key.code) {
+            case sf::Keyboard::Space: paused = !paused; break;
+            case sf::Keyboard::Up: rate = std::min(rate * 2, MAX_SPEED); break;
+            case sf::Keyboard::Down: rate = std::max(rate / 2, MIN_SPEED); break;
+            case sf::Keyboard::Left: moveTo(offset_ns - span_ns / 20); break;
+            case sf::Keyboard::Right: moveTo(offset_ns + span_ns / 20); break;
+            case sf::Keyboard::Home: moveTo(0); break;
+            case sf::Keyboard::End: moveTo(span_ns); break;
+            default: return false;
+            }
+            return true;
+        }
+        if (event.type == sf::Event::MouseButtonPressed && event.mouseButton.button == sf::Mouse::Left) {
+            sf::FloatRect bar = barArea(window);
+            float x = static_cast<float>(event.mouseButton.x), y = static_cast<float>(event.mouseButton.y);
+            if (!sf::FloatRect(bar.left, bar.top - 8, bar.width, bar.height + 16).contains(x, y)) return false;
+            scrubbing = true;
+            scrubTo(x, window);
+            return true;
+        }
+        if (event.type == sf::Event::MouseMoved && scrubbing) {
+            scrubTo(static_cast<float>(event.mouseMove.x), window);
+            return true;
+        }
+        if (event.type == sf::Event::MouseButtonReleased && scrubbing) {
+            scrubbing = false;
+            return true;
+        }
+        return false;
+    }
+
+    // Moves the clock on by dt seconds and returns the trace time to show
+    int64_t advance(float dt) {
+        if (!paused && !scrubbing) moveTo(offset_ns + static_cast<double>(dt) * pace * rate);
+        return now();
+    }
+
+    int64_t now() const {
+        return first_ns + static_cast<int64_t>(offset_ns);
+    }
+
+    // Timeline and playback state, drawn over the window's default view
+    void draw(sf::RenderWindow& window, const sf::Font& font) const {
+        window.setView(window.getDefaultView());
+        sf::FloatRect bar = barArea(window);
+        sf::RectangleShape track(sf::Vector2f(bar.width, bar.height));
+        track.setPosition(bar.left, bar.top);
+        track.setFillColor(sf::Color(80, 80, 80));
+        window.draw(track);
+        float played = span_ns > 0 ? static_cast<float>(offset_ns / span_ns) : 1.0f;
+        sf::RectangleShape progress(sf::Vector2f(bar.width * played, bar.height));
+        progress.setPosition(bar.left, bar.top);
+        progress.setFillColor(sf::Color(0, 160, 255));
+        window.draw(progress);
+
+        char status[128];
+        std::snprintf(status, sizeof(status), "%.3f / %.3f ms | speed %gx%s", offset_ns / 1e6, span_ns / 1e6, rate,
+                      paused ? " | paused" : "");
+        sf::Text text;
+        text.setFont(font);
+        text.setCharacterSize(14);
+        text.setFillColor(sf::Color::White);
+        text.setString(status);
+        text.setPosition(bar.left, bar.top - 22);
+        window.draw(text);
+    }
+
+private:
+    const int64_t first_ns;
+    const double span_ns;
+    const double pace;          // trace nanoseconds per second at speed 1
+    double rate;
+    double offset_ns = 0;       // from the first record
+    bool paused = false;
+    bool scrubbing = false;
+
+    void moveTo(double offset) {
+        offset_ns = std::clamp(offset, 0.0, span_ns);
+    }
+
+    sf::FloatRect barArea(const sf::RenderWindow& window) const {
+        sf::Vector2u size = window.getSize();
+        return sf::FloatRect(50, static_cast<float>(size.y) - 30, static_cast<float>(size.x) - 100, 8);
+    }
+
+    void scrubTo(float x, const sf::RenderWindow& window) {
+        sf::FloatRect bar = barArea(window);
+        moveTo(std::clamp((x - bar.left) / bar.width, 0.0f, 1.0f) * span_ns);
+    }
+};